@@ -7,14 +7,546 @@
 #include <string>
 #include <iostream>
 #include <math.h>
+#include <functional>
+#include <atomic>
+#include <memory>
+#include <type_traits>
+#include <stdio.h>
+#include <cstddef>
+#include <ctime>
+#include <new>
+#include <utility>
+#include <tuple>
+#include <map>
+#include <deque>
+#include <unordered_map>
+#include <algorithm>
+#include <sys/stat.h>
 
 #ifdef __EMSCRIPTEN__
 #include <emscripten.h>
 #include <emscripten/html5.h>
 #endif
 
+// emscripten only gets threads when built with pthreads, everything else always has them.
+#if !defined(__EMSCRIPTEN__) || defined(__EMSCRIPTEN_PTHREADS__)
+#define CRISPY_OCTO_SPORK_THREADS
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#endif
+
+// log calls below this level compile away. 0 = debug, 1 = info, 2 = warnings, 3 = errors only.
+#ifndef CRISPY_OCTO_SPORK_LOG_LEVEL
+#define CRISPY_OCTO_SPORK_LOG_LEVEL 1
+#endif
+
+// coroutine tasks need a c++20 compiler, set /std:c++20 or -std=c++20 to get them.
+#if defined(__cpp_impl_coroutine)
+#define CRISPY_OCTO_SPORK_COROUTINES
+#include <coroutine>
+#include <exception>
+#endif
+
+// batched file io can go through io_uring on linux, define CRISPY_OCTO_SPORK_USE_IO_URING and link with -luring to
+// turn it on. it's opt in because having the header installed says nothing about the library being linked.
+#if defined(__linux__) && defined(__has_include) && defined(CRISPY_OCTO_SPORK_USE_IO_URING)
+#if __has_include(<liburing.h>)
+#define CRISPY_OCTO_SPORK_IO_URING
+#include <liburing.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+#endif
+
+// benchmarks pin themselves to a core, which SDL has no call for.
+#if defined(_WIN32)
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#ifndef NOGDI
+#define NOGDI
+#endif
+#include <windows.h>
+#elif defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+#endif
+
+// each call site gets its own rate limit. the format string must be a literal since it's formatted later on the writer thread.
+#define COS_LOG(level, ...) \
+	do \
+	{ \
+		static CrispyOctoSpork::LogSite logSite; \
+		CrispyOctoSpork::Logger::Get().Write(logSite, level, __VA_ARGS__); \
+	} while (0)
+
+// levels under CRISPY_OCTO_SPORK_LOG_LEVEL are left out by the preprocessor. the arguments only show up inside sizeof,
+// so nothing is evaluated or packed, but variables that are only logged don't turn into unused warnings.
+#define COS_LOG_FILTERED(...) do { (void)sizeof(std::make_tuple(__VA_ARGS__)); } while (0)
+
+#if CRISPY_OCTO_SPORK_LOG_LEVEL <= 0
+#define COS_LOG_DEBUG(...) COS_LOG(CrispyOctoSpork::LogLevel::DEBUG, __VA_ARGS__)
+#else
+#define COS_LOG_DEBUG(...) COS_LOG_FILTERED(__VA_ARGS__)
+#endif
+
+#if CRISPY_OCTO_SPORK_LOG_LEVEL <= 1
+#define COS_LOG_INFO(...) COS_LOG(CrispyOctoSpork::LogLevel::INFO, __VA_ARGS__)
+#else
+#define COS_LOG_INFO(...) COS_LOG_FILTERED(__VA_ARGS__)
+#endif
+
+#if CRISPY_OCTO_SPORK_LOG_LEVEL <= 2
+#define COS_LOG_WARN(...) COS_LOG(CrispyOctoSpork::LogLevel::WARN, __VA_ARGS__)
+#else
+#define COS_LOG_WARN(...) COS_LOG_FILTERED(__VA_ARGS__)
+#endif
+
+#if CRISPY_OCTO_SPORK_LOG_LEVEL <= 3
+#define COS_LOG_ERR(...) COS_LOG(CrispyOctoSpork::LogLevel::ERR, __VA_ARGS__)
+#else
+#define COS_LOG_ERR(...) COS_LOG_FILTERED(__VA_ARGS__)
+#endif
+
 namespace CrispyOctoSpork
 {
+	/// <summary>
+	/// Fixed size, single producer single consumer queue that never locks or allocates after construction.
+	/// </summary>
+	template <typename T, int Capacity>
+	class SpscRing
+	{
+	public:
+		/// <summary>
+		/// Default constructor.
+		/// </summary>
+		SpscRing() : head(0), tail(0), items(new T[Capacity])
+		{}
+
+		/// <summary>
+		/// Copies an item into the ring. Only call from the producing thread.
+		/// </summary>
+		/// <param name="item">The item to add.</param>
+		/// <returns>Returns false if the ring is full.</returns>
+		bool TryPush(const T& item)
+		{
+			Uint32 currentHead = head.load(std::memory_order_relaxed);
+
+			if (currentHead - tail.load(std::memory_order_acquire) >= (Uint32)Capacity)
+			{
+				return false;
+			}
+
+			items[currentHead % Capacity] = item;
+			head.store(currentHead + 1, std::memory_order_release);
+			return true;
+		}
+
+		/// <summary>
+		/// Copies the oldest item out of the ring. Only call from the consuming thread.
+		/// </summary>
+		/// <param name="item">Where to copy the item to.</param>
+		/// <returns>Returns false if the ring is empty.</returns>
+		bool TryPop(T& item)
+		{
+			Uint32 currentTail = tail.load(std::memory_order_relaxed);
+
+			if (currentTail == head.load(std::memory_order_acquire))
+			{
+				return false;
+			}
+
+			item = items[currentTail % Capacity];
+			tail.store(currentTail + 1, std::memory_order_release);
+			return true;
+		}
+
+	private:
+		std::atomic<Uint32> head;
+		std::atomic<Uint32> tail;
+		std::unique_ptr<T[]> items;
+	};
+
+	/// <summary>
+	/// How severe a log message is.
+	/// </summary>
+	enum class LogLevel
+	{
+		DEBUG,
+		INFO,
+		WARN,
+		ERR
+	};
+
+	/// <summary>
+	/// Per call site state used to rate limit repeated log messages.
+	/// </summary>
+	struct LogSite
+	{
+		std::atomic<Uint32> windowStart{ 0 };
+		std::atomic<Uint32> messagesInWindow{ 0 };
+		std::atomic<Uint32> suppressed{ 0 };
+	};
+
+	/// <summary>
+	/// A log message as it sits in the queue: the format string and its arguments packed as binary.
+	/// </summary>
+	struct LogRecord
+	{
+		static const int MAX_ARGUMENTS = 8;
+		static const int PAYLOAD_SIZE = 192;
+
+		const char* format;
+		Uint64 counter;
+		Uint32 suppressed;
+		Uint16 payloadSize;
+		Uint8 level;
+		Uint8 argumentCount;
+		Uint8 argumentTypes[MAX_ARGUMENTS];
+		Uint8 payload[PAYLOAD_SIZE];
+	};
+
+	/// <summary>
+	/// Asynchronous logger. Callers pack their arguments into a per thread lock free ring and
+	/// a background thread formats and writes them, so logging never blocks a frame on console IO.
+	/// Use the COS_LOG_* macros rather than calling this directly.
+	/// </summary>
+	class Logger
+	{
+	public:
+		/// <summary>
+		/// Gets the process wide logger, starting its writer thread on first use.
+		/// </summary>
+		/// <returns>Returns the logger.</returns>
+		static Logger& Get();
+
+		/// <summary>
+		/// Flushes anything queued and stops the writer thread.
+		/// </summary>
+		~Logger();
+
+		/// <summary>
+		/// Queues a message. "{}" in the format is replaced by each argument in turn.
+		/// </summary>
+		/// <param name="site">The rate limiting state of the call site.</param>
+		/// <param name="level">How severe the message is.</param>
+		/// <param name="format">The format string. Must outlive the logger, so use a literal.</param>
+		/// <param name="arguments">Numbers and strings to fill in. Strings are copied.</param>
+		template <typename... Arguments>
+		void Write(LogSite& site, LogLevel level, const char* format, const Arguments&... arguments)
+		{
+			Uint32 suppressed = 0;
+
+			if (!PassesRateLimit(site, suppressed))
+			{
+				return;
+			}
+
+			LogRecord record;
+			record.format = format;
+			record.counter = SDL_GetPerformanceCounter();
+			record.suppressed = suppressed;
+			record.payloadSize = 0;
+			record.level = (Uint8)level;
+			record.argumentCount = 0;
+			Pack(record, arguments...);
+			Enqueue(record);
+		}
+
+		/// <summary>
+		/// Blocks until every message queued before the call has been written.
+		/// </summary>
+		void Flush();
+
+		/// <summary>
+		/// Sets how many messages a single call site may log per second before the rest are dropped.
+		/// </summary>
+		/// <param name="messagesPerSecond">The limit.</param>
+		void SetRateLimit(Uint32 messagesPerSecond);
+
+		static const int RING_CAPACITY = 256;
+
+	private:
+		enum ArgumentType
+		{
+			ARGUMENT_SIGNED,
+			ARGUMENT_UNSIGNED,
+			ARGUMENT_FLOAT,
+			ARGUMENT_STRING
+		};
+
+		struct ThreadBuffer
+		{
+			SpscRing<LogRecord, RING_CAPACITY> ring;
+			std::atomic<Uint32> dropped{ 0 };
+			std::atomic<bool> owned{ true };
+		};
+
+		/// <summary>
+		/// Lives in each logging thread and hands its buffer back when the thread exits, so the next new thread can
+		/// take it over instead of every short lived thread leaving a ring behind.
+		/// </summary>
+		struct ThreadBufferOwner
+		{
+			ThreadBuffer* buffer = NULL;
+
+			~ThreadBufferOwner()
+			{
+				if (buffer != NULL)
+				{
+					buffer->owned.store(false, std::memory_order_release);
+				}
+			}
+		};
+
+		Logger();
+
+		bool PassesRateLimit(LogSite& site, Uint32& suppressed);
+		void Enqueue(const LogRecord& record);
+		ThreadBuffer* GetThreadBuffer();
+		bool Drain();
+		void Output(const LogRecord& record);
+		void WriterLoop();
+
+		void Pack(LogRecord&) {}
+
+		template <typename T, typename... Rest>
+		void Pack(LogRecord& record, const T& argument, const Rest&... rest)
+		{
+			PackArgument(record, argument);
+			Pack(record, rest...);
+		}
+
+		template <typename T>
+		typename std::enable_if<std::is_integral<T>::value && std::is_signed<T>::value>::type PackArgument(LogRecord& record, T value)
+		{
+			Sint64 widened = value;
+			PackBytes(record, ARGUMENT_SIGNED, &widened, sizeof(widened));
+		}
+
+		template <typename T>
+		typename std::enable_if<std::is_integral<T>::value && !std::is_signed<T>::value>::type PackArgument(LogRecord& record, T value)
+		{
+			Uint64 widened = value;
+			PackBytes(record, ARGUMENT_UNSIGNED, &widened, sizeof(widened));
+		}
+
+		template <typename T>
+		typename std::enable_if<std::is_floating_point<T>::value>::type PackArgument(LogRecord& record, T value)
+		{
+			double widened = value;
+			PackBytes(record, ARGUMENT_FLOAT, &widened, sizeof(widened));
+		}
+
+		template <typename T>
+		typename std::enable_if<std::is_enum<T>::value>::type PackArgument(LogRecord& record, T value)
+		{
+			PackArgument(record, (Sint64)value);
+		}
+
+		void PackArgument(LogRecord& record, const char* value);
+		void PackArgument(LogRecord& record, const std::string& value);
+		void PackBytes(LogRecord& record, Uint8 type, const void* bytes, size_t size);
+
+		std::vector<std::unique_ptr<ThreadBuffer>> buffers;
+		std::atomic<Uint32> rateLimit;
+		Uint64 startCounter;
+		std::string line;
+
+		#ifdef CRISPY_OCTO_SPORK_THREADS
+		std::mutex buffersMutex;
+		std::thread writer;
+		std::atomic<bool> running;
+		std::atomic<Uint32> flushRequests;
+		std::atomic<Uint32> flushesCompleted;
+		std::mutex flushMutex;
+		std::condition_variable flushRequested;
+		std::condition_variable flushed;
+		#endif
+	};
+
+	/// <summary>
+	/// The subsystems memory is accounted against.
+	/// </summary>
+	enum class MemoryTag
+	{
+		GENERAL,
+		ENTITIES,
+		PARTICLES,
+		TEXTURES,
+		FONTS,
+		AUDIO,
+		GAMEPLAY,
+		SERVER,
+		COUNT
+	};
+
+	/// <summary>
+	/// A snapshot of the counters for a single <see cref="MemoryTag"/>.
+	/// </summary>
+	struct MemoryStats
+	{
+		Sint64 currentBytes = 0;
+		Sint64 peakBytes = 0;
+		Uint64 allocationCount = 0;
+		Sint64 budgetBytes = 0;
+	};
+
+	/// <summary>
+	/// Keeps current, peak and allocation counts per <see cref="MemoryTag"/>, both for memory the engine
+	/// allocates itself and estimates of what SDL holds on to for us, like textures, fonts and sound chunks.
+	/// </summary>
+	class MemoryTracker
+	{
+	public:
+		/// <summary>
+		/// Gets the process wide tracker.
+		/// </summary>
+		/// <returns>Returns the tracker.</returns>
+		static MemoryTracker& Get();
+
+		/// <summary>
+		/// Allocates memory charged to a specific tag.
+		/// </summary>
+		/// <param name="size">The number of bytes to allocate.</param>
+		/// <param name="tag">The tag to charge.</param>
+		/// <returns>Returns the memory, or NULL if the allocation failed.</returns>
+		void* Allocate(size_t size, MemoryTag tag);
+
+		/// <summary>
+		/// Frees memory from <see cref="Allocate"/>, crediting whichever tag it was charged to.
+		/// </summary>
+		/// <param name="pointer">The memory to free. NULL is ignored.</param>
+		void Free(void* pointer);
+
+		/// <summary>
+		/// Charges memory that something else owns, like a GPU texture.
+		/// </summary>
+		/// <param name="tag">The tag to charge.</param>
+		/// <param name="bytes">The estimated size in bytes.</param>
+		void AddExternal(MemoryTag tag, Sint64 bytes);
+
+		/// <summary>
+		/// Credits memory previously charged with <see cref="AddExternal"/>.
+		/// </summary>
+		/// <param name="tag">The tag to credit.</param>
+		/// <param name="bytes">The same estimate that was charged.</param>
+		void RemoveExternal(MemoryTag tag, Sint64 bytes);
+
+		/// <summary>
+		/// Sets the budget for a tag. A warning is logged each time the tag goes over it.
+		/// </summary>
+		/// <param name="tag">The tag.</param>
+		/// <param name="bytes">The budget in bytes, or 0 for none.</param>
+		void SetBudget(MemoryTag tag, Sint64 bytes);
+
+		/// <summary>
+		/// Gets the counters for a tag.
+		/// </summary>
+		/// <param name="tag">The tag.</param>
+		/// <returns>Returns a snapshot of the counters.</returns>
+		MemoryStats GetStats(MemoryTag tag);
+
+		/// <summary>
+		/// Logs the counters of every tag.
+		/// </summary>
+		void Dump();
+
+		/// <summary>
+		/// Gets the display name of a tag.
+		/// </summary>
+		/// <param name="tag">The tag.</param>
+		/// <returns>Returns the name.</returns>
+		static const char* GetTagName(MemoryTag tag);
+
+	private:
+		struct Counters
+		{
+			std::atomic<Sint64> current{ 0 };
+			std::atomic<Sint64> peak{ 0 };
+			std::atomic<Uint64> allocations{ 0 };
+			std::atomic<Sint64> budget{ 0 };
+			std::atomic<bool> overBudget{ false };
+		};
+
+		/// <summary>
+		/// Sits in front of every tracked allocation so Free knows what to credit.
+		/// Padded to keep the memory after it aligned for any type.
+		/// </summary>
+		union AllocationHeader
+		{
+			struct
+			{
+				size_t size;
+				MemoryTag tag;
+			} info;
+			std::max_align_t alignment;
+		};
+
+		Counters counters[(int)MemoryTag::COUNT];
+
+		void Charge(MemoryTag tag, Sint64 bytes, bool countAllocation);
+	};
+
+	/// <summary>
+	/// Standard library allocator that charges a fixed <see cref="MemoryTag"/>.
+	/// </summary>
+	template <typename T, MemoryTag Tag>
+	class TaggedAllocator
+	{
+	public:
+		typedef T value_type;
+
+		template <typename U>
+		struct rebind
+		{
+			typedef TaggedAllocator<U, Tag> other;
+		};
+
+		TaggedAllocator()
+		{}
+
+		template <typename U>
+		TaggedAllocator(const TaggedAllocator<U, Tag>&)
+		{}
+
+		T* allocate(size_t count)
+		{
+			void* memory = MemoryTracker::Get().Allocate(count * sizeof(T), Tag);
+
+			if (memory == NULL)
+			{
+				throw std::bad_alloc();
+			}
+
+			return (T*)memory;
+		}
+
+		void deallocate(T* pointer, size_t count)
+		{
+			MemoryTracker::Get().Free(pointer);
+		}
+
+		template <typename U>
+		bool operator==(const TaggedAllocator<U, Tag>&) const
+		{
+			return true;
+		}
+
+		template <typename U>
+		bool operator!=(const TaggedAllocator<U, Tag>&) const
+		{
+			return false;
+		}
+	};
+
 	/// <summary>
 	/// Base class for objects that should be updated and rendered.
 	/// </summary>
@@ -34,9 +566,9 @@ namespace CrispyOctoSpork
 		Entity(float x, float y);
 
 		/// <summary>
-		/// Default deconstructor.
+		/// Virtual deconstructor so derived entities are cleaned up properly.
 		/// </summary>
-		~Entity();
+		virtual ~Entity();
 
 		/// <summary>
 		/// Called once a frame to be overridden by derived classes.
@@ -92,822 +624,9584 @@ namespace CrispyOctoSpork
 	};
 
 	/// <summary>
-	/// The main class that games should create an instance of.
+	/// Histogram of millisecond timings using fixed one millisecond buckets.
 	/// </summary>
-	class Engine
+	class LatencyHistogram
 	{
 	public:
 		/// <summary>
 		/// Default constructor.
 		/// </summary>
-		Engine();
+		LatencyHistogram();
 
 		/// <summary>
-		/// Overridable deconstructor.
+		/// Adds a single timing to the histogram.
 		/// </summary>
-		virtual ~Engine();
+		/// <param name="milliseconds">The timing to record. Anything past the last bucket lands in the last bucket.</param>
+		void Record(float milliseconds);
 
 		/// <summary>
-		/// First thing to call after creating an instance of <see cref="Engine"/>.
+		/// Gets the upper bound of the bucket containing the given percentile.
 		/// </summary>
-		/// <param name="name">The name of the game, will be displayed in the title bar.</param>
-		/// <param name="width">The width of the screen in pixels.</param>
-		/// <param name="height">The height of the screen in pixels.</param>
-		/// <param name="vsync">Indicates if the renderer should be created with vsync on.</param>
-		/// <param name="fullscreen">Indicates if the renderer should be created with fullscreen set.</param>
-		/// <returns>Returns a boolean indicating if creation was successful.</returns>
-		bool Create(std::string name, int width, int height, bool vsync, bool fullscreen);
+		/// <param name="percentile">The percentile to look up, from 0 to 100.</param>
+		/// <returns>Returns the percentile in milliseconds, or 0 if nothing has been recorded.</returns>
+		float GetPercentile(float percentile);
 
 		/// <summary>
-		/// Called to start the game engines main game loop.
+		/// Gets the mean of every recorded timing.
 		/// </summary>
-		/// <returns>Returns a boolean indicating if there was an issue.</returns>
-		bool Start();
+		/// <returns>Returns the mean in milliseconds.</returns>
+		float GetAverage();
 
 		/// <summary>
-		/// Called once at engine startup.
+		/// Gets the number of recorded timings.
 		/// </summary>
-		/// <returns>Returns a boolean.</returns>
-		virtual bool OnCreate();
+		/// <returns>Returns the sample count.</returns>
+		int GetCount();
 
 		/// <summary>
-		/// Called once per frame after the engine is started.
+		/// Clears every bucket.
 		/// </summary>
-		/// <param name="deltaTime">The time delta from the previous frame.</param>
-		/// <returns>Returns a boolean indicating if the engine should continue running.</returns>
-		virtual bool OnUpdate(float deltaTime);
+		void Reset();
+
+		static const int BUCKET_COUNT = 512;
+
+	private:
+		int buckets[BUCKET_COUNT];
+		int count;
+		double total;
+	};
 
+	/// <summary>
+	/// Follows key presses from <see cref="SDL_PollEvent"/> through the game tick that applies them
+	/// and the <see cref="SDL_RenderPresent"/> that first shows them.
+	/// </summary>
+	class InputLatencyTracker
+	{
+	public:
 		/// <summary>
-		/// Called once per frame after update to render stuff
+		/// Default constructor.
 		/// </summary>
-		/// <param name="deltaTime">The time delta from the previous frame.</param>
-		/// <returns>Returns a boolean indicating if the engine should continue running.</returns>
-		virtual bool OnRender(float deltaTime);
-
-		virtual bool OnEvent(SDL_Event event);
+		InputLatencyTracker();
 
 		/// <summary>
-		/// Called before the engine terminates.
+		/// Starts tracking a key event as it comes out of the event queue.
 		/// </summary>
-		/// <returns>Returns a boolean.</returns>
-		virtual bool OnDestroy();
+		/// <param name="eventTimestamp">The SDL timestamp of the event, in milliseconds.</param>
+		/// <returns>Returns the ID used to follow the input through the frame.</returns>
+		Uint32 OnInputPolled(Uint32 eventTimestamp);
 
 		/// <summary>
-		/// Adds an <see cref="Entity"/> to the engines vector of entites. Will be cleaned up by the engine.
+		/// Marks an input as having changed game state. Inputs that are never applied are dropped.
 		/// </summary>
-		/// <param name="entity">The entity pointer to add to the vector.</param>
-		void AddEntity(Entity* entity);
+		/// <param name="id">The input ID.</param>
+		void OnInputApplied(Uint32 id);
 
 		/// <summary>
-		/// Draws a qaud with an optional rotation.
-		/// Realized this is kinda useless right now since SDL doesn't have a way
-		/// to actually fill in the geometry with a color.
+		/// Called once the game has finished handling the event. Drops the input if it was not applied.
 		/// </summary>
-		/// <param name="points">The array of points to draw.</param>
-		/// <param name="color">The color to make the quad</param>
-		/// <param name="rotation">The angle to rotate the quad in radians.</param>
-		void DrawQuad(SDL_FPoint* points, SDL_Color color, float rotation = 0.0);
+		/// <param name="id">The input ID.</param>
+		void OnEventDispatched(Uint32 id);
 
-	protected:
-		SDL_Window* window;
-		SDL_Renderer* renderer;
-		int screenWidth;
-		int screenHeight;
-		bool isVsyncEnabled;
-		bool isFullscreenEnabled;
-		std::string name;
-		bool isEngineRunning;
-		std::vector <Entity*> entities;
-		float lastFrameTime;
-		FrameRate frameRate;
+		/// <summary>
+		/// Marks an applied input as consumed by a game tick.
+		/// </summary>
+		/// <param name="id">The input ID.</param>
+		void OnInputTicked(Uint32 id);
 
 		/// <summary>
-		/// The main loop. To support emscripten the current <see cref="Engine"/> instance is passed in.
+		/// Called right after <see cref="SDL_RenderPresent"/>. Completes every ticked input.
 		/// </summary>
-		/// <param name="arg">A pointer to the current <see cref="Engine"/> instance.</param>
-		static void Update(void* arg);
-	};
+		void OnFramePresented();
+
+		/// <summary>
+		/// Prints the percentiles of each latency histogram.
+		/// </summary>
+		void Report();
+
+		LatencyHistogram queueing;
+		LatencyHistogram waitingForTick;
+		LatencyHistogram render;
+		LatencyHistogram total;
 
-	class SoundEffect
-	{
-	public:
-		SoundEffect();
-		~SoundEffect();
-		bool LoadSoundFromFile(const char* filepath);
-		bool PlaySound();
-		void Free();
 	private:
-		Mix_Chunk* mixChunk;
+		enum class Stage
+		{
+			NONE,
+			POLLED,
+			APPLIED,
+			TICKED
+		};
+
+		struct Sample
+		{
+			Uint32 id = 0;
+			Stage stage = Stage::NONE;
+			float queueing = 0;
+			Uint64 polledCounter = 0;
+			Uint64 tickedCounter = 0;
+		};
+
+		static const int MAX_INPUTS_IN_FLIGHT = 64;
+		Sample samples[MAX_INPUTS_IN_FLIGHT];
+		Uint32 nextId;
+		int ticksAwaitingPresent;
+
+		Sample* Find(Uint32 id);
+		static float CounterToMilliseconds(Uint64 counterDelta);
 	};
 
 	/// <summary>
-	/// An object for holding texture information and to perform basic renders of it.
+	/// Watches recent frame times against a target and picks a quality level with hysteresis,
+	/// so heavier effects are scaled back on machines that can't keep up.
 	/// </summary>
-	class Texture
+	class QualityGovernor
 	{
 	public:
 		/// <summary>
-		/// Default constructor.
+		/// Default constructor. Starts at the highest quality level.
 		/// </summary>
-		Texture();
+		QualityGovernor();
 
 		/// <summary>
-		/// Creates a new instance of <see cref="Texture"/>.
+		/// Sets the frame rate the governor tries to hold.
 		/// </summary>
-		Texture(SDL_Renderer* renderer, const char* fontFilePath = NULL, int fontSize = 0);
+		/// <param name="framesPerSecond">The target frame rate.</param>
+		void SetTargetFrameRate(int framesPerSecond);
 
 		/// <summary>
-		/// Default deconstructor.
+		/// Called once per frame with how long the frame took.
 		/// </summary>
-		~Texture();
+		/// <param name="frameTime">The full frame time in milliseconds, including waiting on present.</param>
+		/// <param name="workTime">The time spent before present in milliseconds. Used to detect headroom when vsync hides it.</param>
+		/// <returns>Returns true if the quality level changed this frame.</returns>
+		bool OnFrame(float frameTime, float workTime);
 
 		/// <summary>
-		/// Populates the <see cref="SDL_Texture"/> from a file.
+		/// Gets the current quality level, from 0 (lowest) to LEVEL_COUNT - 1 (highest).
 		/// </summary>
-		/// <param name="filepath">The file path to load an image from for the texture.</param>
-		/// <returns>Returns a boolean indicating success.</returns>
-		bool LoadTextureFromFile(const char* filepath);
+		/// <returns>Returns the quality level.</returns>
+		int GetLevel();
 
 		/// <summary>
-		/// Populates the <see cref="SDL_Texture"/> from a rendered text string.
+		/// Gets the multiplier to apply to particle spawn rates.
 		/// </summary>
-		/// <param name="text">The text to display.</param>
-		/// <param name="textColor">The color of the text.</param>
-		/// <returns>Returns a boolean indicating success.</returns>
-		bool LoadFromRenderedText(std::string text, SDL_Color textColor);
+		/// <returns>Returns a value between 0 and 1.</returns>
+		float GetParticleRateScale();
 
 		/// <summary>
-		/// Called to cleanup and free the texture.
+		/// Gets the multiplier to apply to particle caps.
 		/// </summary>
-		void Free();
+		/// <returns>Returns a value between 0 and 1.</returns>
+		float GetParticleCapScale();
 
 		/// <summary>
-		/// Renders the texture to the current <see cref="SDL_Renderer"/>.
+		/// Gets how much effect detail games should draw. 0 skips optional effects entirely.
 		/// </summary>
-		/// <param name="x">The x location to draw to.</param>
-		/// <param name="y">The y location to draw to.</param>
-		/// <param name="clip">The rectangle to pull texture information from. Useful for sprite sheets.</param>
-		/// <param name="angle">The angle at which to rotate the texture.</param>
-		/// <param name="center">The center to rotate about.</param>
-		/// <param name="flip">Determines if the texture will be flipped.</param>
-		void Render(float x, float y, SDL_Rect* clip = NULL, float angle = 0.0, SDL_FPoint* center = NULL, SDL_RendererFlip flip = SDL_FLIP_NONE, int alpha = 255);
+		/// <returns>Returns the effect detail level.</returns>
+		int GetEffectDetail();
 
 		/// <summary>
-		/// Gets the current renderer associated with this texture.
+		/// Gets how much the internal render resolution should be divided by. Every level below the highest gives up
+		/// some. It's kept a whole number so each target pixel stays a square block once presented.
 		/// </summary>
-		/// <returns>Returns a pointer to a <see cref="SDL_Renderer"/>.</returns>
-		SDL_Renderer* GetRenderer();
+		/// <returns>Returns 1 for full resolution, 2 for half and so on.</returns>
+		int GetResolutionDivisor();
 
-		int width;
-		int height;
+		bool enabled;
+
+		static const int LEVEL_COUNT = 4;
+		static const int WINDOW_SIZE = 30;
 
 	private:
-		SDL_Texture* texture;
-		SDL_Renderer* renderer;
-		TTF_Font* font;
-		int fontSize;
+		float frameTimes[WINDOW_SIZE];
+		float workTimes[WINDOW_SIZE];
+		int frameIndex;
+		int framesRecorded;
+		int framesWithHeadroom;
+		float targetFrameTime;
+		int level;
 	};
 
 	/// <summary>
-	/// Sprite class to hold an entity and a texture.
+	/// What every task of a <see cref="StartupGraph"/> or <see cref="FrameGraph"/> has, so both graphs resolve the same way.
 	/// </summary>
-	class Sprite : public Entity
+	struct GraphTask
+	{
+		std::string name;
+		std::vector<std::string> dependencyNames;
+		std::vector<int> dependencies;
+		std::vector<int> dependents;
+		bool mainThread = false;
+	};
+
+	/// <summary>
+	/// Resolves the dependency names of a graph's tasks to indices, fills in what depends on each task and checks the
+	/// graph for cycles.
+	/// </summary>
+	/// <param name="tasks">The tasks, which derive from <see cref="GraphTask"/>.</param>
+	/// <param name="kind">What a task is called in errors, like "Startup step".</param>
+	/// <returns>Returns false if a dependency is missing or the graph has a cycle.</returns>
+	template <typename T>
+	bool ResolveGraphTasks(std::vector<T>& tasks, const char* kind)
+	{
+		for (auto& task : tasks)
+		{
+			task.dependencies.clear();
+			task.dependents.clear();
+		}
+
+		for (size_t i = 0; i < tasks.size(); i++)
+		{
+			for (auto& dependencyName : tasks[i].dependencyNames)
+			{
+				int found = -1;
+
+				for (size_t j = 0; j < tasks.size(); j++)
+				{
+					if (tasks[j].name == dependencyName)
+					{
+						found = (int)j;
+						break;
+					}
+				}
+
+				if (found == -1)
+				{
+					COS_LOG_ERR("{} {} depends on {}, which doesn't exist", kind, tasks[i].name, dependencyName);
+					return false;
+				}
+
+				tasks[i].dependencies.push_back(found);
+				tasks[found].dependents.push_back((int)i);
+			}
+		}
+
+		// peel off tasks with nothing left to wait on, anything left over is part of a cycle.
+		std::vector<int> waiting(tasks.size());
+		std::vector<int> ready;
+
+		for (size_t i = 0; i < tasks.size(); i++)
+		{
+			waiting[i] = (int)tasks[i].dependencies.size();
+
+			if (waiting[i] == 0)
+			{
+				ready.push_back((int)i);
+			}
+		}
+
+		for (size_t i = 0; i < ready.size(); i++)
+		{
+			for (int dependent : tasks[ready[i]].dependents)
+			{
+				if (--waiting[dependent] == 0)
+				{
+					ready.push_back(dependent);
+				}
+			}
+		}
+
+		if (ready.size() != tasks.size())
+		{
+			COS_LOG_ERR("{}s have a dependency cycle.", kind);
+			return false;
+		}
+
+		return true;
+	}
+
+	/// <summary>
+	/// Runs named startup steps as a dependency graph. Steps that don't need the main thread
+	/// run on worker threads while the main thread works through the rest.
+	/// </summary>
+	class StartupGraph
 	{
 	public:
 		/// <summary>
 		/// Default constructor.
 		/// </summary>
-		Sprite();
+		StartupGraph();
 
 		/// <summary>
-		/// Creates a new instance of <see cref="Sprite"/>.
+		/// Adds a step to the graph.
 		/// </summary>
-		/// <param name="x">The x location of the sprite in the engine.</param>
-		/// <param name="y">The y location of the sprite in the engine.</param>
-		/// <param name="width">The width of the sprite.</param>
-		/// <param name="height">The height of the sprite.</param>
-		/// <param name="texture">A pointer to the texture to use for the sprite.</param>
-		/// <param name="renderer">A pointer to the renderer to render the sprite to.</param>
-		Sprite(float x, float y, float width, float height, Texture* texture, SDL_Renderer* renderer);
+		/// <param name="name">The unique name other steps use to depend on this one.</param>
+		/// <param name="run">The work to do. Returns false on failure, which skips everything depending on it.</param>
+		/// <param name="dependencies">The names of the steps that must finish first.</param>
+		/// <param name="mainThread">Indicates the step must run on the calling thread, like anything touching the window or renderer.</param>
+		void AddTask(std::string name, std::function<bool()> run, std::vector<std::string> dependencies = std::vector<std::string>(), bool mainThread = false);
 
 		/// <summary>
-		/// Called once per frame. Renders the sprite to its current location.
+		/// Runs every step and waits for them all to finish.
 		/// </summary>
-		/// <param name="deltaTime">The delta time since the last frame.</param>
-		/// <returns>Returns a boolean indicating success.</returns>
-		virtual bool OnRender(float deltaTime);
+		/// <returns>Returns true if every step succeeded.</returns>
+		bool Run();
 
-	protected:
-		float width;
-		float height;
-		Texture* texture;
-		SDL_Renderer* renderer;
+		/// <summary>
+		/// Prints when each step started and how long it took.
+		/// </summary>
+		void Report();
+
+	private:
+		enum class TaskState
+		{
+			PENDING,
+			RUNNING,
+			SUCCEEDED,
+			FAILED
+		};
+
+		struct Task : GraphTask
+		{
+			std::function<bool()> run;
+			TaskState state = TaskState::PENDING;
+			Uint64 startCounter = 0;
+			Uint64 endCounter = 0;
+		};
+
+		std::vector<Task> tasks;
+		Uint64 runStartCounter;
+
+		#ifdef CRISPY_OCTO_SPORK_THREADS
+		std::mutex mutex;
+		std::condition_variable taskFinished;
+		#endif
+
+		/// <summary>
+		/// Gets whether every dependency of a task has finished, marking the task failed if any of them did.
+		/// </summary>
+		/// <param name="task">The task to check.</param>
+		/// <returns>Returns true if the task is ready to run or has just been failed.</returns>
+		bool DependenciesFinished(Task& task);
 
+		/// <summary>
+		/// Runs a single task and records its timings.
+		/// </summary>
+		/// <param name="task">The task to run.</param>
+		void Execute(Task& task);
 	};
 
 	/// <summary>
-	/// Class to hold an entity represented by a rectangle.
+	/// Runs the work of a frame as a graph of named tasks, declared once and run every frame. Tasks that aren't pinned
+	/// to the main thread go to a pool of workers that each keep their own queue and steal from the others when theirs
+	/// runs dry, while the main thread runs the pinned tasks in order as they become ready. A few frames can be traced
+	/// to a file that chrome://tracing or Perfetto will open, showing every task on its thread and what it waited on.
 	/// </summary>
-	class Rectangle : public Entity
+	class FrameGraph
 	{
 	public:
 		/// <summary>
 		/// Default constructor.
 		/// </summary>
-		Rectangle();
+		FrameGraph();
 
 		/// <summary>
-		/// Creates a new instance of <see cref="Rectangle"/>.
+		/// Stops the workers.
 		/// </summary>
-		/// <param name="x">The x location of the rectangle in the engine.</param>
-		/// <param name="y">The y location of the rectangle in the engine.</param>
-		/// <param name="width">The width of the rectangle.</param>
-		/// <param name="height">The height of the rectangle.</param>
-		/// <param name="color">The color to draw the rectangle with.</param>
-		/// <param name="renderer">A pointer to the renderer to render the rectangle to.</param>
-		Rectangle(float x, float y, float width, float height, SDL_Color color, SDL_Renderer* renderer);
+		~FrameGraph();
 
 		/// <summary>
-		/// Called once per frame. Renders the rectangle to its current location.
+		/// Adds a task to the graph. Has to be called from the main thread, and a task added while a frame is running,
+		/// like from a scene's update, only runs from the next frame on.
 		/// </summary>
-		/// <param name="deltaTime">The delta time since the last frame.</param>
-		/// <returns>Returns a boolean indicating success.</returns>
-		virtual bool OnRender(float deltaTime);
+		/// <param name="name">The unique name other tasks use to depend on this one.</param>
+		/// <param name="run">The work to do.</param>
+		/// <param name="dependencies">The names of the tasks that must finish first, each frame.</param>
+		/// <param name="mainThread">Indicates the task must run on the main thread, like anything touching the window, renderer or scenes.</param>
+		void AddTask(std::string name, std::function<void()> run, std::vector<std::string> dependencies = std::vector<std::string>(), bool mainThread = false);
 
-	protected:
-		float width;
-		float height;
-		SDL_Color color;
-		SDL_Renderer* renderer;
-	};
+		/// <summary>
+		/// Makes an existing task wait on another, like the engines render task on a games own worker task. Like
+		/// <see cref="AddTask"/>, it's for the main thread and waits for the next frame if one is running.
+		/// </summary>
+		/// <param name="name">The task that has to wait.</param>
+		/// <param name="dependency">The task it waits on.</param>
+		void AddDependency(const std::string& name, const std::string& dependency);
 
-	/// <summary>
-	/// Class to hold an entity represented by a circle.
-	/// </summary>
-	class Circle : public Entity
-	{
-	public:
 		/// <summary>
-		/// Default constructor.
+		/// Sets how many worker threads run the tasks that aren't pinned. Takes effect when the workers are next started,
+		/// which is the first frame with a worker task in it. 0 runs everything on the main thread.
 		/// </summary>
-		Circle();
+		/// <param name="count">The number of workers.</param>
+		void SetWorkerCount(int count);
 
 		/// <summary>
-		/// Creates a new instance of <see cref="Circle"/>.
+		/// Runs every task once, returning when they have all finished. Has to be called from the main thread.
 		/// </summary>
-		/// <param name="x">The x location of the center of the circle.</param>
-		/// <param name="y">The y location of the center of the circle.</param>
-		/// <param name="radius">The radius of the circle</param>
-		/// <param name="color">The color to draw the circle with.</param>
-		/// <param name="renderer">A pointer to the renderer to render the circle to.</param>
-		Circle(float x, float y, float radius, SDL_Color color, SDL_Renderer* renderer);
+		void Run();
 
 		/// <summary>
-		/// Called once per frame. Renders the circle to its current location.
+		/// Records the next few frames and writes them out as a chrome trace once they're done.
 		/// </summary>
-		/// <param name="deltaTime">The delta time since the last frame.</param>
-		/// <returns>Returns a boolean indicating success.</returns>
-		virtual bool OnRender(float deltaTime);
+		/// <param name="filepath">The file to write.</param>
+		/// <param name="frames">The number of frames to record.</param>
+		void BeginTrace(const std::string& filepath, Uint32 frames);
 
-	protected:
-		float radius;
-		SDL_Color color;
-		SDL_Renderer* renderer;
+		/// <summary>
+		/// Stops the workers. They start again on the next frame that needs them.
+		/// </summary>
+		void Shutdown();
+
+	private:
+		struct Task : GraphTask
+		{
+			std::function<void()> run;
+			Uint64 startCounter = 0;
+			Uint64 endCounter = 0;
+			// 0 is the main thread, workers count up from 1.
+			int thread = 0;
+		};
+
+		struct TraceEvent
+		{
+			Uint32 frame;
+			int task;
+			int thread;
+			Uint64 startCounter;
+			Uint64 endCounter;
+		};
+
+		std::vector<Task> tasks;
+		std::unique_ptr<std::atomic<int>[]> waitingOn;
+		std::atomic<int> remainingTasks;
+		std::deque<int> mainTasks;
+		bool resolved;
+		bool broken;
+		bool runningFrame;
+		int workerCount;
+
+		// changes made while a frame is running, which can't touch the graph the workers are reading.
+		std::vector<Task> addedTasks;
+		std::vector<std::pair<std::string, std::string>> addedDependencies;
+
+		std::string tracePath;
+		Uint32 traceFramesLeft;
+		Uint32 tracedFrames;
+		Uint64 traceStartCounter;
+		std::vector<TraceEvent> traceEvents;
+
+		#ifdef CRISPY_OCTO_SPORK_THREADS
+		struct WorkerQueue
+		{
+			std::mutex mutex;
+			std::deque<int> tasks;
+		};
+
+		std::vector<std::thread> workers;
+		std::vector<std::unique_ptr<WorkerQueue>> queues;
+		std::atomic<int> queuedTasks;
+		std::atomic<Uint32> nextQueue;
+		std::mutex sleepMutex;
+		std::condition_variable workAdded;
+		std::condition_variable mainWoken;
+		bool running;
+
+		/// <summary>
+		/// Starts the workers if there's a task for them and they aren't running.
+		/// </summary>
+		void StartWorkers();
+
+		/// <summary>
+		/// Runs tasks from a workers own queue, then stolen ones, sleeping when there are none anywhere.
+		/// </summary>
+		/// <param name="queue">The index of the workers queue.</param>
+		void WorkerLoop(int queue);
+
+		/// <summary>
+		/// Takes a task off the back of a queue, or the front of any other.
+		/// </summary>
+		/// <param name="queue">The queue to look in first.</param>
+		/// <returns>Returns the task, or -1 if every queue is empty.</returns>
+		int TakeTask(int queue);
+		#endif
+
+		/// <summary>
+		/// Resolves dependency names and checks the graph for cycles.
+		/// </summary>
+		/// <returns>Returns false if a dependency is missing or the graph has a cycle.</returns>
+		bool Resolve();
+
+		/// <summary>
+		/// Adds the tasks and dependencies that came in while the last frame was running.
+		/// </summary>
+		void ApplyAdditions();
+
+		/// <summary>
+		/// Hands a task whose dependencies have all finished to whichever thread should run it.
+		/// </summary>
+		/// <param name="task">The task.</param>
+		/// <param name="queue">The queue of the worker that readied it, or -1 from the main thread.</param>
+		void Push(int task, int queue);
+
+		/// <summary>
+		/// Runs a task, records its timings and readies anything that was only waiting on it.
+		/// </summary>
+		/// <param name="task">The task.</param>
+		/// <param name="queue">The queue of the worker running it, or -1 on the main thread.</param>
+		void Execute(int task, int queue);
+
+		/// <summary>
+		/// Writes the recorded frames out in the chrome trace event format.
+		/// </summary>
+		void WriteTrace();
+
+		/// <summary>
+		/// Escapes text to go between quotes in json.
+		/// </summary>
+		static std::string EscapeJson(const std::string& text);
 	};
 
 	/// <summary>
-	/// Struct used to contain a single particle of a <see cref="ParticleEmitter"/>.
+	/// Refers to an object in an <see cref="ObjectPool"/>. Once the object is destroyed its slot gets a new
+	/// generation, so old handles resolve to NULL instead of to whatever reuses the slot.
 	/// </summary>
-	struct Particle
+	template <typename T>
+	struct Handle
 	{
-		float x = 0;
-		float y = 0;
-		float xVelocity = 0;
-		float yVelocity = 0;
-		float totalLifeTime = 0;
-		float lifeTimeRemaining = 0;
-		bool active = false;
+		Uint32 index = 0;
+		Uint32 generation = 0;
+
+		/// <summary>
+		/// Gets whether the handle was ever assigned.
+		/// </summary>
+		/// <returns>Returns true for a default constructed handle.</returns>
+		bool IsNull() const
+		{
+			return generation == 0;
+		}
 	};
 
-	class ParticleEmitter
+	/// <summary>
+	/// Typed object pool that allocates in slabs and recycles slots through a free list,
+	/// so creating and destroying objects never goes to the heap once it has warmed up.
+	/// Live objects are kept in a dense list for fast iteration.
+	/// </summary>
+	template <typename T>
+	class ObjectPool
 	{
 	public:
-		ParticleEmitter();
-		~ParticleEmitter();
-		ParticleEmitter(float x, float y, float lifeInSeconds, Texture* texture, float speed = 0.5, int newParticlesPerSecond = 5, float startSizeMultiplier = 1.0, float endSizeMultiplier = 0.0, int maxParticles = 20000);
-		void OnUpdate(float deltaTime);
-		void OnRender();
-		bool active;
-		int newParticlesPerSecond;
-		float startOfSecond;
-		float particlesCreatedThisSecond;
-	private:
-		float x;
-		float y;
-		float lifeInMiliseconds;
-		Texture* texture;
-		float startSizeMultiplier = 1.0;
-		float endSizeMultiplier = 1.0;
-		float speed;
-		Particle* particlePool;
-		int currentParticlePoolIndex = 0;
-		int maxParticles;
+		static const Uint32 SLAB_SIZE = 256;
+
+		/// <summary>
+		/// Default constructor. Nothing is allocated until the first object is created.
+		/// </summary>
+		ObjectPool() : freeHead(NO_SLOT), capacity(0), iterating(0)
+		{}
+
+		/// <summary>
+		/// Destroys every live object and frees the slabs.
+		/// </summary>
+		~ObjectPool()
+		{
+			DestroyAll();
+
+			for (Slot* slab : slabs)
+			{
+				MemoryTracker::Get().Free(slab);
+			}
+		}
+
+		/// <summary>
+		/// Makes sure there is room for at least this many objects without allocating later.
+		/// </summary>
+		/// <param name="count">The number of objects to make room for.</param>
+		void Reserve(Uint32 count)
+		{
+			while (capacity < count)
+			{
+				AddSlab();
+			}
+		}
+
+		/// <summary>
+		/// Constructs a new object in a free slot.
+		/// </summary>
+		/// <param name="arguments">The arguments to pass to the constructor.</param>
+		/// <returns>Returns a handle to the new object.</returns>
+		template <typename... Arguments>
+		Handle<T> Create(Arguments&&... arguments)
+		{
+			if (freeHead == NO_SLOT)
+			{
+				AddSlab();
+			}
+
+			Uint32 index = freeHead;
+			Slot* slot = GetSlot(index);
+			freeHead = slot->nextFree;
+
+			new (slot->storage) T(std::forward<Arguments>(arguments)...);
+			slot->alive = true;
+			slot->denseIndex = (Uint32)live.size();
+			live.push_back(index);
+
+			Handle<T> handle;
+			handle.index = index;
+			handle.generation = slot->generation;
+			return handle;
+		}
+
+		/// <summary>
+		/// Destroys the object a handle refers to and recycles its slot. Inside <see cref="ForEach"/> the object is
+		/// destroyed straight away, but the slot isn't recycled until the pass is over.
+		/// </summary>
+		/// <param name="handle">The handle of the object.</param>
+		/// <returns>Returns false if the handle was stale.</returns>
+		bool Destroy(Handle<T> handle)
+		{
+			Slot* slot = Resolve(handle);
+
+			if (slot == NULL)
+			{
+				return false;
+			}
+
+			((T*)slot->storage)->~T();
+			slot->alive = false;
+
+			// skip 0 when wrapping so a recycled slot never matches a null handle.
+			slot->generation++;
+			if (slot->generation == 0)
+			{
+				slot->generation = 1;
+			}
+
+			// moving things around in the dense list would make a pass in progress skip or repeat objects.
+			if (iterating > 0)
+			{
+				retired.push_back(handle.index);
+			}
+			else
+			{
+				Recycle(handle.index);
+			}
+
+			return true;
+		}
+
+		/// <summary>
+		/// Gets the object a handle refers to.
+		/// </summary>
+		/// <param name="handle">The handle of the object.</param>
+		/// <returns>Returns the object, or NULL if it has been destroyed.</returns>
+		T* Get(Handle<T> handle)
+		{
+			Slot* slot = Resolve(handle);
+			return slot == NULL ? NULL : (T*)slot->storage;
+		}
+
+		/// <summary>
+		/// Calls a function for every live object. The function may destroy any object, which is skipped if it
+		/// hasn't been reached yet, and may create new ones, which aren't visited until the next pass.
+		/// </summary>
+		/// <param name="function">The function to call with a reference to each object.</param>
+		template <typename Function>
+		void ForEach(Function function)
+		{
+			iterating++;
+
+			// the dense list only grows during a pass, so anything created by the function is past the end.
+			size_t count = live.size();
+
+			for (size_t i = 0; i < count; i++)
+			{
+				Slot* slot = GetSlot(live[i]);
+
+				if (slot->alive)
+				{
+					function(*(T*)slot->storage);
+				}
+			}
+
+			iterating--;
+
+			if (iterating == 0)
+			{
+				for (Uint32 index : retired)
+				{
+					Recycle(index);
+				}
+
+				retired.clear();
+			}
+		}
+
+		/// <summary>
+		/// Destroys every live object.
+		/// </summary>
+		void DestroyAll()
+		{
+			for (size_t i = live.size(); i > 0; i--)
+			{
+				Slot* slot = GetSlot(live[i - 1]);
+
+				if (slot->alive)
+				{
+					Handle<T> handle;
+					handle.index = live[i - 1];
+					handle.generation = slot->generation;
+					Destroy(handle);
+				}
+			}
+		}
+
+		/// <summary>
+		/// Gets the number of live objects.
+		/// </summary>
+		/// <returns>Returns the count.</returns>
+		Uint32 GetCount()
+		{
+			return (Uint32)(live.size() - retired.size());
+		}
+
+	private:
+		static const Uint32 NO_SLOT = 0xFFFFFFFF;
+
+		struct Slot
+		{
+			alignas(T) unsigned char storage[sizeof(T)];
+			Uint32 generation;
+			Uint32 nextFree;
+			Uint32 denseIndex;
+			bool alive;
+		};
+
+		std::vector<Slot*, TaggedAllocator<Slot*, MemoryTag::ENTITIES>> slabs;
+		std::vector<Uint32, TaggedAllocator<Uint32, MemoryTag::ENTITIES>> live;
+		// destroyed during a pass, still in the dense list until it ends.
+		std::vector<Uint32, TaggedAllocator<Uint32, MemoryTag::ENTITIES>> retired;
+		Uint32 freeHead;
+		Uint32 capacity;
+		Uint32 iterating;
+
+		Slot* GetSlot(Uint32 index)
+		{
+			return &slabs[index / SLAB_SIZE][index % SLAB_SIZE];
+		}
+
+		/// <summary>
+		/// Takes a destroyed slot out of the dense list and puts it on the free list.
+		/// </summary>
+		void Recycle(Uint32 index)
+		{
+			Slot* slot = GetSlot(index);
+
+			// swap the last live object into the hole so the dense list stays packed.
+			Uint32 lastIndex = live.back();
+			live[slot->denseIndex] = lastIndex;
+			GetSlot(lastIndex)->denseIndex = slot->denseIndex;
+			live.pop_back();
+
+			slot->nextFree = freeHead;
+			freeHead = index;
+		}
+
+		Slot* Resolve(Handle<T> handle)
+		{
+			if (handle.IsNull() || handle.index >= capacity)
+			{
+				return NULL;
+			}
+
+			Slot* slot = GetSlot(handle.index);
+			return slot->alive && slot->generation == handle.generation ? slot : NULL;
+		}
+
+		void AddSlab()
+		{
+			Slot* slab = (Slot*)MemoryTracker::Get().Allocate(sizeof(Slot) * SLAB_SIZE, MemoryTag::ENTITIES);
+
+			if (slab == NULL)
+			{
+				throw std::bad_alloc();
+			}
+
+			// thread the new slots onto the front of the free list, lowest index first.
+			for (Uint32 i = SLAB_SIZE; i > 0; i--)
+			{
+				Slot* slot = &slab[i - 1];
+				slot->generation = 1;
+				slot->alive = false;
+				slot->denseIndex = 0;
+				slot->nextFree = freeHead;
+				freeHead = capacity + i - 1;
+			}
+
+			slabs.push_back(slab);
+			capacity += SLAB_SIZE;
+			live.reserve(capacity);
+		}
+	};
+
+	/// <summary>
+	/// Type erased view of an engine owned pool of entities so the engine can update and render them.
+	/// </summary>
+	class EntityPoolBase
+	{
+	public:
+		virtual ~EntityPoolBase()
+		{}
+
+		virtual void UpdateAll(float deltaTime) = 0;
+		virtual void RenderAll(float deltaTime) = 0;
+		virtual void DestroyAll() = 0;
+	};
+
+	/// <summary>
+	/// An <see cref="ObjectPool"/> of a single <see cref="Entity"/> type.
+	/// </summary>
+	template <typename T>
+	class EntityPool : public EntityPoolBase
+	{
+	public:
+		ObjectPool<T> pool;
+
+		void UpdateAll(float deltaTime) override
+		{
+			pool.ForEach([deltaTime](T& entity) { entity.OnUpdate(deltaTime); });
+		}
+
+		void RenderAll(float deltaTime) override
+		{
+			pool.ForEach([deltaTime](T& entity) { entity.OnRender(deltaTime); });
+		}
+
+		void DestroyAll() override
+		{
+			pool.DestroyAll();
+		}
+	};
+
+	/// <summary>
+	/// Bump allocator for things that all die together, like everything belonging to one match.
+	/// Allocating is a pointer bump, and <see cref="Reset"/> frees the lot in one go while keeping the
+	/// memory around for the next user. Destructors are never run, so only put trivially destructible things in it.
+	/// </summary>
+	class Arena
+	{
+	public:
+		/// <summary>
+		/// Constructor.
+		/// </summary>
+		/// <param name="blockSize">How much memory to get from the <see cref="MemoryTracker"/> at a time.</param>
+		/// <param name="tag">The tag the memory is charged to.</param>
+		Arena(size_t blockSize = 16384, MemoryTag tag = MemoryTag::GENERAL);
+
+		/// <summary>
+		/// Frees every block.
+		/// </summary>
+		~Arena();
+
+		Arena(const Arena&) = delete;
+		Arena& operator=(const Arena&) = delete;
+
+		/// <summary>
+		/// Allocates memory that lives until the arena is reset.
+		/// </summary>
+		/// <param name="size">The number of bytes.</param>
+		/// <param name="alignment">The alignment, a power of two.</param>
+		/// <returns>Returns the memory, or NULL if the allocation failed.</returns>
+		void* Allocate(size_t size, size_t alignment = alignof(std::max_align_t));
+
+		/// <summary>
+		/// Constructs an object in the arena.
+		/// </summary>
+		/// <param name="arguments">The arguments to pass to its constructor.</param>
+		/// <returns>Returns the object, or NULL if the allocation failed.</returns>
+		template <typename T, typename... Arguments>
+		T* New(Arguments&&... arguments)
+		{
+			static_assert(std::is_trivially_destructible<T>::value, "Arena objects never have their destructors run.");
+
+			void* memory = Allocate(sizeof(T), alignof(T));
+			return memory != NULL ? new (memory) T(std::forward<Arguments>(arguments)...) : NULL;
+		}
+
+		/// <summary>
+		/// Frees everything allocated so far. The blocks are kept for reuse.
+		/// </summary>
+		void Reset();
+
+		/// <summary>
+		/// Gets the number of bytes handed out since the last reset.
+		/// </summary>
+		/// <returns>Returns the byte count.</returns>
+		size_t GetBytesUsed();
+
+	private:
+		struct Block
+		{
+			Block* next;
+			size_t size;
+		};
+
+		Block* blocks;
+		Block* current;
+		size_t offset;
+		size_t blockSize;
+		size_t bytesUsed;
+		MemoryTag tag;
+	};
+
+	#ifdef CRISPY_OCTO_SPORK_COROUTINES
+	/// <summary>
+	/// Recycles coroutine frames so starting a <see cref="Coroutine"/> doesn't touch the heap once the game is warmed up.
+	/// Frames are bucketed by size and kept on free lists. Only use coroutines from the main thread.
+	/// </summary>
+	class CoroutineFrameAllocator
+	{
+	public:
+		/// <summary>
+		/// Gets the allocator every coroutine frame comes from.
+		/// </summary>
+		/// <returns>Returns the allocator.</returns>
+		static CoroutineFrameAllocator& Get();
+
+		/// <summary>
+		/// Gets a frame from the pool, only allocating if there isn't one free of the right size.
+		/// </summary>
+		/// <param name="size">The size of the frame in bytes.</param>
+		/// <returns>Returns the frame.</returns>
+		void* Allocate(size_t size);
+
+		/// <summary>
+		/// Returns a frame to the pool.
+		/// </summary>
+		/// <param name="pointer">The frame.</param>
+		/// <param name="size">The size the frame was allocated with.</param>
+		void Free(void* pointer, size_t size);
+
+		/// <summary>
+		/// Releases every pooled frame that isn't in use back to the <see cref="MemoryTracker"/>.
+		/// </summary>
+		void Trim();
+
+	private:
+		static const size_t GRANULARITY = 64;
+		static const int SIZE_CLASSES = 16;
+
+		struct FreeFrame
+		{
+			FreeFrame* next;
+		};
+
+		FreeFrame* freeLists[SIZE_CLASSES];
+
+		CoroutineFrameAllocator();
+	};
+
+	class CoroutineScheduler;
+
+	/// <summary>
+	/// A task written as a C++20 coroutine, so timed sequences can be written top to bottom with co_await
+	/// instead of accumulators. Hand it to <see cref="Engine::StartCoroutine"/> to run it.
+	/// </summary>
+	class Coroutine
+	{
+	public:
+		struct promise_type
+		{
+			CoroutineScheduler* scheduler = NULL;
+			Uint32 wakeFrame = 0;
+			Uint32 wakeTime = 0;
+			bool (*condition)(void*) = NULL;
+			void* conditionState = NULL;
+
+			Coroutine get_return_object()
+			{
+				return Coroutine(std::coroutine_handle<promise_type>::from_promise(*this));
+			}
+
+			std::suspend_always initial_suspend() noexcept
+			{
+				return {};
+			}
+
+			std::suspend_always final_suspend() noexcept
+			{
+				return {};
+			}
+
+			void return_void()
+			{}
+
+			void unhandled_exception()
+			{
+				std::terminate();
+			}
+
+			static void* operator new(size_t size)
+			{
+				return CoroutineFrameAllocator::Get().Allocate(size);
+			}
+
+			static void operator delete(void* pointer, size_t size)
+			{
+				CoroutineFrameAllocator::Get().Free(pointer, size);
+			}
+		};
+
+		Coroutine(Coroutine&& other) noexcept : handle(other.handle)
+		{
+			other.handle = NULL;
+		}
+
+		Coroutine(const Coroutine&) = delete;
+		Coroutine& operator=(const Coroutine&) = delete;
+
+		~Coroutine()
+		{
+			if (handle)
+			{
+				handle.destroy();
+			}
+		}
+
+		/// <summary>
+		/// Gives up ownership of the coroutine, used by the <see cref="CoroutineScheduler"/>.
+		/// </summary>
+		/// <returns>Returns the coroutine handle.</returns>
+		std::coroutine_handle<promise_type> Release()
+		{
+			std::coroutine_handle<promise_type> released = handle;
+			handle = NULL;
+			return released;
+		}
+
+	private:
+		std::coroutine_handle<promise_type> handle;
+
+		explicit Coroutine(std::coroutine_handle<promise_type> handle) : handle(handle)
+		{}
 	};
 
-	Engine::Engine()
+	/// <summary>
+	/// Resumes coroutines once per frame when whatever they are waiting on has happened.
+	/// </summary>
+	class CoroutineScheduler
+	{
+	public:
+		/// <summary>
+		/// Default constructor.
+		/// </summary>
+		CoroutineScheduler();
+
+		/// <summary>
+		/// Destroys any coroutines still running.
+		/// </summary>
+		~CoroutineScheduler();
+
+		/// <summary>
+		/// Takes ownership of a coroutine and runs it up to its first co_await.
+		/// </summary>
+		/// <param name="coroutine">The coroutine.</param>
+		/// <returns>Returns an ID for stopping the coroutine, or 0 if it finished straight away.</returns>
+		Uint32 Start(Coroutine coroutine);
+
+		/// <summary>
+		/// Destroys a coroutine without resuming it again.
+		/// </summary>
+		/// <param name="id">The ID returned by <see cref="Start"/>.</param>
+		/// <returns>Returns false if the coroutine already finished.</returns>
+		bool Stop(Uint32 id);
+
+		/// <summary>
+		/// Destroys every running coroutine.
+		/// </summary>
+		void StopAll();
+
+		/// <summary>
+		/// Gets whether a coroutine is still running.
+		/// </summary>
+		/// <param name="id">The ID returned by <see cref="Start"/>.</param>
+		/// <returns>Returns a boolean.</returns>
+		bool IsRunning(Uint32 id);
+
+		/// <summary>
+		/// Advances a frame and resumes every coroutine that's ready.
+		/// </summary>
+		/// <param name="now">The current time in milliseconds.</param>
+		void Update(Uint32 now);
+
+		/// <summary>
+		/// Gets the number of frames this scheduler has run.
+		/// </summary>
+		/// <returns>Returns the frame number.</returns>
+		Uint32 GetFrame();
+
+		/// <summary>
+		/// Gets the time passed to the last <see cref="Update"/>.
+		/// </summary>
+		/// <returns>Returns the time in milliseconds.</returns>
+		Uint32 GetTime();
+
+	private:
+		struct RunningCoroutine
+		{
+			Uint32 id;
+			std::coroutine_handle<Coroutine::promise_type> handle;
+			bool stopped;
+		};
+
+		std::vector<RunningCoroutine> running;
+		Uint32 nextId;
+		Uint32 frame;
+		Uint32 time;
+		bool updating;
+
+		bool IsReady(Coroutine::promise_type& promise);
+		void Resume(size_t index);
+		void RemoveFinished();
+	};
+
+	/// <summary>
+	/// Awaitable that resumes a coroutine a number of frames later.
+	/// </summary>
+	struct FrameAwaiter
+	{
+		Uint32 frames;
+
+		bool await_ready() const noexcept
+		{
+			return frames == 0;
+		}
+
+		void await_suspend(std::coroutine_handle<Coroutine::promise_type> handle) noexcept
+		{
+			Coroutine::promise_type& promise = handle.promise();
+			promise.wakeFrame = promise.scheduler->GetFrame() + frames;
+			promise.wakeTime = promise.scheduler->GetTime();
+			promise.condition = NULL;
+		}
+
+		void await_resume() noexcept
+		{}
+	};
+
+	/// <summary>
+	/// Awaitable that resumes a coroutine on the first frame after some time has passed.
+	/// </summary>
+	struct TimeAwaiter
+	{
+		Uint32 milliseconds;
+
+		bool await_ready() const noexcept
+		{
+			return false;
+		}
+
+		void await_suspend(std::coroutine_handle<Coroutine::promise_type> handle) noexcept
+		{
+			Coroutine::promise_type& promise = handle.promise();
+			promise.wakeFrame = promise.scheduler->GetFrame() + 1;
+			promise.wakeTime = SDL_GetTicks() + milliseconds;
+			promise.condition = NULL;
+		}
+
+		void await_resume() noexcept
+		{}
+	};
+
+	/// <summary>
+	/// Awaitable that resumes a coroutine on the first frame a condition is true. The condition lives in
+	/// the coroutine frame, so waiting on it doesn't allocate.
+	/// </summary>
+	template <typename Condition>
+	struct ConditionAwaiter
+	{
+		Condition condition;
+
+		bool await_ready()
+		{
+			return condition();
+		}
+
+		void await_suspend(std::coroutine_handle<Coroutine::promise_type> handle) noexcept
+		{
+			Coroutine::promise_type& promise = handle.promise();
+			promise.condition = [](void* state) { return (*(Condition*)state)(); };
+			promise.conditionState = &condition;
+		}
+
+		void await_resume() noexcept
+		{}
+	};
+
+	/// <summary>
+	/// co_await to resume on the next frame.
+	/// </summary>
+	/// <returns>Returns the awaitable.</returns>
+	inline FrameAwaiter NextFrame()
+	{
+		return { 1 };
+	}
+
+	/// <summary>
+	/// co_await to resume a number of frames later.
+	/// </summary>
+	/// <param name="frames">The number of frames to wait.</param>
+	/// <returns>Returns the awaitable.</returns>
+	inline FrameAwaiter WaitForFrames(Uint32 frames)
+	{
+		return { frames };
+	}
+
+	/// <summary>
+	/// co_await to resume once some time has passed.
+	/// </summary>
+	/// <param name="milliseconds">The time to wait.</param>
+	/// <returns>Returns the awaitable.</returns>
+	inline TimeAwaiter WaitForMilliseconds(Uint32 milliseconds)
+	{
+		return { milliseconds };
+	}
+
+	/// <summary>
+	/// co_await to resume once a condition is true, checked once per frame.
+	/// </summary>
+	/// <param name="condition">A callable returning bool.</param>
+	/// <returns>Returns the awaitable.</returns>
+	template <typename Condition>
+	ConditionAwaiter<Condition> WaitUntil(Condition condition)
+	{
+		return { std::move(condition) };
+	}
+	#endif
+
+	/// <summary>
+	/// Counts of the calls made through a <see cref="Renderer"/> since the stats were last reset.
+	/// </summary>
+	struct RenderStats
+	{
+		Uint32 draws;
+		Uint32 stateChanges;
+		// state changes that matched what was already set, so never reached SDL.
+		Uint32 skippedStateChanges;
+		Uint32 textureUploads;
+		Uint32 presents;
+	};
+
+	/// <summary>
+	/// The engines wrapper around <see cref="SDL_Renderer"/>. Everything the engine draws goes through it, so it can
+	/// run as a null backend that accepts every call without a window, and optionally count what it was asked to do.
+	/// It also remembers the draw color, blend mode, target, scale and each textures mods, and drops any state change
+	/// that wouldn't change anything.
+	/// </summary>
+	class Renderer
+	{
+	public:
+		/// <summary>
+		/// Default constructor.
+		/// </summary>
+		Renderer();
+
+		/// <summary>
+		/// Destroys the <see cref="SDL_Renderer"/> if there is one and this created it.
+		/// </summary>
+		~Renderer();
+
+		/// <summary>
+		/// Gets the wrapper for an <see cref="SDL_Renderer"/>, so code written against the old constructors that took
+		/// one still works. A renderer made through <see cref="Create"/> gives back its own wrapper, any other gets one
+		/// made for it that lives until the program exits and never destroys it.
+		/// </summary>
+		/// <param name="renderer">The renderer.</param>
+		/// <returns>Returns the wrapper, or NULL if the renderer is NULL.</returns>
+		static Renderer* FromSDLRenderer(SDL_Renderer* renderer);
+
+		/// <summary>
+		/// Creates a real renderer for a window.
+		/// </summary>
+		/// <param name="window">The window to render to.</param>
+		/// <param name="flags">The <see cref="SDL_RendererFlags"/> to create it with.</param>
+		/// <returns>Returns a boolean indicating success.</returns>
+		bool Create(SDL_Window* window, Uint32 flags);
+
+		/// <summary>
+		/// Makes this a null renderer. Textures are still decoded so their sizes are right, but nothing reaches the GPU.
+		/// </summary>
+		/// <param name="width">The output size to report.</param>
+		/// <param name="height">The output size to report.</param>
+		void CreateNull(int width, int height);
+
+		/// <summary>
+		/// Gets whether this is a null renderer.
+		/// </summary>
+		/// <returns>Returns a boolean.</returns>
+		bool IsNull();
+
+		/// <summary>
+		/// Turns counting of calls on or off.
+		/// </summary>
+		/// <param name="enabled">Whether to count.</param>
+		void SetCallCounting(bool enabled);
+
+		/// <summary>
+		/// Gets the call counts.
+		/// </summary>
+		/// <returns>Returns the counts.</returns>
+		RenderStats GetStats();
+
+		/// <summary>
+		/// Zeroes the call counts.
+		/// </summary>
+		void ResetStats();
+
+		/// <summary>
+		/// Gets the number of frames presented so far, for stamping when something was last drawn.
+		/// </summary>
+		/// <returns>Returns the frame number.</returns>
+		Uint32 GetFrame();
+
+		/// <summary>
+		/// Gets the wrapped renderer for anything the wrapper doesn't cover. Call <see cref="InvalidateStateCache"/>
+		/// after changing state on it directly.
+		/// </summary>
+		/// <returns>Returns the renderer, or NULL for a null renderer.</returns>
+		SDL_Renderer* GetSDLRenderer();
+
+		/// <summary>
+		/// Forgets all the remembered state, so the next change of each kind goes through to SDL.
+		/// </summary>
+		void InvalidateStateCache();
+
+		/// <summary>
+		/// Gets the pixel format the renderer lists first for textures, which it takes without converting.
+		/// </summary>
+		/// <returns>Returns the format, ARGB8888 for a null renderer.</returns>
+		Uint32 GetNativeTextureFormat();
+
+		/// <summary>
+		/// Gets whether the renderer takes textures in a pixel format without SDL converting every upload.
+		/// </summary>
+		/// <param name="format">The <see cref="SDL_PixelFormatEnum"/>.</param>
+		/// <returns>Returns true for any format on a null renderer.</returns>
+		bool SupportsTextureFormat(Uint32 format);
+
+		/// <summary>
+		/// Gets the first texture format of the render driver SDL tries first, without needing a window, so offline
+		/// tools can bake for the renderer the game will most likely get.
+		/// </summary>
+		/// <returns>Returns the format, or ARGB8888 if the driver doesn't list a plain packed one first.</returns>
+		static Uint32 GetDefaultNativeTextureFormat();
+
+		SDL_Texture* CreateTexture(Uint32 format, int access, int width, int height);
+		SDL_Texture* CreateTextureFromSurface(SDL_Surface* surface);
+
+		/// <summary>
+		/// Decodes an image and creates a texture from it.
+		/// </summary>
+		/// <param name="source">The image data, closed by this call.</param>
+		/// <param name="width">Set to the width of the texture.</param>
+		/// <param name="height">Set to the height of the texture.</param>
+		/// <returns>Returns the texture, or NULL on failure.</returns>
+		SDL_Texture* LoadTexture(SDL_RWops* source, int* width, int* height);
+
+		void DestroyTexture(SDL_Texture* texture);
+		int UpdateTexture(SDL_Texture* texture, const SDL_Rect* rect, const void* pixels, int pitch);
+
+		/// <summary>
+		/// Locks part of a streaming texture for writing. The pixels are write only, every one in the rect has to be
+		/// written before <see cref="UnlockTexture"/> uploads them. A null renderer hands out scratch memory instead,
+		/// at four bytes per pixel, so it needs the rect.
+		/// </summary>
+		/// <param name="texture">The texture, created with <see cref="SDL_TEXTUREACCESS_STREAMING"/>.</param>
+		/// <param name="rect">The area to lock, or NULL for all of it.</param>
+		/// <param name="pixels">Set to the first pixel of the area.</param>
+		/// <param name="pitch">Set to the bytes between rows.</param>
+		/// <returns>Returns 0 on success.</returns>
+		int LockTexture(SDL_Texture* texture, const SDL_Rect* rect, void** pixels, int* pitch);
+		void UnlockTexture(SDL_Texture* texture);
+
+		int SetTextureAlphaMod(SDL_Texture* texture, Uint8 alpha);
+		int SetTextureColorMod(SDL_Texture* texture, Uint8 r, Uint8 g, Uint8 b);
+		int SetTextureBlendMode(SDL_Texture* texture, SDL_BlendMode blendMode);
+		int SetTextureScaleMode(SDL_Texture* texture, SDL_ScaleMode scaleMode);
+
+		int SetDrawColor(Uint8 r, Uint8 g, Uint8 b, Uint8 a);
+		int SetDrawBlendMode(SDL_BlendMode blendMode);
+		int SetTarget(SDL_Texture* texture);
+		int SetScale(float scaleX, float scaleY);
+		int SetClipRect(const SDL_Rect* rect);
+		int GetOutputSize(int* width, int* height);
+
+		int Clear();
+		int Copy(SDL_Texture* texture, const SDL_Rect* source, const SDL_Rect* destination);
+		int CopyEx(SDL_Texture* texture, const SDL_Rect* source, const SDL_FRect* destination, double angle, const SDL_FPoint* center, SDL_RendererFlip flip);
+		int FillRect(const SDL_Rect* rect);
+		int FillRectF(const SDL_FRect* rect);
+		int DrawLinesF(const SDL_FPoint* points, int count);
+		int DrawPoint(int x, int y);
+
+		#if SDL_VERSION_ATLEAST(2, 0, 18)
+		int Geometry(SDL_Texture* texture, const SDL_Vertex* vertices, int vertexCount, const int* indices, int indexCount);
+		#endif
+
+		void Present();
+
+	private:
+		/// <summary>
+		/// What's been set on a texture through the wrapper.
+		/// </summary>
+		struct TextureState
+		{
+			Uint8 alpha;
+			SDL_Color color;
+			SDL_BlendMode blendMode;
+			SDL_ScaleMode scaleMode;
+			bool blendModeKnown;
+			bool scaleModeKnown;
+		};
+
+		SDL_Renderer* renderer;
+		bool ownsRenderer;
+		bool isNull;
+		bool countCalls;
+		int nullWidth;
+		int nullHeight;
+		RenderStats stats;
+		Uint32 frame;
+		std::vector<Uint8> nullPixels;
+
+		SDL_Color drawColor;
+		SDL_BlendMode drawBlendMode;
+		SDL_Texture* target;
+		float scaleX;
+		float scaleY;
+		SDL_Rect clipRect;
+		bool clipEnabled;
+		bool drawColorKnown;
+		bool drawBlendModeKnown;
+		bool scaleKnown;
+		bool clipKnown;
+		std::unordered_map<SDL_Texture*, TextureState> textureStates;
+
+		/// <summary>
+		/// Gets the remembered state of a texture, starting from what SDL gives a new one.
+		/// </summary>
+		TextureState& GetTextureState(SDL_Texture* texture);
+
+		/// <summary>
+		/// Counts a state change as made or skipped.
+		/// </summary>
+		/// <param name="unchanged">Whether the state is already set.</param>
+		/// <returns>Returns true if the change should be skipped.</returns>
+		bool SkipStateChange(bool unchanged);
+	};
+
+	/// <summary>
+	/// Counts of the sound calls made while the <see cref="AudioDevice"/> is a null backend.
+	/// </summary>
+	struct AudioStats
+	{
+		Uint32 soundsLoaded;
+		Uint32 soundsPlayed;
+	};
+
+	/// <summary>
+	/// Owns the mixer's audio device, or stands in for one when running without audio.
+	/// </summary>
+	class AudioDevice
+	{
+	public:
+		/// <summary>
+		/// Gets the audio device.
+		/// </summary>
+		/// <returns>Returns the device.</returns>
+		static AudioDevice& Get();
+
+		/// <summary>
+		/// Opens the real mixer device.
+		/// </summary>
+		/// <returns>Returns a boolean indicating success.</returns>
+		bool Open();
+
+		/// <summary>
+		/// Makes this a null device. Sounds load and play successfully without doing anything.
+		/// </summary>
+		void OpenNull();
+
+		/// <summary>
+		/// Closes the device.
+		/// </summary>
+		void Close();
+
+		/// <summary>
+		/// Gets whether this is a null device.
+		/// </summary>
+		/// <returns>Returns a boolean.</returns>
+		bool IsNull();
+
+		/// <summary>
+		/// Gets the counts of sounds loaded and played on the null device.
+		/// </summary>
+		/// <returns>Returns the counts.</returns>
+		AudioStats GetStats();
+
+		/// <summary>
+		/// Starts every sound queued by <see cref="SoundEffect::PlaySound"/> since the last flush. The engine does this
+		/// once a frame, off the main thread.
+		/// </summary>
+		void Flush();
+
+	private:
+		bool isOpen;
+		bool isNull;
+		std::atomic<Uint32> soundsLoaded;
+		std::atomic<Uint32> soundsPlayed;
+		// NULL stands in for each sound queued on a null device.
+		std::vector<Mix_Chunk*> pendingPlays;
+
+		#ifdef CRISPY_OCTO_SPORK_THREADS
+		std::mutex pendingMutex;
+		#endif
+
+		AudioDevice();
+
+		/// <summary>
+		/// Queues a sound to start on the next flush.
+		/// </summary>
+		void QueuePlay(Mix_Chunk* chunk);
+
+		/// <summary>
+		/// Drops any queued plays of a sound that's about to be freed.
+		/// </summary>
+		void Forget(Mix_Chunk* chunk);
+
+		friend class SoundEffect;
+	};
+
+	class Engine;
+	class Texture;
+	class SoundEffect;
+
+	/// <summary>
+	/// Where a <see cref="Viewport"/> looks in the world.
+	/// </summary>
+	struct Camera
+	{
+		// the world position shown at the centre of the viewport.
+		float x = 0;
+		float y = 0;
+		float zoom = 1;
+	};
+
+	/// <summary>
+	/// A rectangle of the screen showing the world through its own camera, like one players half of a split screen.
+	/// </summary>
+	struct Viewport
+	{
+		SDL_Rect area;
+		Camera camera;
+
+		/// <summary>
+		/// Maps a world position to the screen.
+		/// </summary>
+		SDL_FPoint WorldToScreen(float worldX, float worldY) const
+		{
+			return SDL_FPoint{ (worldX - camera.x) * camera.zoom + area.x + area.w * 0.5f, (worldY - camera.y) * camera.zoom + area.y + area.h * 0.5f };
+		}
+	};
+
+	/// <summary>
+	/// Collects sprites in world space over a frame, then draws them into every viewport at once. Sprites are
+	/// transformed and clipped to each viewport on the CPU, so no viewport or clip rect has to be set, and every
+	/// viewport's quads for a texture go out together. The number of draw calls depends on the textures, not on how
+	/// many viewports there are. That needs SDL_RenderGeometry from SDL 2.0.18, which the project builds against. An
+	/// older system SDL still works, but each sprite becomes a copy per viewport it shows in.
+	/// </summary>
+	class SpriteBatch
+	{
+	public:
+		/// <summary>
+		/// Queues a sprite.
+		/// </summary>
+		/// <param name="texture">The texture to draw.</param>
+		/// <param name="x">The world x of the top left corner.</param>
+		/// <param name="y">The world y of the top left corner.</param>
+		/// <param name="clip">The part of the texture to draw, or NULL for all of it.</param>
+		/// <param name="color">Multiplied with the texture, alpha included.</param>
+		/// <param name="layer">Lower layers are drawn first. Within a layer sprites are grouped by texture, in the
+		/// order each texture was first queued.</param>
+		void Draw(Texture* texture, float x, float y, const SDL_Rect* clip = NULL, SDL_Color color = SDL_Color{ 255, 255, 255, 255 }, int layer = 0);
+
+		/// <summary>
+		/// Draws everything queued into the viewports and empties the batch. The same as <see cref="Build"/> then
+		/// <see cref="Submit"/>.
+		/// </summary>
+		/// <param name="renderer">The renderer to draw with.</param>
+		/// <param name="viewports">The viewports to draw into.</param>
+		/// <param name="count">The number of viewports.</param>
+		void Flush(Renderer* renderer, const Viewport* viewports, int count);
+
+		/// <summary>
+		/// Sorts everything queued and turns it into draw calls for the viewports, without touching the renderer, so
+		/// it can run on a worker while nothing else queues sprites.
+		/// </summary>
+		/// <param name="viewports">The viewports to draw into.</param>
+		/// <param name="count">The number of viewports.</param>
+		void Build(const Viewport* viewports, int count);
+
+		/// <summary>
+		/// Makes the draw calls left by <see cref="Build"/>. Main thread only.
+		/// </summary>
+		/// <param name="renderer">The renderer to draw with.</param>
+		void Submit(Renderer* renderer);
+
+		/// <summary>
+		/// Gets how many draw calls the last submit made.
+		/// </summary>
+		/// <returns>Returns the count.</returns>
+		Uint32 GetSubmissionCount();
+
+	private:
+		struct BatchedSprite
+		{
+			SDL_Texture* texture;
+			int textureWidth;
+			int textureHeight;
+			SDL_Rect source;
+			SDL_FRect destination;
+			SDL_Color color;
+			int group;
+		};
+
+		struct Group
+		{
+			int layer;
+			SDL_Texture* texture;
+		};
+
+		#if SDL_VERSION_ATLEAST(2, 0, 18)
+		/// <summary>
+		/// A built draw call, one texture's quads for every viewport.
+		/// </summary>
+		struct BuiltRun
+		{
+			SDL_Texture* texture;
+			int firstIndex;
+			int indexCount;
+		};
+		#else
+		/// <summary>
+		/// A built copy of one sprite into one viewport.
+		/// </summary>
+		struct BuiltCopy
+		{
+			SDL_Texture* texture;
+			SDL_Rect source;
+			SDL_FRect destination;
+			SDL_Color color;
+			// the viewport's area, for sprites hanging over its edge.
+			SDL_Rect clip;
+			bool clipped;
+		};
+		#endif
+
+		std::vector<BatchedSprite> sprites;
+		std::vector<Group> groups;
+		// kept between flushes so sorting the groups doesn't allocate every frame.
+		std::vector<int> groupOrder;
+		std::vector<int> groupRank;
+		Uint32 submissions = 0;
+
+		#if SDL_VERSION_ATLEAST(2, 0, 18)
+		std::vector<SDL_Vertex> vertices;
+		std::vector<int> indices;
+		std::vector<BuiltRun> runs;
+		#else
+		std::vector<BuiltCopy> copies;
+		#endif
+
+		/// <summary>
+		/// Clips a sprite to a viewport.
+		/// </summary>
+		/// <param name="sprite">The sprite.</param>
+		/// <param name="viewport">The viewport.</param>
+		/// <param name="destination">Set to where it lands on the screen.</param>
+		/// <param name="source">Set to the part of the texture that's still showing, in texels.</param>
+		/// <returns>Returns false if none of it is in the viewport.</returns>
+		static bool ClipToViewport(const BatchedSprite& sprite, const Viewport& viewport, SDL_FRect& destination, SDL_FRect& source);
+	};
+
+	/// <summary>
+	/// Reads a whole file into memory.
+	/// </summary>
+	/// <param name="filepath">The file to read.</param>
+	/// <param name="contents">Filled with the contents of the file.</param>
+	/// <returns>Returns a boolean indicating success.</returns>
+	bool ReadFileContents(const char* filepath, std::vector<Uint8>& contents);
+
+	/// <summary>
+	/// A single read or write in a <see cref="FileBatch"/>.
+	/// </summary>
+	struct FileRequest
+	{
+		std::string filepath;
+		std::vector<Uint8> data;
+		bool write;
+		bool success;
+	};
+
+	/// <summary>
+	/// A group of whole file reads and writes handed to <see cref="FileIO"/> at once, so they can all be in flight together.
+	/// </summary>
+	class FileBatch
+	{
+	public:
+		/// <summary>
+		/// Adds a read of a whole file.
+		/// </summary>
+		/// <param name="filepath">The file to read.</param>
+		/// <returns>Returns the index of the request, its data holds the contents once the batch has run.</returns>
+		size_t AddRead(const std::string& filepath);
+
+		/// <summary>
+		/// Adds a write replacing the contents of a file, for saves and replays.
+		/// </summary>
+		/// <param name="filepath">The file to write.</param>
+		/// <param name="data">The contents to write.</param>
+		/// <returns>Returns the index of the request.</returns>
+		size_t AddWrite(const std::string& filepath, std::vector<Uint8> data);
+
+		std::vector<FileRequest> requests;
+	};
+
+	/// <summary>
+	/// Runs batches of file reads and writes with as many in flight as possible. Uses io_uring on Linux
+	/// when it's available, and a small pool of threads doing blocking io everywhere else.
+	/// </summary>
+	class FileIO
+	{
+	public:
+		/// <summary>
+		/// Gets the file io backend.
+		/// </summary>
+		/// <returns>Returns the backend.</returns>
+		static FileIO& Get();
+
+		/// <summary>
+		/// Runs every request in a batch, blocking until they have all finished. Safe to call from any thread.
+		/// </summary>
+		/// <param name="batch">The batch to run.</param>
+		/// <returns>Returns true if every request succeeded.</returns>
+		bool Run(FileBatch& batch);
+
+		/// <summary>
+		/// Stops the io threads and tears down the ring.
+		/// </summary>
+		void Shutdown();
+
+	private:
+		FileIO();
+		~FileIO();
+
+		/// <summary>
+		/// Reads or writes a whole file with blocking calls.
+		/// </summary>
+		/// <param name="request">The request.</param>
+		static void RunBlocking(FileRequest& request);
+
+		#ifdef CRISPY_OCTO_SPORK_IO_URING
+		static const unsigned RING_DEPTH = 64;
+
+		io_uring ring;
+		bool ringReady;
+		bool ringFailed;
+		std::mutex ringMutex;
+
+		/// <summary>
+		/// Runs a batch through io_uring.
+		/// </summary>
+		/// <param name="batch">The batch to run.</param>
+		/// <returns>Returns false if the ring couldn't be set up or broke, leaving the batch to the thread pool.</returns>
+		bool RunRing(FileBatch& batch);
+
+		/// <summary>
+		/// Tears down a ring that's failed, so it's not used again. Waits for anything the kernel still has in flight.
+		/// </summary>
+		void FailRing();
+		#endif
+
+		#ifdef CRISPY_OCTO_SPORK_THREADS
+		static const int IO_THREADS = 4;
+
+		struct PooledRequest
+		{
+			FileRequest* request;
+			int* remaining;
+		};
+
+		std::vector<std::thread> workers;
+		std::vector<PooledRequest> queue;
+		std::mutex mutex;
+		std::condition_variable requestAdded;
+		std::condition_variable requestFinished;
+		bool running;
+
+		void WorkerLoop();
+		#endif
+	};
+
+	/// <summary>
+	/// Runs benchmarks many times over and keeps every sample, so runs can be compared with a significance
+	/// test instead of by eye. Noisy machines like shared CI runners move single numbers around a lot more
+	/// than they move whole distributions.
+	/// </summary>
+	class BenchmarkRunner
+	{
+	public:
+		/// <summary>
+		/// Default constructor.
+		/// </summary>
+		BenchmarkRunner();
+
+		/// <summary>
+		/// Adds a benchmark.
+		/// </summary>
+		/// <param name="name">The name it's stored under in baselines.</param>
+		/// <param name="unit">The unit the measurement is in, for the report.</param>
+		/// <param name="higherIsBetter">True for throughputs, false for timings.</param>
+		/// <param name="measure">Runs the benchmark once and returns the measurement, or a negative number if it failed.</param>
+		/// <param name="pinned">False for benchmarks that start threads, since they'd inherit the pin and share one core.</param>
+		void Add(const std::string& name, const std::string& unit, bool higherIsBetter, std::function<double()> measure, bool pinned = true);
+
+		/// <summary>
+		/// Sets how many times each benchmark runs.
+		/// </summary>
+		/// <param name="runs">The number of samples to keep.</param>
+		/// <param name="warmupRuns">The number of runs to throw away first.</param>
+		void SetRuns(int runs, int warmupRuns = 1);
+
+		/// <summary>
+		/// Sets what counts as a real change when comparing against a baseline.
+		/// </summary>
+		/// <param name="alpha">The p value below which the Mann-Whitney test calls the distributions different.</param>
+		/// <param name="minimumChange">The smallest change of the median worth reporting, as a fraction.</param>
+		void SetSignificance(double alpha, double minimumChange);
+
+		/// <summary>
+		/// Runs every benchmark on a thread of its own, pinned for the benchmarks that allow it, interleaving them so
+		/// slow drift in the machine hits them all evenly. The calling thread is left unpinned.
+		/// </summary>
+		/// <returns>Returns false if any benchmark failed.</returns>
+		bool Run();
+
+		/// <summary>
+		/// Writes every sample from the last <see cref="Run"/> to a baseline file.
+		/// </summary>
+		/// <param name="filepath">The baseline file.</param>
+		/// <returns>Returns false if it couldn't be written.</returns>
+		bool SaveBaseline(const std::string& filepath);
+
+		/// <summary>
+		/// Compares the last <see cref="Run"/> against a baseline file and logs the verdict for each benchmark.
+		/// </summary>
+		/// <param name="filepath">The baseline file.</param>
+		/// <returns>Returns false if the baseline couldn't be read or anything regressed.</returns>
+		bool CompareWithBaseline(const std::string& filepath);
+
+		/// <summary>
+		/// Two sided Mann-Whitney U test using the normal approximation with a tie correction.
+		/// </summary>
+		/// <returns>Returns the chance of seeing a difference at least this big if both samples came from the same distribution.</returns>
+		static double MannWhitneyPValue(const std::vector<double>& first, const std::vector<double>& second);
+
+		/// <summary>
+		/// Gets the median of some samples.
+		/// </summary>
+		static double Median(std::vector<double> samples);
+
+		/// <summary>
+		/// Pins the calling thread to a single core and raises its priority.
+		/// </summary>
+		/// <param name="cpu">The core to pin to.</param>
+		/// <returns>Returns false if the platform can't pin threads.</returns>
+		static bool PinCurrentThread(int cpu);
+
+		/// <summary>
+		/// Lets the calling thread run on any core the process can use again, at normal priority.
+		/// </summary>
+		static void UnpinCurrentThread();
+
+	private:
+		struct Benchmark
+		{
+			std::string name;
+			std::string unit;
+			bool higherIsBetter;
+			bool pinned;
+			std::function<double()> measure;
+			std::vector<double> samples;
+		};
+
+		std::vector<Benchmark> benchmarks;
+		int runs;
+		int warmupRuns;
+		double alpha;
+		double minimumChange;
+
+		/// <summary>
+		/// Does the runs on the calling thread, pinning and unpinning it as it goes.
+		/// </summary>
+		bool RunOnCurrentThread();
+	};
+
+	/// <summary>
+	/// The event types the engine records itself. Games number their own from <see cref="GAME"/> up.
+	/// </summary>
+	enum class TelemetryEventType : Uint32
+	{
+		SESSION_START,
+		SCENE_CHANGE,
+		GAME = 256
+	};
+
+	/// <summary>
+	/// A single fixed size telemetry event.
+	/// </summary>
+	struct TelemetryEvent
+	{
+		// a performance counter reading when recorded, microseconds since the session started once decoded.
+		Uint64 time;
+		Uint32 type;
+		Sint32 values[5];
+	};
+
+	/// <summary>
+	/// Records gameplay events for analytics without slowing the frame down. Events are copied into a lock free
+	/// ring per thread, and a background thread batches them up, packs them down with delta and varint coding and
+	/// appends them to a file that is rotated once it gets big.
+	/// </summary>
+	class Telemetry
+	{
+	public:
+		/// <summary>
+		/// Gets the process wide telemetry stream.
+		/// </summary>
+		/// <returns>Returns the stream.</returns>
+		static Telemetry& Get();
+
+		/// <summary>
+		/// Flushes anything queued and stops the writer thread.
+		/// </summary>
+		~Telemetry();
+
+		/// <summary>
+		/// Starts recording, appending to prefix.bin. Once that gets too big it's moved to prefix.1.bin,
+		/// the older files shuffle up, and the oldest is deleted.
+		/// </summary>
+		/// <param name="filePrefix">The path of the files without the extension.</param>
+		/// <param name="maxFileBytes">How big a file can get before it's rotated.</param>
+		/// <param name="maxFiles">How many files to keep, the current one included.</param>
+		void Open(const std::string& filePrefix, Uint32 maxFileBytes = 1 << 20, int maxFiles = 4);
+
+		/// <summary>
+		/// Writes out everything recorded and stops recording.
+		/// </summary>
+		void Close();
+
+		/// <summary>
+		/// Gets whether events are being recorded.
+		/// </summary>
+		/// <returns>Returns a boolean.</returns>
+		bool IsRecording();
+
+		/// <summary>
+		/// Records an event. Costs a counter read and a copy into this threads ring, and does nothing when not recording.
+		/// </summary>
+		/// <param name="type">The event type, a <see cref="TelemetryEventType"/> or a game type from GAME up.</param>
+		/// <param name="a">The first value, what the values mean is up to the event type.</param>
+		void Record(Uint32 type, Sint32 a = 0, Sint32 b = 0, Sint32 c = 0, Sint32 d = 0, Sint32 e = 0)
+		{
+			if (!recording.load(std::memory_order_relaxed))
+			{
+				return;
+			}
+
+			TelemetryEvent event;
+			event.time = SDL_GetPerformanceCounter();
+			event.type = type;
+			event.values[0] = a;
+			event.values[1] = b;
+			event.values[2] = c;
+			event.values[3] = d;
+			event.values[4] = e;
+
+			ThreadBuffer* buffer = GetThreadBuffer();
+
+			if (!buffer->ring.TryPush(event))
+			{
+				buffer->dropped.fetch_add(1, std::memory_order_relaxed);
+			}
+		}
+
+		/// <summary>
+		/// Writes out batched events in builds without threads. Called by the engine once a frame.
+		/// </summary>
+		void Update();
+
+		/// <summary>
+		/// Unpacks the contents of a telemetry file.
+		/// </summary>
+		/// <param name="data">The file contents.</param>
+		/// <param name="events">Where to add the events, with their times in microseconds since their session started.</param>
+		/// <returns>Returns false if the file is damaged, events from before the damage are still added.</returns>
+		static bool Decode(const std::vector<Uint8>& data, std::vector<TelemetryEvent>& events);
+
+		static const int RING_CAPACITY = 4096;
+		static const Uint32 FLUSH_INTERVAL = 100;
+		static const Uint32 BLOCK_MAGIC = 0x4C455443;
+
+	private:
+		struct ThreadBuffer
+		{
+			SpscRing<TelemetryEvent, RING_CAPACITY> ring;
+			std::atomic<Uint32> dropped{ 0 };
+		};
+
+		Telemetry();
+
+		ThreadBuffer* GetThreadBuffer();
+
+		/// <summary>
+		/// Moves everything out of the rings into the batch. Only call from the consuming thread.
+		/// </summary>
+		void Drain();
+
+		/// <summary>
+		/// Drains the rings, packs the batch into a block and appends it to the file.
+		/// </summary>
+		void WriteBatch();
+
+		void Rotate();
+		std::string GetFilePath(int index);
+		void WriterLoop();
+
+		static void PackVarint(std::vector<Uint8>& bytes, Uint64 value);
+		static bool UnpackVarint(const std::vector<Uint8>& data, size_t& offset, size_t end, Uint64& value);
+
+		std::vector<std::unique_ptr<ThreadBuffer>> buffers;
+		std::atomic<bool> recording;
+		std::string filePrefix;
+		Uint32 maxFileBytes;
+		int maxFiles;
+		Uint64 fileBytes;
+		Uint64 sessionStartCounter;
+		Uint32 lastWrite;
+		std::vector<TelemetryEvent> batch;
+		std::vector<Uint8> block;
+
+		#ifdef CRISPY_OCTO_SPORK_THREADS
+		std::mutex buffersMutex;
+		std::thread writer;
+		std::atomic<bool> running;
+		std::mutex wakeMutex;
+		std::condition_variable wake;
+		#else
+		ThreadBuffer onlyBuffer;
+		#endif
+	};
+
+	/// <summary>
+	/// The assets a <see cref="Scene"/> needs, declared up front so they can be loaded before it is shown.
+	/// </summary>
+	class SceneAssets
+	{
+	public:
+		/// <summary>
+		/// Declares an image the scene draws.
+		/// </summary>
+		/// <param name="filepath">The file path of the image.</param>
+		void AddTexture(const char* filepath);
+
+		/// <summary>
+		/// Declares a sound the scene plays.
+		/// </summary>
+		/// <param name="filepath">The file path of the sound.</param>
+		void AddSound(const char* filepath);
+
+		std::vector<std::string> texturePaths;
+		std::vector<std::string> soundPaths;
+	};
+
+	/// <summary>
+	/// How the <see cref="AssetCache"/> is doing against its texture budget.
+	/// </summary>
+	struct TextureCacheStats
+	{
+		Sint64 budgetBytes;
+		// every texture the tracker knows of, including ones the cache doesn't own.
+		Sint64 residentBytes;
+		Uint32 evictions;
+		Uint32 reloads;
+	};
+
+	/// <summary>
+	/// Loads textures and sounds once and hands out the same instance to every caller. Preloads decode
+	/// on a background thread, and the decoded images are uploaded on the main thread in <see cref="Update"/>.
+	/// With a texture budget set, the least recently drawn textures are evicted to stay under it and reloaded
+	/// the same way the next time they're drawn, behind the same <see cref="Texture"/> pointer.
+	/// </summary>
+	class AssetCache
+	{
+	public:
+		/// <summary>
+		/// Default constructor.
+		/// </summary>
+		AssetCache();
+
+		/// <summary>
+		/// Frees everything through <see cref="Shutdown"/>.
+		/// </summary>
+		~AssetCache();
+
+		/// <summary>
+		/// Sets the renderer textures are created with.
+		/// </summary>
+		/// <param name="renderer">The renderer.</param>
+		void SetRenderer(Renderer* renderer);
+
+		/// <summary>
+		/// Queues anything in the list that isn't loaded yet to be loaded in the background.
+		/// </summary>
+		/// <param name="assets">The assets to preload.</param>
+		void Preload(const SceneAssets& assets);
+
+		/// <summary>
+		/// Makes sure everything in the list is loaded, waiting on or doing any work left.
+		/// </summary>
+		/// <param name="assets">The assets to load.</param>
+		void LoadNow(const SceneAssets& assets);
+
+		/// <summary>
+		/// Gets a texture, loading it now if it hasn't been preloaded.
+		/// </summary>
+		/// <param name="filepath">The file path of the image.</param>
+		/// <returns>Returns the texture, which is empty if it failed to load. Owned by the cache.</returns>
+		Texture* GetTexture(const std::string& filepath);
+
+		/// <summary>
+		/// Gets a sound, loading it now if it hasn't been preloaded.
+		/// </summary>
+		/// <param name="filepath">The file path of the sound.</param>
+		/// <returns>Returns the sound, or NULL if it failed to load. Owned by the cache.</returns>
+		SoundEffect* GetSound(const std::string& filepath);
+
+		/// <summary>
+		/// Sets how much texture memory to stay under, as counted by the <see cref="MemoryTracker"/>. Only textures
+		/// owned by the cache can be evicted, so fonts and render targets count towards it without giving anything back.
+		/// </summary>
+		/// <param name="bytes">The budget in bytes, or 0 for none.</param>
+		void SetTextureBudget(Sint64 bytes);
+
+		/// <summary>
+		/// Gets the texture budget counters.
+		/// </summary>
+		/// <returns>Returns a snapshot of the counters.</returns>
+		TextureCacheStats GetTextureStats();
+
+		/// <summary>
+		/// Called once per frame on the main thread to upload any images the background thread finished decoding,
+		/// queue evicted textures that were drawn last frame to be reloaded, and evict down to the texture budget.
+		/// </summary>
+		void Update();
+
+		/// <summary>
+		/// Stops the background thread and frees every asset.
+		/// </summary>
+		void Shutdown();
+
+	private:
+		enum class AssetState
+		{
+			QUEUED,
+			DECODED,
+			// being uploaded on the main thread without the lock, the background thread never touches these.
+			UPLOADING,
+			READY,
+			FAILED,
+			EVICTED
+		};
+
+		struct TextureAsset
+		{
+			AssetState state = AssetState::QUEUED;
+			Texture* texture = NULL;
+			SDL_Surface* surface = NULL;
+			std::vector<Uint8> baked;
+			Uint32 evictedFrame = 0;
+		};
+
+		struct SoundAsset
+		{
+			AssetState state = AssetState::QUEUED;
+			SoundEffect* sound = NULL;
+		};
+
+		struct Job
+		{
+			std::string filepath;
+			bool isTexture;
+		};
+
+		std::map<std::string, TextureAsset> textures;
+		std::map<std::string, SoundAsset> sounds;
+		std::vector<Job> jobs;
+		Renderer* renderer;
+		Sint64 textureBudget;
+		Uint32 evictions;
+		Uint32 reloads;
+		bool overBudgetWarned;
+
+		#ifdef CRISPY_OCTO_SPORK_THREADS
+		std::thread worker;
+		std::mutex mutex;
+		std::condition_variable jobAdded;
+		std::condition_variable jobFinished;
+		bool running;
+		#endif
+
+		void Queue(const std::string& filepath, bool isTexture);
+		void WorkerLoop();
+		void Decode(const std::vector<Job>& batchJobs);
+
+		/// <summary>
+		/// Creates or refills the texture of an asset marked <see cref="AssetState::UPLOADING"/>. Call it without the
+		/// lock, so the background thread isn't held up behind the upload.
+		/// </summary>
+		void Upload(TextureAsset& asset);
+
+		/// <summary>
+		/// Queues an evicted texture to be decoded again. The lock has to be held.
+		/// </summary>
+		void Reload(const std::string& filepath, TextureAsset& asset);
+
+		/// <summary>
+		/// Evicts the least recently drawn textures until the tracked total is under the budget. The lock has to be held.
+		/// </summary>
+		void EnforceTextureBudget();
+	};
+
+	/// <summary>
+	/// One screen of a game, like a menu or the game itself. Scenes are registered with the <see cref="Engine"/>
+	/// under an ID, and the engine sends input, updates and renders to whatever is on top of its scene stack.
+	/// </summary>
+	class Scene
+	{
+	public:
+		/// <summary>
+		/// Default constructor.
+		/// </summary>
+		Scene();
+
+		/// <summary>
+		/// Overridable deconstructor.
+		/// </summary>
+		virtual ~Scene();
+
+		/// <summary>
+		/// Called once when the scene is registered to list the assets it needs.
+		/// </summary>
+		/// <param name="assets">The list to add to.</param>
+		virtual void DeclareAssets(SceneAssets& assets);
+
+		/// <summary>
+		/// Called when the scene is changed or pushed to. Its declared assets are loaded by now.
+		/// </summary>
+		virtual void OnEnter();
+
+		/// <summary>
+		/// Called when the scene is removed from the stack.
+		/// </summary>
+		virtual void OnExit();
+
+		/// <summary>
+		/// Called for each event while the scene is on top of the stack.
+		/// </summary>
+		/// <param name="event">The event.</param>
+		/// <returns>Returns a boolean.</returns>
+		virtual bool OnEvent(SDL_Event event);
+
+		/// <summary>
+		/// Called once per frame while the scene is on top of the stack.
+		/// </summary>
+		/// <param name="deltaTime">The time delta from the previous frame.</param>
+		/// <returns>Returns a boolean.</returns>
+		virtual bool OnUpdate(float deltaTime);
+
+		/// <summary>
+		/// Called once per frame after update while the scene is visible.
+		/// </summary>
+		/// <param name="deltaTime">The time delta from the previous frame.</param>
+		/// <returns>Returns a boolean.</returns>
+		virtual bool OnRender(float deltaTime);
+
+		/// <summary>
+		/// Called once per frame after update while the scene is visible, to queue the world sprites. They're sorted
+		/// and built on a worker and drawn under every visible scene, before any OnRender.
+		/// </summary>
+		/// <param name="sprites">The engine's sprite batch.</param>
+		virtual void OnQueueSprites(SpriteBatch& sprites);
+
+		/// <summary>
+		/// Gets whether the scenes below this one should still be rendered, like for a pause screen.
+		/// </summary>
+		/// <returns>Returns false by default.</returns>
+		virtual bool IsOverlay();
+
+	protected:
+		Engine* engine;
+
+		friend class Engine;
+	};
+
+	class ParticleEmitter;
+
+	/// <summary>
+	/// The main class that games should create an instance of.
+	/// </summary>
+	class Engine
+	{
+	public:
+		/// <summary>
+		/// Default constructor.
+		/// </summary>
+		Engine();
+
+		/// <summary>
+		/// Overridable deconstructor.
+		/// </summary>
+		virtual ~Engine();
+
+		/// <summary>
+		/// First thing to call after creating an instance of <see cref="Engine"/>.
+		/// </summary>
+		/// <param name="name">The name of the game, will be displayed in the title bar.</param>
+		/// <param name="width">The width of the screen in pixels.</param>
+		/// <param name="height">The height of the screen in pixels.</param>
+		/// <param name="vsync">Indicates if the renderer should be created with vsync on.</param>
+		/// <param name="fullscreen">Indicates if the renderer should be created with fullscreen set.</param>
+		/// <returns>Returns a boolean indicating if creation was successful.</returns>
+		bool Create(std::string name, int width, int height, bool vsync, bool fullscreen);
+
+		/// <summary>
+		/// Called to start the game engines main game loop.
+		/// </summary>
+		/// <returns>Returns a boolean indicating if there was an issue.</returns>
+		bool Start();
+
+		/// <summary>
+		/// Called once at engine startup.
+		/// </summary>
+		/// <returns>Returns a boolean.</returns>
+		virtual bool OnCreate();
+
+		/// <summary>
+		/// Called during <see cref="Create"/> so games can add their own startup steps, like opening fonts
+		/// or loading sounds, to run alongside the engines. The engine provides "window", "renderer",
+		/// "image", "text", "audio driver" and "audio".
+		/// </summary>
+		/// <param name="startup">The startup graph to add steps to.</param>
+		/// <returns>Returns false to abort creation.</returns>
+		virtual bool OnCreateStartupTasks(StartupGraph& startup);
+
+		/// <summary>
+		/// Called once per frame after the engine is started. Updates the added and spawned entities, so call it from
+		/// overrides that still want them updated.
+		/// </summary>
+		/// <param name="deltaTime">The time delta from the previous frame.</param>
+		/// <returns>Returns a boolean indicating if the engine should continue running.</returns>
+		virtual bool OnUpdate(float deltaTime);
+
+		/// <summary>
+		/// Called once per frame after update to render stuff, underneath the scenes. Renders the added and spawned
+		/// entities, so call it from overrides that still want them drawn.
+		/// </summary>
+		/// <param name="deltaTime">The time delta from the previous frame.</param>
+		/// <returns>Returns a boolean indicating if the engine should continue running.</returns>
+		virtual bool OnRender(float deltaTime);
+
+		virtual bool OnEvent(SDL_Event event);
+
+		/// <summary>
+		/// Called before the engine terminates.
+		/// </summary>
+		/// <returns>Returns a boolean.</returns>
+		virtual bool OnDestroy();
+
+		/// <summary>
+		/// Adds an <see cref="Entity"/> to the engines vector of entites. Will be cleaned up by the engine.
+		/// Prefer <see cref="Spawn"/> for anything created often.
+		/// </summary>
+		/// <param name="entity">The entity pointer to add to the vector.</param>
+		void AddEntity(Entity* entity);
+
+		/// <summary>
+		/// Creates an entity in the engines pool for its type. Rendered with the other entities and cleaned up by the engine.
+		/// </summary>
+		/// <param name="arguments">The arguments to pass to the entities constructor.</param>
+		/// <returns>Returns a handle to the entity.</returns>
+		template <typename T, typename... Arguments>
+		Handle<T> Spawn(Arguments&&... arguments)
+		{
+			return GetPool<T>().Create(std::forward<Arguments>(arguments)...);
+		}
+
+		/// <summary>
+		/// Destroys a spawned entity and recycles its slot.
+		/// </summary>
+		/// <param name="handle">The handle returned by <see cref="Spawn"/>.</param>
+		/// <returns>Returns false if the entity was already gone.</returns>
+		template <typename T>
+		bool Despawn(Handle<T> handle)
+		{
+			return GetPool<T>().Destroy(handle);
+		}
+
+		/// <summary>
+		/// Gets a spawned entity.
+		/// </summary>
+		/// <param name="handle">The handle returned by <see cref="Spawn"/>.</param>
+		/// <returns>Returns the entity, or NULL if it has been despawned.</returns>
+		template <typename T>
+		T* Resolve(Handle<T> handle)
+		{
+			return GetPool<T>().Get(handle);
+		}
+
+		/// <summary>
+		/// Gets the engines pool for an entity type, creating it on first use.
+		/// </summary>
+		/// <returns>Returns the pool.</returns>
+		template <typename T>
+		ObjectPool<T>& GetPool()
+		{
+			static_assert(std::is_base_of<Entity, T>::value, "Only entities can be pooled by the engine.");
+
+			Uint32 typeId = GetPoolTypeId<T>();
+
+			if (typeId >= entityPools.size())
+			{
+				entityPools.resize(typeId + 1);
+			}
+
+			if (!entityPools[typeId])
+			{
+				entityPools[typeId].reset(new EntityPool<T>());
+			}
+
+			return ((EntityPool<T>*)entityPools[typeId].get())->pool;
+		}
+
+		/// <summary>
+		/// Draws a qaud with an optional rotation.
+		/// Realized this is kinda useless right now since SDL doesn't have a way
+		/// to actually fill in the geometry with a color.
+		/// </summary>
+		/// <param name="points">The array of points to draw.</param>
+		/// <param name="color">The color to make the quad</param>
+		/// <param name="rotation">The angle to rotate the quad in radians.</param>
+		void DrawQuad(SDL_FPoint* points, SDL_Color color, float rotation = 0.0);
+
+		/// <summary>
+		/// Marks the key event currently being handled in <see cref="OnEvent"/> as applied to the game.
+		/// </summary>
+		/// <returns>Returns the input ID to pass to <see cref="MarkInputTicked"/>, or 0 if the event is not tracked.</returns>
+		Uint32 AcknowledgeInput();
+
+		/// <summary>
+		/// Marks an acknowledged input as consumed by a game tick.
+		/// </summary>
+		/// <param name="inputId">The ID returned by <see cref="AcknowledgeInput"/>.</param>
+		void MarkInputTicked(Uint32 inputId);
+
+		/// <summary>
+		/// Turns on the <see cref="QualityGovernor"/> so registered effects scale to hold the given frame rate.
+		/// </summary>
+		/// <param name="targetFramesPerSecond">The frame rate to hold.</param>
+		void EnableQualityGovernor(int targetFramesPerSecond);
+
+		/// <summary>
+		/// Registers a <see cref="ParticleEmitter"/> so its spawn rate and cap follow the quality level.
+		/// The emitter is not owned by the engine.
+		/// </summary>
+		/// <param name="emitter">The emitter to register.</param>
+		/// <param name="simulate">Has the engine move the particles each frame on a frame graph worker, between "update"
+		/// and "render", so the game only calls <see cref="ParticleEmitter::OnRender"/> instead of OnUpdate.</param>
+		void RegisterParticleEmitter(ParticleEmitter* emitter, bool simulate = false);
+
+		/// <summary>
+		/// Stops an emitter from following the quality level.
+		/// </summary>
+		/// <param name="emitter">The emitter to unregister.</param>
+		void UnregisterParticleEmitter(ParticleEmitter* emitter);
+
+		/// <summary>
+		/// Gets the quality governor so games can scale their own effects.
+		/// </summary>
+		/// <returns>Returns a reference to the engines <see cref="QualityGovernor"/>.</returns>
+		QualityGovernor& GetQualityGovernor();
+
+		/// <summary>
+		/// Registers a scene under an ID. The engine takes ownership of the scene.
+		/// </summary>
+		/// <param name="id">The ID used to change to the scene.</param>
+		/// <param name="scene">The scene.</param>
+		void RegisterScene(int id, Scene* scene);
+
+		/// <summary>
+		/// Declares that one scene can lead to another, so the next scenes assets are preloaded while the first is showing.
+		/// </summary>
+		/// <param name="from">The ID of the scene being shown.</param>
+		/// <param name="to">The ID of a scene it can change or push to.</param>
+		void AddSceneTransition(int from, int to);
+
+		/// <summary>
+		/// Replaces the whole scene stack with a scene at the end of the current phase of the frame.
+		/// </summary>
+		/// <param name="id">The ID of the scene.</param>
+		void ChangeScene(int id);
+
+		/// <summary>
+		/// Pushes a scene on top of the stack at the end of the current phase of the frame.
+		/// </summary>
+		/// <param name="id">The ID of the scene.</param>
+		void PushScene(int id);
+
+		/// <summary>
+		/// Pops the top scene at the end of the current phase of the frame.
+		/// </summary>
+		void PopScene();
+
+		/// <summary>
+		/// Gets the ID of the scene on top of the stack.
+		/// </summary>
+		/// <returns>Returns the ID, or -1 if the stack is empty.</returns>
+		int GetCurrentSceneId();
+
+		#ifdef CRISPY_OCTO_SPORK_COROUTINES
+		/// <summary>
+		/// Starts a coroutine, resumed once per frame after the scenes update.
+		/// </summary>
+		/// <param name="coroutine">The coroutine.</param>
+		/// <returns>Returns an ID for <see cref="StopCoroutine"/>.</returns>
+		Uint32 StartCoroutine(Coroutine coroutine);
+
+		/// <summary>
+		/// Stops a running coroutine.
+		/// </summary>
+		/// <param name="id">The ID returned by <see cref="StartCoroutine"/>.</param>
+		/// <returns>Returns false if the coroutine already finished.</returns>
+		bool StopCoroutine(Uint32 id);
+		#endif
+
+		/// <summary>
+		/// Gets the engines asset cache.
+		/// </summary>
+		/// <returns>Returns the cache.</returns>
+		AssetCache& GetAssets();
+
+		/// <summary>
+		/// Renders the scene into a fixed size target texture that is presented with nearest neighbor
+		/// integer scaling and letterboxing. Can be changed at any time without reloading assets.
+		/// Calling this before <see cref="Create"/> with fullscreen on keeps the desktop resolution.
+		/// </summary>
+		/// <param name="width">The internal width in pixels, or 0 to render straight to the window.</param>
+		/// <param name="height">The internal height in pixels, or 0 to render straight to the window.</param>
+		void SetInternalResolution(int width, int height);
+
+		/// <summary>
+		/// Runs the engine with null video and audio backends, so it needs no display or sound card. Call before <see cref="Create"/>.
+		/// </summary>
+		/// <param name="headless">Whether to run headless.</param>
+		/// <param name="countCalls">Whether to count render and sound calls and report them when the engine stops.</param>
+		void SetHeadless(bool headless, bool countCalls = false);
+
+		/// <summary>
+		/// Gets whether the engine is running headless.
+		/// </summary>
+		/// <returns>Returns a boolean.</returns>
+		bool IsHeadless();
+
+		/// <summary>
+		/// Stops the main loop after a number of frames, for automated runs.
+		/// </summary>
+		/// <param name="frames">The number of frames to run, or 0 to run until quit.</param>
+		void SetFrameLimit(Uint32 frames);
+
+		/// <summary>
+		/// Logs a <see cref="MemoryTracker"/> dump every so often while the engine runs.
+		/// </summary>
+		/// <param name="milliseconds">How often to dump, or 0 to only dump when the engine stops.</param>
+		void SetMemoryReportInterval(Uint32 milliseconds);
+
+		/// <summary>
+		/// Adds a viewport, like one players part of a split screen. Until the first is added the whole screen is one
+		/// viewport showing the world one to one. The camera starts out showing the same part of the world the area
+		/// would have shown without viewports.
+		/// </summary>
+		/// <param name="area">The part of the screen to draw into.</param>
+		/// <returns>Returns the index of the viewport.</returns>
+		int AddViewport(SDL_Rect area);
+
+		/// <summary>
+		/// Gets a viewport, to move its camera.
+		/// </summary>
+		/// <param name="index">The index returned by <see cref="AddViewport"/>.</param>
+		/// <returns>Returns the viewport.</returns>
+		Viewport& GetViewport(int index);
+
+		/// <summary>
+		/// Removes every viewport, going back to the whole screen.
+		/// </summary>
+		void ClearViewports();
+
+		/// <summary>
+		/// Gets the sprite batch. Sprites queued on it in <see cref="Scene::OnQueueSprites"/> are built on a worker and
+		/// drawn before the scenes render, ones queued during a scenes OnRender are drawn when that scene finishes.
+		/// </summary>
+		/// <returns>Returns the batch.</returns>
+		SpriteBatch& GetSprites();
+
+		/// <summary>
+		/// Draws the queued sprites now, for scenes that draw directly on top of them.
+		/// </summary>
+		void FlushSprites();
+
+		/// <summary>
+		/// Calls a function once per viewport, clipped to it, for anything drawn directly rather than through the sprite
+		/// batch. Coordinates stay screen coordinates, use <see cref="Viewport::WorldToScreen"/> to place things.
+		/// </summary>
+		/// <param name="draw">The function.</param>
+		void ForEachViewport(std::function<void(const Viewport&)> draw);
+
+		/// <summary>
+		/// Gets the graph every frame runs. The engine's own phases are the main thread tasks "input", "update", "render",
+		/// "present" and "end frame", each depending on the one before. Simulated particle emitters add a "particles" worker
+		/// task between "update" and "render", and games hang their own tasks off the phases the same way.
+		/// </summary>
+		/// <returns>Returns the graph.</returns>
+		FrameGraph& GetFrameGraph();
+
+		/// <summary>
+		/// Gets the time the current frame covers, for tasks in the frame graph. Set by the "update" task.
+		/// </summary>
+		/// <returns>Returns the time in milliseconds.</returns>
+		float GetFrameDeltaTime();
+
+	protected:
+		SDL_Window* window;
+		Renderer* renderer;
+		int screenWidth;
+		int screenHeight;
+		bool isVsyncEnabled;
+		bool isFullscreenEnabled;
+		std::string name;
+		bool isEngineRunning;
+		bool isHeadless;
+		bool countRenderCalls;
+		Uint32 frameLimit;
+		Uint32 framesRun;
+		std::vector <Entity*> entities;
+		std::vector<std::unique_ptr<EntityPoolBase>> entityPools;
+		float lastFrameTime;
+		FrameRate frameRate;
+		InputLatencyTracker inputLatency;
+		Uint32 currentInputId;
+		QualityGovernor qualityGovernor;
+		std::vector<ParticleEmitter*> particleEmitters;
+		std::vector<ParticleEmitter*> simulatedEmitters;
+		bool particleTaskAdded;
+		AssetCache assetCache;
+		std::vector<Viewport> viewports;
+		Viewport screenViewport;
+		SpriteBatch sprites;
+		const Viewport* builtViewports;
+		int builtViewportCount;
+		FrameGraph frameGraph;
+		Uint64 frameStartCounter;
+		Uint32 frameTime;
+		float frameDeltaTime;
+		bool renderingToTarget;
+
+		#ifdef CRISPY_OCTO_SPORK_COROUTINES
+		CoroutineScheduler coroutines;
+		#endif
+
+		struct SceneEntry
+		{
+			int id;
+			Scene* scene;
+			SceneAssets assets;
+			std::vector<int> transitions;
+		};
+
+		struct SceneChange
+		{
+			enum class Type
+			{
+				CHANGE,
+				PUSH,
+				POP
+			};
+
+			Type type;
+			int id;
+		};
+
+		std::vector<SceneEntry> scenes;
+		std::vector<int> sceneStack;
+		std::vector<SceneChange> pendingSceneChanges;
+
+		/// <summary>
+		/// Finds a registered scene.
+		/// </summary>
+		/// <param name="id">The ID of the scene.</param>
+		/// <returns>Returns the index of the scene, or -1.</returns>
+		int FindScene(int id);
+
+		/// <summary>
+		/// Applies any queued scene changes and starts preloading whatever can come next.
+		/// </summary>
+		void ApplySceneChanges();
+
+		/// <summary>
+		/// Enters a scene, making sure its assets are loaded first.
+		/// </summary>
+		/// <param name="index">The index of the scene.</param>
+		void EnterScene(int index);
+		SDL_Texture* renderTarget;
+		int internalWidth;
+		int internalHeight;
+		int renderTargetDivisor;
+		Uint32 memoryReportInterval;
+		Uint32 lastMemoryReport;
+
+		/// <summary>
+		/// Gets the viewports to draw into, which is the whole screen if none were added.
+		/// </summary>
+		/// <param name="count">Set to the number of viewports.</param>
+		/// <returns>Returns the viewports.</returns>
+		const Viewport* GetActiveViewports(int& count);
+
+		/// <summary>
+		/// Points the renderer at the internal render target, creating it first if the size changed.
+		/// </summary>
+		/// <returns>Returns false if there is no internal render target to draw into.</returns>
+		bool BeginRenderTarget();
+
+		/// <summary>
+		/// Switches back to the window and draws the internal render target scaled and letterboxed.
+		/// </summary>
+		void PresentRenderTarget();
+
+		/// <summary>
+		/// Pushes the current quality level to every registered emitter.
+		/// </summary>
+		void ApplyQuality();
+
+		/// <summary>
+		/// Moves the particles of the emitters registered to be simulated. Runs as the "particles" frame task.
+		/// </summary>
+		void SimulateParticles();
+
+		/// <summary>
+		/// Sorts and builds the sprites queued during update. Runs as the "sprites" frame task.
+		/// </summary>
+		void BuildSprites();
+
+		/// <summary>
+		/// Gets the index of the lowest scene on the stack that's drawn, the first one down that isn't an overlay.
+		/// </summary>
+		/// <returns>Returns the index, 0 when the stack is empty.</returns>
+		int GetFirstVisibleScene();
+
+		/// <summary>
+		/// Gets a small, process wide index for each pooled entity type.
+		/// </summary>
+		/// <returns>Returns the index of the type.</returns>
+		template <typename T>
+		static Uint32 GetPoolTypeId()
+		{
+			static Uint32 typeId = NextPoolTypeId();
+			return typeId;
+		}
+
+		static Uint32 NextPoolTypeId();
+
+		/// <summary>
+		/// Polls and dispatches events.
+		/// </summary>
+		void FrameInput();
+
+		/// <summary>
+		/// Updates the engine, asset cache, top scene and coroutines, applying any scene changes they make.
+		/// </summary>
+		void FrameUpdate();
+
+		/// <summary>
+		/// Draws the engine's entities and then every visible scene, into the internal render target if there is one.
+		/// </summary>
+		void FrameRender();
+
+		/// <summary>
+		/// Lets the quality governor see the frame's work time, then presents it.
+		/// </summary>
+		void FramePresent();
+
+		/// <summary>
+		/// Periodic reports, the frame limit and the window title.
+		/// </summary>
+		void FrameEnd();
+
+		/// <summary>
+		/// The main loop. To support emscripten the current <see cref="Engine"/> instance is passed in.
+		/// </summary>
+		/// <param name="arg">A pointer to the current <see cref="Engine"/> instance.</param>
+		static void Update(void* arg);
+	};
+
+	class SoundEffect
+	{
+	public:
+		SoundEffect();
+		~SoundEffect();
+		bool LoadSoundFromFile(const char* filepath);
+
+		/// <summary>
+		/// Decodes a sound from the contents of a file already in memory. The data can be freed afterwards.
+		/// </summary>
+		/// <param name="data">The file contents.</param>
+		/// <param name="size">The size of the data in bytes.</param>
+		/// <returns>Returns a boolean indicating success.</returns>
+		bool LoadSoundFromMemory(const void* data, size_t size);
+
+		/// <summary>
+		/// Queues the sound to start on the next <see cref="AudioDevice::Flush"/>, which the engine runs every frame.
+		/// </summary>
+		/// <returns>Returns false if there's no sound loaded.</returns>
+		bool PlaySound();
+		void Free();
+	private:
+		Mix_Chunk* mixChunk;
+		Sint64 trackedBytes;
+	};
+
+	/// <summary>
+	/// An object for holding texture information and to perform basic renders of it.
+	/// </summary>
+	class Texture
+	{
+	public:
+		/// <summary>
+		/// Default constructor.
+		/// </summary>
+		Texture();
+
+		/// <summary>
+		/// Creates a new instance of <see cref="Texture"/>.
+		/// </summary>
+		Texture(Renderer* renderer, const char* fontFilePath = NULL, int fontSize = 0);
+
+		/// <summary>
+		/// Creates a new instance of <see cref="Texture"/> drawing through the wrapper for an <see cref="SDL_Renderer"/>.
+		/// </summary>
+		Texture(SDL_Renderer* renderer, const char* fontFilePath = NULL, int fontSize = 0);
+
+		/// <summary>
+		/// Default deconstructor.
+		/// </summary>
+		~Texture();
+
+		/// <summary>
+		/// Populates the <see cref="SDL_Texture"/> from a file.
+		/// </summary>
+		/// <param name="filepath">The file path to load an image from for the texture.</param>
+		/// <returns>Returns a boolean indicating success.</returns>
+		bool LoadTextureFromFile(const char* filepath);
+
+		/// <summary>
+		/// Populates the <see cref="SDL_Texture"/> from a file written by <see cref="BakeTextureFile"/>.
+		/// The pixels are uploaded as they are, with no decoding or format conversion.
+		/// </summary>
+		/// <param name="filepath">The file path of the baked texture.</param>
+		/// <returns>Returns a boolean indicating success.</returns>
+		bool LoadTextureFromBakedFile(const char* filepath);
+
+		/// <summary>
+		/// Populates the <see cref="SDL_Texture"/> from baked texture data already in memory.
+		/// </summary>
+		/// <param name="data">The baked texture data, header included.</param>
+		/// <param name="size">The size of the data in bytes.</param>
+		/// <returns>Returns a boolean indicating success.</returns>
+		bool LoadTextureFromBakedMemory(const void* data, size_t size);
+
+		/// <summary>
+		/// Populates the <see cref="SDL_Texture"/> from the contents of an image or baked texture file already in memory.
+		/// </summary>
+		/// <param name="data">The file contents.</param>
+		/// <param name="size">The size of the data in bytes.</param>
+		/// <returns>Returns a boolean indicating success.</returns>
+		bool LoadTextureFromMemory(const void* data, size_t size);
+
+		/// <summary>
+		/// Opens the font used by <see cref="LoadFromRenderedText"/> from the contents of a font file. The texture keeps
+		/// the data since SDL_ttf reads from it for as long as the font is open.
+		/// </summary>
+		/// <param name="data">The font file contents.</param>
+		/// <param name="fontSize">The point size to open the font at.</param>
+		/// <returns>Returns a boolean indicating success.</returns>
+		bool LoadFontFromMemory(std::vector<Uint8> data, int fontSize);
+
+		/// <summary>
+		/// Checks whether file contents start with a baked texture header.
+		/// </summary>
+		/// <param name="data">The file contents.</param>
+		/// <param name="size">The size of the data in bytes.</param>
+		/// <returns>Returns a boolean.</returns>
+		static bool IsBakedTexture(const void* data, size_t size);
+
+		/// <summary>
+		/// Checks whether a baked texture was baked from the image as it is now. A bake whose image isn't there is
+		/// current, so builds can ship the baked copies alone.
+		/// </summary>
+		/// <param name="data">The baked texture data, header included.</param>
+		/// <param name="size">The size of the data in bytes.</param>
+		/// <param name="sourcePath">The image it was baked from.</param>
+		/// <returns>Returns false if it isn't a baked texture this version reads, or the image has changed since.</returns>
+		static bool IsBakeCurrent(const void* data, size_t size, const char* sourcePath);
+
+		/// <summary>
+		/// Decodes an image and writes its pixels out in the renderers native format behind a small header,
+		/// so <see cref="LoadTextureFromFile"/> can skip decoding it at startup. Meant to be run offline. The format
+		/// is recorded in the header, a renderer that doesn't take it gets the pixels converted once at load.
+		/// </summary>
+		/// <param name="sourcePath">The image to bake.</param>
+		/// <param name="bakedPath">Where to write the baked texture.</param>
+		/// <param name="format">The pixel format to bake in, see <see cref="Renderer::GetNativeTextureFormat"/>.</param>
+		/// <returns>Returns a boolean indicating success.</returns>
+		static bool BakeTextureFile(const char* sourcePath, const char* bakedPath, Uint32 format = SDL_PIXELFORMAT_ARGB8888);
+
+		/// <summary>
+		/// Gets the path <see cref="LoadTextureFromFile"/> looks for a baked copy of an image at.
+		/// </summary>
+		/// <param name="filepath">The path of the source image.</param>
+		/// <returns>Returns the source path with its extension swapped for ".raw".</returns>
+		static std::string GetBakedPath(const char* filepath);
+
+		/// <summary>
+		/// Populates the <see cref="SDL_Texture"/> from a rendered text string.
+		/// </summary>
+		/// <param name="text">The text to display.</param>
+		/// <param name="textColor">The color of the text.</param>
+		/// <returns>Returns a boolean indicating success.</returns>
+		bool LoadFromRenderedText(std::string text, SDL_Color textColor);
+
+		/// <summary>
+		/// Populates the <see cref="SDL_Texture"/> from an already decoded surface. The surface is not freed.
+		/// </summary>
+		/// <param name="surface">The surface to upload.</param>
+		/// <returns>Returns a boolean indicating success.</returns>
+		bool LoadFromSurface(SDL_Surface* surface);
+
+		/// <summary>
+		/// Called to cleanup and free the texture.
+		/// </summary>
+		void Free();
+
+		/// <summary>
+		/// Frees the GPU copy of the texture but keeps its size, so whoever owns it can reload it in place.
+		/// </summary>
+		void Evict();
+
+		/// <summary>
+		/// Stamps the texture as used this frame. <see cref="Render"/> does this itself, anything drawing the
+		/// <see cref="SDL_Texture"/> through the <see cref="Renderer"/> directly should call it.
+		/// </summary>
+		void MarkUsed();
+
+		/// <summary>
+		/// Gets the frame the texture was last used in.
+		/// </summary>
+		/// <returns>Returns a frame number from <see cref="Renderer::GetFrame"/>.</returns>
+		Uint32 GetLastUsedFrame();
+
+		/// <summary>
+		/// Gets the estimated size of the texture on the GPU.
+		/// </summary>
+		/// <returns>Returns the size in bytes, or 0 if nothing is loaded.</returns>
+		Sint64 GetTextureBytes();
+
+		/// <summary>
+		/// Renders the texture to the current <see cref="SDL_Renderer"/>.
+		/// </summary>
+		/// <param name="x">The x location to draw to.</param>
+		/// <param name="y">The y location to draw to.</param>
+		/// <param name="clip">The rectangle to pull texture information from. Useful for sprite sheets.</param>
+		/// <param name="angle">The angle at which to rotate the texture.</param>
+		/// <param name="center">The center to rotate about.</param>
+		/// <param name="flip">Determines if the texture will be flipped.</param>
+		void Render(float x, float y, SDL_Rect* clip = NULL, float angle = 0.0, SDL_FPoint* center = NULL, SDL_RendererFlip flip = SDL_FLIP_NONE, int alpha = 255);
+
+		/// <summary>
+		/// Gets the current renderer associated with this texture.
+		/// </summary>
+		/// <returns>Returns a pointer to a <see cref="Renderer"/>.</returns>
+		Renderer* GetRenderer();
+
+		/// <summary>
+		/// Gets the wrapped texture, for drawing through the <see cref="Renderer"/> directly.
+		/// </summary>
+		/// <returns>Returns the texture, or NULL if nothing is loaded.</returns>
+		SDL_Texture* GetSDLTexture();
+
+		int width;
+		int height;
+
+	private:
+		SDL_Texture* texture;
+		Renderer* renderer;
+		TTF_Font* font;
+		std::vector<Uint8> fontData;
+		int fontSize;
+		Sint64 trackedTextureBytes;
+		Sint64 trackedFontBytes;
+		Uint32 lastUsedFrame;
+
+		/// <summary>
+		/// Charges the current texture to the <see cref="MemoryTracker"/> at four bytes per pixel.
+		/// </summary>
+		void TrackTextureMemory();
+
+		/// <summary>
+		/// Gets the size and modification time of a file, which baked textures keep to spot their image changing.
+		/// </summary>
+		/// <returns>Returns false if the file isn't there.</returns>
+		static bool GetFileStamp(const char* filepath, Uint32& size, Uint64& modified);
+	};
+
+	/// <summary>
+	/// Header at the start of every baked texture file. Pixel rows follow straight after it with no padding.
+	/// </summary>
+	struct BakedTextureHeader
+	{
+		char magic[4];
+		Uint32 version;
+		Uint32 format;
+		Uint32 width;
+		Uint32 height;
+		// the image it was baked from, so an image edited after baking wins over the stale bake.
+		Uint32 sourceSize;
+		Uint64 sourceModified;
+	};
+
+	const char BAKED_TEXTURE_MAGIC[4] = { 'C', 'O', 'S', 'T' };
+	const Uint32 BAKED_TEXTURE_VERSION = 2;
+
+	// anything bigger in a baked header is corrupt, no renderer takes textures this size.
+	const Uint32 BAKED_TEXTURE_MAX_SIZE = 16384;
+
+	/// <summary>
+	/// Text drawn from a signed distance field atlas, so one rasterization of a font covers every size it's drawn at.
+	/// SDL_Renderer has no shaders to threshold the distance per pixel, so the threshold is baked into the alpha
+	/// instead, once per power of two scale, and linear filtering covers the sizes in between.
+	/// </summary>
+	class SdfFont
+	{
+	public:
+		/// <summary>
+		/// Creates a new instance of <see cref="SdfFont"/>.
+		/// </summary>
+		/// <param name="renderer">The renderer to draw with.</param>
+		SdfFont(Renderer* renderer);
+
+		/// <summary>
+		/// Default deconstructor.
+		/// </summary>
+		~SdfFont();
+
+		/// <summary>
+		/// Reads a font file and builds its distance field. Needs no renderer calls, so it's safe off the main thread.
+		/// </summary>
+		/// <param name="filepath">The font file.</param>
+		/// <param name="bakeSize">The point size glyphs are rasterized at. Bigger keeps corners sharper.</param>
+		/// <returns>Returns a boolean indicating success.</returns>
+		bool LoadFromFile(const char* filepath, int bakeSize = 48);
+
+		/// <summary>
+		/// Builds the distance field from the contents of a font file.
+		/// </summary>
+		/// <param name="data">The font file contents.</param>
+		/// <param name="bakeSize">The point size glyphs are rasterized at.</param>
+		/// <returns>Returns a boolean indicating success.</returns>
+		bool LoadFromMemory(const std::vector<Uint8>& data, int bakeSize = 48);
+
+		/// <summary>
+		/// Frees the distance field and every atlas texture.
+		/// </summary>
+		void Free();
+
+		/// <summary>
+		/// Draws a line of text in screen space, like a HUD, so it ignores viewports.
+		/// </summary>
+		/// <param name="text">The text. Only printable ASCII is in the atlas.</param>
+		/// <param name="x">The left edge.</param>
+		/// <param name="y">The top edge.</param>
+		/// <param name="size">The point size to draw at, as if the font had been opened at it.</param>
+		/// <param name="color">The color, alpha included.</param>
+		void Render(const std::string& text, float x, float y, float size, SDL_Color color);
+
+		/// <summary>
+		/// Gets how wide a line of text is at a size.
+		/// </summary>
+		float GetWidth(const std::string& text, float size);
+
+		/// <summary>
+		/// Gets how tall a line of text is at a size.
+		/// </summary>
+		float GetHeight(float size);
+
+		/// <summary>
+		/// Turns glyph coverage into a distance field. Distances are in texels, clamped to the spread and stored with
+		/// 128 on the edge, higher inside.
+		/// </summary>
+		/// <param name="coverage">The glyph coverage, where 128 and up is inside.</param>
+		/// <param name="coveragePitch">The bytes between coverage rows.</param>
+		/// <param name="width">The width of the coverage.</param>
+		/// <param name="height">The height of the coverage.</param>
+		/// <param name="distances">Where to write the field, SPREAD texels bigger on every side than the coverage.</param>
+		/// <param name="distancesPitch">The bytes between field rows.</param>
+		static void BuildDistanceField(const Uint8* coverage, int coveragePitch, int width, int height, Uint8* distances, int distancesPitch);
+
+		// how many texels out from the edge the field reaches.
+		static const int SPREAD = 6;
+
+	private:
+		static const int FIRST_GLYPH = 32;
+		static const int LAST_GLYPH = 126;
+		static const int ATLAS_WIDTH = 512;
+
+		// atlases are baked for scales from 1/4 to 8.
+		static const int MIN_SCALE_POWER = -2;
+		static const int MAX_SCALE_POWER = 3;
+		static const int SCALE_COUNT = MAX_SCALE_POWER - MIN_SCALE_POWER + 1;
+
+		struct Glyph
+		{
+			SDL_Rect atlas;
+			int advance;
+		};
+
+		Renderer* renderer;
+		int bakeSize;
+		int lineHeight;
+		int atlasHeight;
+		Glyph glyphs[LAST_GLYPH - FIRST_GLYPH + 1];
+		std::vector<Uint8> distances;
+		SDL_Texture* atlases[SCALE_COUNT];
+		Sint64 trackedTextureBytes;
+		Sint64 trackedFontBytes;
+
+		#if SDL_VERSION_ATLEAST(2, 0, 18)
+		std::vector<SDL_Vertex> vertices;
+		std::vector<int> indices;
+		#endif
+
+		/// <summary>
+		/// Gets the atlas baked for the closest power of two scale, baking it the first time it's needed.
+		/// </summary>
+		SDL_Texture* GetAtlas(float scale);
+	};
+
+	/// <summary>
+	/// Sprite class to hold an entity and a texture.
+	/// </summary>
+	class Sprite : public Entity
+	{
+	public:
+		/// <summary>
+		/// Default constructor.
+		/// </summary>
+		Sprite();
+
+		/// <summary>
+		/// Creates a new instance of <see cref="Sprite"/>.
+		/// </summary>
+		/// <param name="x">The x location of the sprite in the engine.</param>
+		/// <param name="y">The y location of the sprite in the engine.</param>
+		/// <param name="width">The width of the sprite.</param>
+		/// <param name="height">The height of the sprite.</param>
+		/// <param name="texture">A pointer to the texture to use for the sprite.</param>
+		/// <param name="renderer">A pointer to the renderer to render the sprite to.</param>
+		Sprite(float x, float y, float width, float height, Texture* texture, Renderer* renderer);
+
+		/// <summary>
+		/// Creates a new instance of <see cref="Sprite"/> drawing through the wrapper for an <see cref="SDL_Renderer"/>.
+		/// </summary>
+		Sprite(float x, float y, float width, float height, Texture* texture, SDL_Renderer* renderer);
+
+		/// <summary>
+		/// Called once per frame. Renders the sprite to its current location.
+		/// </summary>
+		/// <param name="deltaTime">The delta time since the last frame.</param>
+		/// <returns>Returns a boolean indicating success.</returns>
+		virtual bool OnRender(float deltaTime);
+
+	protected:
+		float width;
+		float height;
+		Texture* texture;
+		Renderer* renderer;
+
+	};
+
+	/// <summary>
+	/// Class to hold an entity represented by a rectangle.
+	/// </summary>
+	class Rectangle : public Entity
+	{
+	public:
+		/// <summary>
+		/// Default constructor.
+		/// </summary>
+		Rectangle();
+
+		/// <summary>
+		/// Creates a new instance of <see cref="Rectangle"/>.
+		/// </summary>
+		/// <param name="x">The x location of the rectangle in the engine.</param>
+		/// <param name="y">The y location of the rectangle in the engine.</param>
+		/// <param name="width">The width of the rectangle.</param>
+		/// <param name="height">The height of the rectangle.</param>
+		/// <param name="color">The color to draw the rectangle with.</param>
+		/// <param name="renderer">A pointer to the renderer to render the rectangle to.</param>
+		Rectangle(float x, float y, float width, float height, SDL_Color color, Renderer* renderer);
+
+		/// <summary>
+		/// Creates a new instance of <see cref="Rectangle"/> drawing through the wrapper for an <see cref="SDL_Renderer"/>.
+		/// </summary>
+		Rectangle(float x, float y, float width, float height, SDL_Color color, SDL_Renderer* renderer);
+
+		/// <summary>
+		/// Called once per frame. Renders the rectangle to its current location.
+		/// </summary>
+		/// <param name="deltaTime">The delta time since the last frame.</param>
+		/// <returns>Returns a boolean indicating success.</returns>
+		virtual bool OnRender(float deltaTime);
+
+	protected:
+		float width;
+		float height;
+		SDL_Color color;
+		Renderer* renderer;
+	};
+
+	/// <summary>
+	/// Class to hold an entity represented by a circle.
+	/// </summary>
+	class Circle : public Entity
+	{
+	public:
+		/// <summary>
+		/// Default constructor.
+		/// </summary>
+		Circle();
+
+		/// <summary>
+		/// Creates a new instance of <see cref="Circle"/>.
+		/// </summary>
+		/// <param name="x">The x location of the center of the circle.</param>
+		/// <param name="y">The y location of the center of the circle.</param>
+		/// <param name="radius">The radius of the circle</param>
+		/// <param name="color">The color to draw the circle with.</param>
+		/// <param name="renderer">A pointer to the renderer to render the circle to.</param>
+		Circle(float x, float y, float radius, SDL_Color color, Renderer* renderer);
+
+		/// <summary>
+		/// Creates a new instance of <see cref="Circle"/> drawing through the wrapper for an <see cref="SDL_Renderer"/>.
+		/// </summary>
+		Circle(float x, float y, float radius, SDL_Color color, SDL_Renderer* renderer);
+
+		/// <summary>
+		/// Called once per frame. Renders the circle to its current location.
+		/// </summary>
+		/// <param name="deltaTime">The delta time since the last frame.</param>
+		/// <returns>Returns a boolean indicating success.</returns>
+		virtual bool OnRender(float deltaTime);
+
+	protected:
+		float radius;
+		SDL_Color color;
+		Renderer* renderer;
+	};
+
+	/// <summary>
+	/// Struct used to contain a single particle of a <see cref="ParticleEmitter"/>.
+	/// </summary>
+	struct Particle
+	{
+		float x = 0;
+		float y = 0;
+		float xVelocity = 0;
+		float yVelocity = 0;
+		float totalLifeTime = 0;
+		float lifeTimeRemaining = 0;
+		bool active = false;
+	};
+
+	class ParticleEmitter
+	{
+	public:
+		ParticleEmitter();
+		~ParticleEmitter();
+		ParticleEmitter(float x, float y, float lifeInSeconds, Texture* texture, float speed = 0.5, int newParticlesPerSecond = 5, float startSizeMultiplier = 1.0, float endSizeMultiplier = 0.0, int maxParticles = 20000);
+		void OnUpdate(float deltaTime);
+		void OnRender();
+
+		/// <summary>
+		/// Spawns and moves particles without drawing them, so it's safe off the main thread. OnUpdate is this then OnRender.
+		/// </summary>
+		/// <param name="deltaTime">The time since the last update in milliseconds.</param>
+		void Simulate(float deltaTime);
+
+		/// <summary>
+		/// Scales the spawn rate and the number of live particles, usually from the <see cref="QualityGovernor"/>.
+		/// </summary>
+		/// <param name="spawnRateScale">Multiplier for <see cref="newParticlesPerSecond"/>.</param>
+		/// <param name="capScale">Multiplier for the maximum number of live particles.</param>
+		void SetQuality(float spawnRateScale, float capScale);
+
+		// false if the emitter couldn't get its particle pool.
+		bool active;
+		int newParticlesPerSecond;
+		float startOfSecond;
+		float particlesCreatedThisSecond;
+	private:
+		float x;
+		float y;
+		float lifeInMiliseconds;
+		Texture* texture;
+		float startSizeMultiplier = 1.0;
+		float endSizeMultiplier = 1.0;
+		float speed;
+		Particle* particlePool;
+		int currentParticlePoolIndex = 0;
+		int maxParticles;
+		int activeParticles = 0;
+		int activeParticleCap;
+		float spawnRateScale = 1.0;
+	};
+
+	Logger& Logger::Get()
+	{
+		static Logger logger;
+		return logger;
+	}
+
+	Logger::Logger()
+	{
+		rateLimit = 20;
+		startCounter = SDL_GetPerformanceCounter();
+
+		#ifdef CRISPY_OCTO_SPORK_THREADS
+		running = true;
+		flushRequests = 0;
+		flushesCompleted = 0;
+		writer = std::thread([this]() { WriterLoop(); });
+		#endif
+	}
+
+	Logger::~Logger()
+	{
+		#ifdef CRISPY_OCTO_SPORK_THREADS
+		{
+			std::lock_guard<std::mutex> lock(flushMutex);
+			running = false;
+		}
+
+		flushRequested.notify_all();
+		flushed.notify_all();
+		writer.join();
+
+		// the writer is gone, so this thread is the only consumer left.
+		while (Drain())
+		{}
+		#endif
+	}
+
+	void Logger::SetRateLimit(Uint32 messagesPerSecond)
+	{
+		rateLimit = messagesPerSecond;
+	}
+
+	bool Logger::PassesRateLimit(LogSite& site, Uint32& suppressed)
+	{
+		Uint32 now = SDL_GetTicks();
+		Uint32 windowStart = site.windowStart.load(std::memory_order_relaxed);
+
+		// start a new one second window, handing whatever was dropped in the last one to this message.
+		if (now - windowStart >= 1000 && site.windowStart.compare_exchange_strong(windowStart, now))
+		{
+			site.messagesInWindow = 0;
+			suppressed = site.suppressed.exchange(0);
+		}
+
+		if (site.messagesInWindow.fetch_add(1, std::memory_order_relaxed) >= rateLimit.load(std::memory_order_relaxed))
+		{
+			site.suppressed.fetch_add(1, std::memory_order_relaxed);
+			return false;
+		}
+
+		return true;
+	}
+
+	void Logger::PackArgument(LogRecord& record, const char* value)
+	{
+		PackBytes(record, ARGUMENT_STRING, value == NULL ? "(null)" : value, strlen(value == NULL ? "(null)" : value));
+	}
+
+	void Logger::PackArgument(LogRecord& record, const std::string& value)
+	{
+		PackBytes(record, ARGUMENT_STRING, value.c_str(), value.size());
+	}
+
+	void Logger::PackBytes(LogRecord& record, Uint8 type, const void* bytes, size_t size)
+	{
+		if (record.argumentCount >= LogRecord::MAX_ARGUMENTS)
+		{
+			return;
+		}
+
+		// strings get a length prefix and are cut short if they don't fit.
+		size_t available = LogRecord::PAYLOAD_SIZE - record.payloadSize;
+
+		if (type == ARGUMENT_STRING)
+		{
+			if (available < sizeof(Uint16))
+			{
+				return;
+			}
+
+			Uint16 length = (Uint16)SDL_min(size, available - sizeof(Uint16));
+			SDL_memcpy(record.payload + record.payloadSize, &length, sizeof(length));
+			SDL_memcpy(record.payload + record.payloadSize + sizeof(length), bytes, length);
+			record.payloadSize += (Uint16)(sizeof(length) + length);
+		}
+		else
+		{
+			if (available < size)
+			{
+				return;
+			}
+
+			SDL_memcpy(record.payload + record.payloadSize, bytes, size);
+			record.payloadSize += (Uint16)size;
+		}
+
+		record.argumentTypes[record.argumentCount++] = type;
+	}
+
+	Logger::ThreadBuffer* Logger::GetThreadBuffer()
+	{
+		#ifdef CRISPY_OCTO_SPORK_THREADS
+		static thread_local ThreadBufferOwner owner;
+
+		if (owner.buffer == NULL)
+		{
+			// only the first message from each thread takes the lock. a buffer left by a thread that has exited is
+			// taken over before a new one is made, anything still queued in it just goes out ahead of this thread's.
+			std::lock_guard<std::mutex> lock(buffersMutex);
+
+			for (auto& buffer : buffers)
+			{
+				bool expected = false;
+
+				if (buffer->owned.compare_exchange_strong(expected, true, std::memory_order_acquire))
+				{
+					owner.buffer = buffer.get();
+					break;
+				}
+			}
+
+			if (owner.buffer == NULL)
+			{
+				buffers.push_back(std::unique_ptr<ThreadBuffer>(new ThreadBuffer()));
+				owner.buffer = buffers.back().get();
+			}
+		}
+
+		return owner.buffer;
+		#else
+		return NULL;
+		#endif
+	}
+
+	void Logger::Enqueue(const LogRecord& record)
+	{
+		#ifdef CRISPY_OCTO_SPORK_THREADS
+		ThreadBuffer* buffer = GetThreadBuffer();
+
+		if (!buffer->ring.TryPush(record))
+		{
+			buffer->dropped.fetch_add(1, std::memory_order_relaxed);
+		}
+		#else
+		Output(record);
+		fflush(stdout);
+		#endif
+	}
+
+	bool Logger::Drain()
+	{
+		bool wroteAnything = false;
+
+		#ifdef CRISPY_OCTO_SPORK_THREADS
+		size_t bufferCount;
+		{
+			std::lock_guard<std::mutex> lock(buffersMutex);
+			bufferCount = buffers.size();
+		}
+
+		LogRecord record;
+
+		for (size_t i = 0; i < bufferCount; i++)
+		{
+			ThreadBuffer* buffer;
+			{
+				std::lock_guard<std::mutex> lock(buffersMutex);
+				buffer = buffers[i].get();
+			}
+
+			while (buffer->ring.TryPop(record))
+			{
+				Output(record);
+				wroteAnything = true;
+			}
+
+			Uint32 dropped = buffer->dropped.exchange(0);
+			if (dropped > 0)
+			{
+				fprintf(stdout, "[logger] dropped %u messages, the log queue was full\n", dropped);
+				wroteAnything = true;
+			}
+		}
+
+		if (wroteAnything)
+		{
+			fflush(stdout);
+		}
+		#endif
+
+		return wroteAnything;
+	}
+
+	void Logger::Flush()
+	{
+		#ifdef CRISPY_OCTO_SPORK_THREADS
+		std::unique_lock<std::mutex> lock(flushMutex);
+		Uint32 request = flushRequests.fetch_add(1) + 1;
+
+		flushRequested.notify_one();
+		flushed.wait(lock, [this, request]() { return !running || flushesCompleted.load() >= request; });
+		#endif
+	}
+
+	void Logger::WriterLoop()
+	{
+		#ifdef CRISPY_OCTO_SPORK_THREADS
+		while (running)
+		{
+			Uint32 request = flushRequests.load();
+			bool wroteAnything = Drain();
+
+			{
+				std::unique_lock<std::mutex> lock(flushMutex);
+				flushesCompleted = request;
+				flushed.notify_all();
+
+				// nothing to write, so sleep until the next poll unless someone is waiting on a flush.
+				if (!wroteAnything)
+				{
+					flushRequested.wait_for(lock, std::chrono::milliseconds(5), [this, request]() { return !running || flushRequests.load() != request; });
+				}
+			}
+		}
+		#endif
+	}
+
+	void Logger::Output(const LogRecord& record)
+	{
+		static const char* LEVEL_NAMES[] = { "debug", "info", "warn", "error" };
+
+		line.clear();
+
+		char number[64];
+		snprintf(number, sizeof(number), "[%10.4f %s] ", (double)(record.counter - startCounter) / (double)SDL_GetPerformanceFrequency(), LEVEL_NAMES[record.level]);
+		line += number;
+
+		// only now do we turn the packed arguments back into text.
+		const Uint8* payload = record.payload;
+		int argument = 0;
+
+		for (const char* c = record.format; *c != '\0'; c++)
+		{
+			if (c[0] != '{' || c[1] != '}' || argument >= record.argumentCount)
+			{
+				line += *c;
+				continue;
+			}
+
+			c++;
+
+			switch (record.argumentTypes[argument++])
+			{
+			case ARGUMENT_SIGNED:
+			{
+				Sint64 value;
+				SDL_memcpy(&value, payload, sizeof(value));
+				payload += sizeof(value);
+				snprintf(number, sizeof(number), "%lld", (long long)value);
+				line += number;
+				break;
+			}
+			case ARGUMENT_UNSIGNED:
+			{
+				Uint64 value;
+				SDL_memcpy(&value, payload, sizeof(value));
+				payload += sizeof(value);
+				snprintf(number, sizeof(number), "%llu", (unsigned long long)value);
+				line += number;
+				break;
+			}
+			case ARGUMENT_FLOAT:
+			{
+				double value;
+				SDL_memcpy(&value, payload, sizeof(value));
+				payload += sizeof(value);
+				snprintf(number, sizeof(number), "%g", value);
+				line += number;
+				break;
+			}
+			case ARGUMENT_STRING:
+			{
+				Uint16 length;
+				SDL_memcpy(&length, payload, sizeof(length));
+				line.append((const char*)payload + sizeof(length), length);
+				payload += sizeof(length) + length;
+				break;
+			}
+			}
+		}
+
+		if (record.suppressed > 0)
+		{
+			snprintf(number, sizeof(number), " (%u similar messages suppressed)", record.suppressed);
+			line += number;
+		}
+
+		line += '\n';
+		fwrite(line.data(), 1, line.size(), stdout);
+	}
+
+	MemoryTracker& MemoryTracker::Get()
+	{
+		static MemoryTracker tracker;
+		return tracker;
+	}
+
+	void* MemoryTracker::Allocate(size_t size, MemoryTag tag)
+	{
+		AllocationHeader* header = (AllocationHeader*)malloc(sizeof(AllocationHeader) + size);
+
+		if (header == NULL)
+		{
+			return NULL;
+		}
+
+		header->info.size = size;
+		header->info.tag = tag;
+		Charge(tag, (Sint64)size, true);
+
+		return header + 1;
+	}
+
+	void MemoryTracker::Free(void* pointer)
+	{
+		if (pointer == NULL)
+		{
+			return;
+		}
+
+		AllocationHeader* header = (AllocationHeader*)pointer - 1;
+		Charge(header->info.tag, -(Sint64)header->info.size, false);
+		free(header);
+	}
+
+	void MemoryTracker::AddExternal(MemoryTag tag, Sint64 bytes)
+	{
+		Charge(tag, bytes, true);
+	}
+
+	void MemoryTracker::RemoveExternal(MemoryTag tag, Sint64 bytes)
+	{
+		Charge(tag, -bytes, false);
+	}
+
+	void MemoryTracker::Charge(MemoryTag tag, Sint64 bytes, bool countAllocation)
+	{
+		Counters& tagCounters = counters[(int)tag];
+		Sint64 current = tagCounters.current.fetch_add(bytes, std::memory_order_relaxed) + bytes;
+
+		if (countAllocation)
+		{
+			tagCounters.allocations.fetch_add(1, std::memory_order_relaxed);
+		}
+
+		Sint64 peak = tagCounters.peak.load(std::memory_order_relaxed);
+		while (current > peak && !tagCounters.peak.compare_exchange_weak(peak, current, std::memory_order_relaxed))
+		{}
+
+		// warn once each time the tag crosses its budget rather than on every allocation over it.
+		Sint64 budget = tagCounters.budget.load(std::memory_order_relaxed);
+		bool overBudget = budget > 0 && current > budget;
+
+		if (tagCounters.overBudget.exchange(overBudget) != overBudget && overBudget)
+		{
+			COS_LOG_WARN("Memory for {} is over budget: {} of {} bytes", GetTagName(tag), current, budget);
+		}
+	}
+
+	void MemoryTracker::SetBudget(MemoryTag tag, Sint64 bytes)
+	{
+		counters[(int)tag].budget = bytes;
+	}
+
+	MemoryStats MemoryTracker::GetStats(MemoryTag tag)
+	{
+		Counters& tagCounters = counters[(int)tag];
+
+		MemoryStats stats;
+		stats.currentBytes = tagCounters.current.load(std::memory_order_relaxed);
+		stats.peakBytes = tagCounters.peak.load(std::memory_order_relaxed);
+		stats.allocationCount = tagCounters.allocations.load(std::memory_order_relaxed);
+		stats.budgetBytes = tagCounters.budget.load(std::memory_order_relaxed);
+		return stats;
+	}
+
+	void MemoryTracker::Dump()
+	{
+		COS_LOG_INFO("Memory by subsystem (KB):");
+
+		for (int i = 0; i < (int)MemoryTag::COUNT; i++)
+		{
+			MemoryStats stats = GetStats((MemoryTag)i);
+
+			COS_LOG_INFO("  {} current {} peak {} allocations {} budget {}", GetTagName((MemoryTag)i),
+				stats.currentBytes / 1024, stats.peakBytes / 1024, stats.allocationCount, stats.budgetBytes / 1024);
+		}
+	}
+
+	const char* MemoryTracker::GetTagName(MemoryTag tag)
+	{
+		static const char* TAG_NAMES[] = { "general", "entities", "particles", "textures", "fonts", "audio", "gameplay", "server" };
+		return TAG_NAMES[(int)tag];
+	}
+
+	bool ReadFileContents(const char* filepath, std::vector<Uint8>& contents)
+	{
+		SDL_RWops* file = SDL_RWFromFile(filepath, "rb");
+
+		if (file == NULL)
+		{
+			return false;
+		}
+
+		Sint64 size = SDL_RWsize(file);
+		contents.resize(size > 0 ? (size_t)size : 0);
+		size_t read = contents.empty() ? 0 : SDL_RWread(file, contents.data(), 1, contents.size());
+		SDL_RWclose(file);
+
+		return read == contents.size();
+	}
+
+	size_t FileBatch::AddRead(const std::string& filepath)
+	{
+		requests.push_back({ filepath, std::vector<Uint8>(), false, false });
+		return requests.size() - 1;
+	}
+
+	size_t FileBatch::AddWrite(const std::string& filepath, std::vector<Uint8> data)
+	{
+		requests.push_back({ filepath, std::move(data), true, false });
+		return requests.size() - 1;
+	}
+
+	FileIO& FileIO::Get()
+	{
+		static FileIO instance;
+		return instance;
+	}
+
+	FileIO::FileIO()
+	{
+		#ifdef CRISPY_OCTO_SPORK_IO_URING
+		ringReady = false;
+		ringFailed = false;
+		#endif
+
+		#ifdef CRISPY_OCTO_SPORK_THREADS
+		running = false;
+		#endif
+	}
+
+	FileIO::~FileIO()
+	{
+		Shutdown();
+	}
+
+	void FileIO::RunBlocking(FileRequest& request)
+	{
+		if (!request.write)
+		{
+			request.success = ReadFileContents(request.filepath.c_str(), request.data);
+			return;
+		}
+
+		SDL_RWops* file = SDL_RWFromFile(request.filepath.c_str(), "wb");
+
+		if (file == NULL)
+		{
+			request.success = false;
+			return;
+		}
+
+		size_t written = request.data.empty() ? 0 : SDL_RWwrite(file, request.data.data(), 1, request.data.size());
+		request.success = SDL_RWclose(file) == 0 && written == request.data.size();
+	}
+
+	bool FileIO::Run(FileBatch& batch)
+	{
+		bool ran = false;
+
+		#ifdef CRISPY_OCTO_SPORK_IO_URING
+		ran = RunRing(batch);
+		#endif
+
+		#ifdef CRISPY_OCTO_SPORK_THREADS
+		if (!ran)
+		{
+			int remaining = (int)batch.requests.size();
+
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+
+				if (!running)
+				{
+					running = true;
+
+					for (int i = 0; i < IO_THREADS; i++)
+					{
+						workers.push_back(std::thread([this]() { WorkerLoop(); }));
+					}
+				}
+
+				for (auto& request : batch.requests)
+				{
+					queue.push_back({ &request, &remaining });
+				}
+			}
+
+			requestAdded.notify_all();
+
+			std::unique_lock<std::mutex> lock(mutex);
+			requestFinished.wait(lock, [&remaining]() { return remaining == 0; });
+			ran = true;
+		}
+		#endif
+
+		if (!ran)
+		{
+			for (auto& request : batch.requests)
+			{
+				RunBlocking(request);
+			}
+		}
+
+		for (auto& request : batch.requests)
+		{
+			if (!request.success)
+			{
+				return false;
+			}
+		}
+
+		return true;
+	}
+
+	#ifdef CRISPY_OCTO_SPORK_THREADS
+	void FileIO::WorkerLoop()
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+
+		while (true)
+		{
+			requestAdded.wait(lock, [this]() { return !queue.empty() || !running; });
+
+			if (queue.empty())
+			{
+				return;
+			}
+
+			PooledRequest pooled = queue.back();
+			queue.pop_back();
+
+			lock.unlock();
+			RunBlocking(*pooled.request);
+			lock.lock();
+
+			(*pooled.remaining)--;
+			requestFinished.notify_all();
+		}
+	}
+	#endif
+
+	#ifdef CRISPY_OCTO_SPORK_IO_URING
+	bool FileIO::RunRing(FileBatch& batch)
+	{
+		std::lock_guard<std::mutex> lock(ringMutex);
+
+		if (!ringReady && !ringFailed)
+		{
+			// io_uring can be missing or blocked by seccomp, so fall back quietly.
+			ringReady = io_uring_queue_init(RING_DEPTH, &ring, 0) == 0;
+			ringFailed = !ringReady;
+
+			if (ringFailed)
+			{
+				COS_LOG_INFO("io_uring is unavailable, file io will use threads.");
+			}
+		}
+
+		if (!ringReady)
+		{
+			return false;
+		}
+
+		// opening is still a blocking call, but it's cheap next to the reads it lets us batch.
+		std::vector<int> files(batch.requests.size(), -1);
+		std::vector<size_t> offsets(batch.requests.size(), 0);
+		std::vector<size_t> pending;
+
+		for (size_t i = 0; i < batch.requests.size(); i++)
+		{
+			FileRequest& request = batch.requests[i];
+			request.success = false;
+
+			files[i] = request.write
+				? open(request.filepath.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644)
+				: open(request.filepath.c_str(), O_RDONLY | O_CLOEXEC);
+
+			if (files[i] < 0)
+			{
+				continue;
+			}
+
+			if (!request.write)
+			{
+				struct stat fileStat;
+
+				if (fstat(files[i], &fileStat) != 0)
+				{
+					close(files[i]);
+					files[i] = -1;
+					continue;
+				}
+
+				request.data.resize((size_t)fileStat.st_size);
+			}
+
+			if (request.data.empty())
+			{
+				request.success = true;
+				close(files[i]);
+				files[i] = -1;
+				continue;
+			}
+
+			pending.push_back(i);
+		}
+
+		size_t nextPending = 0;
+		unsigned inFlight = 0;
+		unsigned prepared = 0;
+		bool failed = false;
+
+		while (!failed && (nextPending < pending.size() || inFlight > 0 || prepared > 0))
+		{
+			while (nextPending < pending.size() && inFlight + prepared < RING_DEPTH)
+			{
+				io_uring_sqe* sqe = io_uring_get_sqe(&ring);
+
+				if (sqe == NULL)
+				{
+					break;
+				}
+
+				size_t index = pending[nextPending++];
+				FileRequest& request = batch.requests[index];
+				size_t offset = offsets[index];
+
+				if (request.write)
+				{
+					io_uring_prep_write(sqe, files[index], request.data.data() + offset, (unsigned)(request.data.size() - offset), offset);
+				}
+				else
+				{
+					io_uring_prep_read(sqe, files[index], request.data.data() + offset, (unsigned)(request.data.size() - offset), offset);
+				}
+
+				io_uring_sqe_set_data(sqe, (void*)(uintptr_t)index);
+				prepared++;
+			}
+
+			if (prepared > 0)
+			{
+				int submitted = io_uring_submit(&ring);
+
+				if (submitted >= 0)
+				{
+					prepared -= SDL_min((unsigned)submitted, prepared);
+					inFlight += submitted;
+				}
+				else if (submitted != -EINTR && ((submitted != -EAGAIN && submitted != -EBUSY) || inFlight == 0))
+				{
+					// short on resources is only worth waiting out when a completion is coming to free some.
+					COS_LOG_WARN("io_uring submit failed ({}), file io will use threads.", submitted);
+					failed = true;
+					break;
+				}
+			}
+
+			// interrupted before anything went in, so there's nothing to wait for yet.
+			if (inFlight == 0)
+			{
+				continue;
+			}
+
+			io_uring_cqe* cqe = NULL;
+			int waited;
+
+			do
+			{
+				waited = io_uring_wait_cqe(&ring, &cqe);
+			}
+			while (waited == -EINTR);
+
+			if (waited != 0)
+			{
+				COS_LOG_WARN("io_uring wait failed ({}), file io will use threads.", waited);
+				failed = true;
+				break;
+			}
+
+			// drain everything that's finished, not just the first completion.
+			while (cqe != NULL)
+			{
+				size_t index = (size_t)(uintptr_t)io_uring_cqe_get_data(cqe);
+				int result = cqe->res;
+				io_uring_cqe_seen(&ring, cqe);
+				inFlight--;
+
+				FileRequest& request = batch.requests[index];
+
+				if (result > 0)
+				{
+					offsets[index] += result;
+				}
+
+				if (result > 0 && offsets[index] < request.data.size())
+				{
+					// short read or write, queue the rest.
+					pending.push_back(index);
+				}
+				else
+				{
+					request.success = result > 0;
+					close(files[index]);
+					files[index] = -1;
+
+					if (!request.success && !request.write)
+					{
+						request.data.clear();
+					}
+				}
+
+				cqe = NULL;
+				if (io_uring_peek_cqe(&ring, &cqe) != 0)
+				{
+					cqe = NULL;
+				}
+			}
+		}
+
+		// the kernel could still be reading into the buffers, so they have to be done with before anything's closed.
+		if (failed)
+		{
+			FailRing();
+		}
+
+		for (int file : files)
+		{
+			if (file >= 0)
+			{
+				close(file);
+			}
+		}
+
+		// redoing the whole batch on the threads is safe, writes truncate and reads start over.
+		return !failed;
+	}
+
+	void FileIO::FailRing()
+	{
+		// tearing the ring down cancels and waits for its requests, which is the one way out when waiting itself fails.
+		io_uring_queue_exit(&ring);
+		ringReady = false;
+		ringFailed = true;
+	}
+	#endif
+
+	void FileIO::Shutdown()
+	{
+		#ifdef CRISPY_OCTO_SPORK_THREADS
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			running = false;
+		}
+
+		requestAdded.notify_all();
+
+		for (auto& worker : workers)
+		{
+			worker.join();
+		}
+
+		workers.clear();
+		#endif
+
+		#ifdef CRISPY_OCTO_SPORK_IO_URING
+		std::lock_guard<std::mutex> ringLock(ringMutex);
+
+		if (ringReady)
+		{
+			io_uring_queue_exit(&ring);
+			ringReady = false;
+		}
+		#endif
+	}
+
+	BenchmarkRunner::BenchmarkRunner()
+	{
+		runs = 20;
+		warmupRuns = 1;
+		alpha = 0.01;
+		minimumChange = 0.02;
+	}
+
+	void BenchmarkRunner::Add(const std::string& name, const std::string& unit, bool higherIsBetter, std::function<double()> measure, bool pinned)
+	{
+		benchmarks.push_back({ name, unit, higherIsBetter, pinned, measure, {} });
+	}
+
+	void BenchmarkRunner::SetRuns(int runs, int warmupRuns)
+	{
+		// the test can't call anything significant with fewer than a handful of samples each.
+		this->runs = SDL_max(runs, 5);
+		this->warmupRuns = SDL_max(warmupRuns, 0);
+	}
+
+	void BenchmarkRunner::SetSignificance(double alpha, double minimumChange)
+	{
+		this->alpha = alpha;
+		this->minimumChange = minimumChange;
+	}
+
+	bool BenchmarkRunner::Run()
+	{
+		// threads inherit the mask of the thread that makes them, so the callers thread never gets pinned.
+		#ifdef CRISPY_OCTO_SPORK_THREADS
+		bool succeeded = false;
+		std::thread thread([this, &succeeded]() { succeeded = RunOnCurrentThread(); });
+		thread.join();
+
+		return succeeded;
+		#else
+		bool succeeded = RunOnCurrentThread();
+		UnpinCurrentThread();
+
+		return succeeded;
+		#endif
+	}
+
+	bool BenchmarkRunner::RunOnCurrentThread()
+	{
+		// the last core is the least likely to be busy with interrupts.
+		int cpu = SDL_GetCPUCount() - 1;
+		bool pinned = false;
+		bool pinFailed = false;
+
+		for (auto& benchmark : benchmarks)
+		{
+			benchmark.samples.clear();
+		}
+
+		for (int run = 0; run < warmupRuns + runs; run++)
+		{
+			for (auto& benchmark : benchmarks)
+			{
+				if (benchmark.pinned && !pinned && !pinFailed)
+				{
+					pinned = PinCurrentThread(cpu);
+					pinFailed = !pinned;
+
+					if (pinFailed)
+					{
+						COS_LOG_WARN("Couldn't pin the benchmark thread, expect more noise");
+					}
+				}
+				else if (!benchmark.pinned && pinned)
+				{
+					UnpinCurrentThread();
+					pinned = false;
+				}
+
+				double measurement = benchmark.measure();
+
+				if (measurement < 0)
+				{
+					COS_LOG_ERR("Benchmark {} failed", benchmark.name);
+					return false;
+				}
+
+				if (run >= warmupRuns)
+				{
+					benchmark.samples.push_back(measurement);
+				}
+			}
+		}
+
+		COS_LOG_INFO("Benchmarks ({} runs, pinned ones on core {}):", runs, cpu);
+
+		for (auto& benchmark : benchmarks)
+		{
+			std::vector<double> sorted = benchmark.samples;
+			std::sort(sorted.begin(), sorted.end());
+
+			COS_LOG_INFO("  {}: median {} {}, min {}, max {}", benchmark.name, Median(sorted), benchmark.unit, sorted.front(), sorted.back());
+		}
+
+		return true;
+	}
+
+	bool BenchmarkRunner::SaveBaseline(const std::string& filepath)
+	{
+		// one line per benchmark: name, unit and direction, then every sample, separated by tabs.
+		std::string text;
+
+		for (auto& benchmark : benchmarks)
+		{
+			text += benchmark.name + "\t" + benchmark.unit + "\t" + (benchmark.higherIsBetter ? "higher" : "lower");
+
+			for (double sample : benchmark.samples)
+			{
+				char number[32];
+				SDL_snprintf(number, sizeof(number), "\t%.17g", sample);
+				text += number;
+			}
+
+			text += "\n";
+		}
+
+		FileBatch batch;
+		batch.AddWrite(filepath, std::vector<Uint8>(text.begin(), text.end()));
+
+		if (!FileIO::Get().Run(batch))
+		{
+			COS_LOG_ERR("Couldn't write the benchmark baseline to {}", filepath);
+			return false;
+		}
+
+		return true;
+	}
+
+	bool BenchmarkRunner::CompareWithBaseline(const std::string& filepath)
+	{
+		FileBatch batch;
+		size_t read = batch.AddRead(filepath);
+
+		if (!FileIO::Get().Run(batch))
+		{
+			COS_LOG_ERR("Couldn't read the benchmark baseline from {}", filepath);
+			return false;
+		}
+
+		std::map<std::string, std::vector<double>> baseline;
+		std::string text(batch.requests[read].data.begin(), batch.requests[read].data.end());
+		size_t lineStart = 0;
+
+		while (lineStart < text.size())
+		{
+			size_t lineEnd = text.find('\n', lineStart);
+			lineEnd = lineEnd == std::string::npos ? text.size() : lineEnd;
+			std::string line = text.substr(lineStart, lineEnd - lineStart);
+			lineStart = lineEnd + 1;
+
+			size_t nameEnd = line.find('\t');
+			if (nameEnd == std::string::npos)
+			{
+				continue;
+			}
+
+			// skip the unit and direction, the benchmark being run decides those.
+			std::vector<double>& samples = baseline[line.substr(0, nameEnd)];
+			size_t field = line.find('\t', line.find('\t', nameEnd + 1) + 1);
+
+			while (field != std::string::npos)
+			{
+				samples.push_back(SDL_strtod(line.c_str() + field + 1, NULL));
+				field = line.find('\t', field + 1);
+			}
+		}
+
+		bool regressed = false;
+		COS_LOG_INFO("Compared with {}:", filepath);
+
+		for (auto& benchmark : benchmarks)
+		{
+			auto entry = baseline.find(benchmark.name);
+
+			if (entry == baseline.end() || entry->second.empty())
+			{
+				COS_LOG_INFO("  {}: not in the baseline", benchmark.name);
+				continue;
+			}
+
+			double before = Median(entry->second);
+			double after = Median(benchmark.samples);
+			double change = before != 0 ? (after - before) / before : 0;
+			double pValue = MannWhitneyPValue(entry->second, benchmark.samples);
+			bool better = benchmark.higherIsBetter ? change > 0 : change < 0;
+
+			// a shift has to be both unlikely to be noise and big enough to care about.
+			const char* verdict = "no change";
+
+			if (pValue < alpha && SDL_fabs(change) >= minimumChange)
+			{
+				verdict = better ? "improved" : "REGRESSED";
+				regressed |= !better;
+			}
+
+			COS_LOG_INFO("  {}: {} -> {} {} ({}%, p = {}) {}", benchmark.name, before, after, benchmark.unit, change * 100.0, pValue, verdict);
+		}
+
+		return !regressed;
+	}
+
+	double BenchmarkRunner::MannWhitneyPValue(const std::vector<double>& first, const std::vector<double>& second)
+	{
+		double firstCount = (double)first.size();
+		double secondCount = (double)second.size();
+
+		if (first.empty() || second.empty())
+		{
+			return 1.0;
+		}
+
+		// rank both samples together, ties get the average of the ranks they span.
+		std::vector<std::pair<double, int>> pooled;
+
+		for (double sample : first)
+		{
+			pooled.push_back({ sample, 0 });
+		}
+
+		for (double sample : second)
+		{
+			pooled.push_back({ sample, 1 });
+		}
+
+		std::sort(pooled.begin(), pooled.end());
+
+		double firstRankSum = 0;
+		double tieCorrection = 0;
+		size_t i = 0;
+
+		while (i < pooled.size())
+		{
+			size_t tieEnd = i;
+			while (tieEnd + 1 < pooled.size() && pooled[tieEnd + 1].first == pooled[i].first)
+			{
+				tieEnd++;
+			}
+
+			double tied = (double)(tieEnd - i + 1);
+			double rank = (i + tieEnd) / 2.0 + 1.0;
+			tieCorrection += tied * tied * tied - tied;
+
+			for (size_t j = i; j <= tieEnd; j++)
+			{
+				if (pooled[j].second == 0)
+				{
+					firstRankSum += rank;
+				}
+			}
+
+			i = tieEnd + 1;
+		}
+
+		double total = firstCount + secondCount;
+		double u = firstRankSum - firstCount * (firstCount + 1) / 2.0;
+		double mean = firstCount * secondCount / 2.0;
+		double variance = firstCount * secondCount / 12.0 * ((total + 1) - tieCorrection / (total * (total - 1)));
+
+		if (variance <= 0)
+		{
+			// every sample is identical.
+			return 1.0;
+		}
+
+		// continuity correction, then the two sided tail of the normal distribution.
+		double z = SDL_max(SDL_fabs(u - mean) - 0.5, 0.0) / SDL_sqrt(variance);
+		return erfc(z / SDL_sqrt(2.0));
+	}
+
+	double BenchmarkRunner::Median(std::vector<double> samples)
+	{
+		if (samples.empty())
+		{
+			return 0;
+		}
+
+		std::sort(samples.begin(), samples.end());
+		size_t middle = samples.size() / 2;
+
+		return samples.size() % 2 == 0 ? (samples[middle - 1] + samples[middle]) / 2.0 : samples[middle];
+	}
+
+	bool BenchmarkRunner::PinCurrentThread(int cpu)
+	{
+		SDL_SetThreadPriority(SDL_THREAD_PRIORITY_HIGH);
+
+		#if defined(_WIN32)
+		return SetThreadAffinityMask(GetCurrentThread(), (DWORD_PTR)1 << cpu) != 0;
+		#elif defined(__linux__) && !defined(__EMSCRIPTEN__)
+		cpu_set_t cpus;
+		CPU_ZERO(&cpus);
+		CPU_SET(cpu, &cpus);
+		return pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus) == 0;
+		#else
+		return false;
+		#endif
+	}
+
+	void BenchmarkRunner::UnpinCurrentThread()
+	{
+		SDL_SetThreadPriority(SDL_THREAD_PRIORITY_NORMAL);
+
+		#if defined(_WIN32)
+		DWORD_PTR processMask;
+		DWORD_PTR systemMask;
+
+		if (GetProcessAffinityMask(GetCurrentProcess(), &processMask, &systemMask))
+		{
+			SetThreadAffinityMask(GetCurrentThread(), processMask);
+		}
+		#elif defined(__linux__) && !defined(__EMSCRIPTEN__)
+		// the main thread's mask, which nothing here pins, stands in for the process's.
+		cpu_set_t cpus;
+
+		if (sched_getaffinity(getpid(), sizeof(cpus), &cpus) == 0)
+		{
+			pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus);
+		}
+		#endif
+	}
+
+	Telemetry& Telemetry::Get()
+	{
+		static Telemetry telemetry;
+		return telemetry;
+	}
+
+	Telemetry::Telemetry()
+	{
+		recording = false;
+		maxFileBytes = 0;
+		maxFiles = 0;
+		fileBytes = 0;
+		sessionStartCounter = 0;
+		lastWrite = 0;
+
+		#ifdef CRISPY_OCTO_SPORK_THREADS
+		running = false;
+		#endif
+	}
+
+	Telemetry::~Telemetry()
+	{
+		Close();
+	}
+
+	void Telemetry::Open(const std::string& filePrefix, Uint32 maxFileBytes, int maxFiles)
+	{
+		Close();
+
+		this->filePrefix = filePrefix;
+		this->maxFileBytes = maxFileBytes;
+		this->maxFiles = SDL_max(maxFiles, 1);
+		this->fileBytes = 0;
+
+		// carry on appending to whatever the last session left behind.
+		SDL_RWops* file = SDL_RWFromFile(GetFilePath(0).c_str(), "rb");
+
+		if (file != NULL)
+		{
+			Sint64 size = SDL_RWsize(file);
+			fileBytes = size > 0 ? (Uint64)size : 0;
+			SDL_RWclose(file);
+		}
+
+		// throw away anything recorded after the last session closed.
+		Drain();
+		batch.clear();
+
+		sessionStartCounter = SDL_GetPerformanceCounter();
+		lastWrite = SDL_GetTicks();
+		recording = true;
+
+		Uint64 wallClock = (Uint64)time(NULL);
+		Record((Uint32)TelemetryEventType::SESSION_START, (Sint32)(wallClock & 0xFFFFFFFF), (Sint32)(wallClock >> 32));
+
+		#ifdef CRISPY_OCTO_SPORK_THREADS
+		running = true;
+		writer = std::thread([this]() { WriterLoop(); });
+		#endif
+	}
+
+	void Telemetry::Close()
+	{
+		if (!recording)
+		{
+			return;
+		}
+
+		recording = false;
+
+		#ifdef CRISPY_OCTO_SPORK_THREADS
+		{
+			std::lock_guard<std::mutex> lock(wakeMutex);
+			running = false;
+		}
+
+		wake.notify_all();
+		writer.join();
+		#endif
+
+		// the writer is gone, so this thread is the only consumer left.
+		WriteBatch();
+	}
+
+	bool Telemetry::IsRecording()
+	{
+		return recording;
+	}
+
+	void Telemetry::Update()
+	{
+		#ifndef CRISPY_OCTO_SPORK_THREADS
+		if (recording && SDL_GetTicks() - lastWrite >= FLUSH_INTERVAL)
+		{
+			WriteBatch();
+			lastWrite = SDL_GetTicks();
+		}
+		#endif
+	}
+
+	Telemetry::ThreadBuffer* Telemetry::GetThreadBuffer()
+	{
+		#ifdef CRISPY_OCTO_SPORK_THREADS
+		static thread_local ThreadBuffer* threadBuffer = NULL;
+
+		if (threadBuffer == NULL)
+		{
+			// only the first event from each thread takes the lock.
+			std::lock_guard<std::mutex> lock(buffersMutex);
+			buffers.push_back(std::unique_ptr<ThreadBuffer>(new ThreadBuffer()));
+			threadBuffer = buffers.back().get();
+		}
+
+		return threadBuffer;
+		#else
+		return &onlyBuffer;
+		#endif
+	}
+
+	void Telemetry::WriterLoop()
+	{
+		#ifdef CRISPY_OCTO_SPORK_THREADS
+		std::unique_lock<std::mutex> lock(wakeMutex);
+
+		while (running)
+		{
+			// events are rare next to frames, so waiting a while makes for fewer, bigger blocks.
+			wake.wait_for(lock, std::chrono::milliseconds((Uint32)FLUSH_INTERVAL), [this]() { return !running; });
+
+			lock.unlock();
+			WriteBatch();
+			lock.lock();
+		}
+		#endif
+	}
+
+	void Telemetry::Drain()
+	{
+		Uint32 dropped = 0;
+		TelemetryEvent event;
+
+		#ifdef CRISPY_OCTO_SPORK_THREADS
+		size_t bufferCount;
+		{
+			std::lock_guard<std::mutex> lock(buffersMutex);
+			bufferCount = buffers.size();
+		}
+
+		for (size_t i = 0; i < bufferCount; i++)
+		{
+			ThreadBuffer* buffer;
+			{
+				std::lock_guard<std::mutex> lock(buffersMutex);
+				buffer = buffers[i].get();
+			}
+
+			while (buffer->ring.TryPop(event))
+			{
+				batch.push_back(event);
+			}
+
+			dropped += buffer->dropped.exchange(0);
+		}
+		#else
+		while (onlyBuffer.ring.TryPop(event))
+		{
+			batch.push_back(event);
+		}
+
+		dropped = onlyBuffer.dropped.exchange(0);
+		#endif
+
+		if (dropped > 0)
+		{
+			COS_LOG_WARN("Dropped {} telemetry events, the queue was full", dropped);
+		}
+	}
+
+	void Telemetry::WriteBatch()
+	{
+		Drain();
+
+		if (batch.empty())
+		{
+			return;
+		}
+
+		// the rings are merged so the times only ever go forward, which keeps the deltas small.
+		std::stable_sort(batch.begin(), batch.end(), [](const TelemetryEvent& first, const TelemetryEvent& second)
+		{
+			return first.time < second.time;
+		});
+
+		// each event: type, microseconds since the last event, a byte saying which values aren't zero, then those values zigzagged.
+		double microsecondsPerCount = 1000000.0 / (double)SDL_GetPerformanceFrequency();
+		Uint64 previousTime = 0;
+		block.assign(12, 0);
+
+		for (auto& batched : batch)
+		{
+			Uint64 microseconds = batched.time > sessionStartCounter ? (Uint64)((batched.time - sessionStartCounter) * microsecondsPerCount) : 0;
+			microseconds = SDL_max(microseconds, previousTime);
+
+			PackVarint(block, batched.type);
+			PackVarint(block, microseconds - previousTime);
+			previousTime = microseconds;
+
+			Uint8 present = 0;
+			for (int i = 0; i < 5; i++)
+			{
+				present |= batched.values[i] != 0 ? (Uint8)(1 << i) : 0;
+			}
+
+			block.push_back(present);
+
+			for (int i = 0; i < 5; i++)
+			{
+				if (batched.values[i] != 0)
+				{
+					Sint64 value = batched.values[i];
+					PackVarint(block, ((Uint64)value << 1) ^ (Uint64)(value >> 63));
+				}
+			}
+		}
+
+		// block header: magic, event count and payload size.
+		Uint32 header[3] = { BLOCK_MAGIC, (Uint32)batch.size(), (Uint32)(block.size() - 12) };
+		for (int i = 0; i < 12; i++)
+		{
+			block[i] = (Uint8)(header[i / 4] >> ((i % 4) * 8));
+		}
+
+		batch.clear();
+
+		SDL_RWops* file = SDL_RWFromFile(GetFilePath(0).c_str(), "ab");
+
+		if (file == NULL)
+		{
+			COS_LOG_ERR("Could not open the telemetry file {}: {}", GetFilePath(0), SDL_GetError());
+			return;
+		}
+
+		SDL_RWwrite(file, block.data(), 1, block.size());
+		SDL_RWclose(file);
+		fileBytes += block.size();
+
+		if (fileBytes >= maxFileBytes)
+		{
+			Rotate();
+		}
+	}
+
+	void Telemetry::Rotate()
+	{
+		remove(GetFilePath(maxFiles - 1).c_str());
+
+		for (int i = maxFiles - 1; i > 0; i--)
+		{
+			rename(GetFilePath(i - 1).c_str(), GetFilePath(i).c_str());
+		}
+
+		fileBytes = 0;
+	}
+
+	std::string Telemetry::GetFilePath(int index)
+	{
+		return index == 0 ? filePrefix + ".bin" : filePrefix + "." + std::to_string(index) + ".bin";
+	}
+
+	void Telemetry::PackVarint(std::vector<Uint8>& bytes, Uint64 value)
+	{
+		while (value >= 0x80)
+		{
+			bytes.push_back((Uint8)(value | 0x80));
+			value >>= 7;
+		}
+
+		bytes.push_back((Uint8)value);
+	}
+
+	bool Telemetry::UnpackVarint(const std::vector<Uint8>& data, size_t& offset, size_t end, Uint64& value)
+	{
+		value = 0;
+
+		for (int shift = 0; shift < 64 && offset < end; shift += 7)
+		{
+			Uint8 byte = data[offset++];
+			value |= (Uint64)(byte & 0x7F) << shift;
+
+			if ((byte & 0x80) == 0)
+			{
+				return true;
+			}
+		}
+
+		return false;
+	}
+
+	bool Telemetry::Decode(const std::vector<Uint8>& data, std::vector<TelemetryEvent>& events)
+	{
+		size_t offset = 0;
+
+		while (offset < data.size())
+		{
+			if (data.size() - offset < 12)
+			{
+				return false;
+			}
+
+			Uint32 header[3] = { 0, 0, 0 };
+			for (int i = 0; i < 12; i++)
+			{
+				header[i / 4] |= (Uint32)data[offset + i] << ((i % 4) * 8);
+			}
+
+			size_t end = offset + 12 + header[2];
+
+			// a crash halfway through a write leaves a short block at the end.
+			if (header[0] != BLOCK_MAGIC || end > data.size())
+			{
+				return false;
+			}
+
+			offset += 12;
+			Uint64 microseconds = 0;
+
+			for (Uint32 i = 0; i < header[1]; i++)
+			{
+				TelemetryEvent event = {};
+				Uint64 type;
+				Uint64 delta;
+
+				if (!UnpackVarint(data, offset, end, type) || !UnpackVarint(data, offset, end, delta) || offset >= end)
+				{
+					return false;
+				}
+
+				microseconds += delta;
+				event.time = microseconds;
+				event.type = (Uint32)type;
+				Uint8 present = data[offset++];
+
+				for (int j = 0; j < 5; j++)
+				{
+					Uint64 zigzag = 0;
+
+					if ((present & (1 << j)) != 0 && !UnpackVarint(data, offset, end, zigzag))
+					{
+						return false;
+					}
+
+					event.values[j] = (Sint32)((Sint64)(zigzag >> 1) ^ -(Sint64)(zigzag & 1));
+				}
+
+				events.push_back(event);
+			}
+
+			offset = end;
+		}
+
+		return true;
+	}
+
+	void SceneAssets::AddTexture(const char* filepath)
+	{
+		texturePaths.push_back(filepath);
+	}
+
+	void SceneAssets::AddSound(const char* filepath)
+	{
+		soundPaths.push_back(filepath);
+	}
+
+	AssetCache::AssetCache()
+	{
+		renderer = NULL;
+		textureBudget = 0;
+		evictions = 0;
+		reloads = 0;
+		overBudgetWarned = false;
+
+		#ifdef CRISPY_OCTO_SPORK_THREADS
+		running = false;
+		#endif
+	}
+
+	AssetCache::~AssetCache()
+	{
+		Shutdown();
+	}
+
+	void AssetCache::SetRenderer(Renderer* renderer)
+	{
+		this->renderer = renderer;
+	}
+
+	void AssetCache::Preload(const SceneAssets& assets)
+	{
+		for (auto& path : assets.texturePaths)
+		{
+			Queue(path, true);
+		}
+
+		for (auto& path : assets.soundPaths)
+		{
+			Queue(path, false);
+		}
+	}
+
+	void AssetCache::LoadNow(const SceneAssets& assets)
+	{
+		for (auto& path : assets.texturePaths)
+		{
+			GetTexture(path);
+		}
+
+		for (auto& path : assets.soundPaths)
+		{
+			GetSound(path);
+		}
+	}
+
+	void AssetCache::Queue(const std::string& filepath, bool isTexture)
+	{
+		#ifdef CRISPY_OCTO_SPORK_THREADS
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+
+			if (isTexture ? textures.count(filepath) != 0 : sounds.count(filepath) != 0)
+			{
+				return;
+			}
+
+			if (isTexture)
+			{
+				textures[filepath];
+			}
+			else
+			{
+				sounds[filepath];
+			}
+
+			jobs.push_back({ filepath, isTexture });
+
+			if (!running)
+			{
+				running = true;
+				worker = std::thread([this]() { WorkerLoop(); });
+			}
+		}
+
+		jobAdded.notify_one();
+		#else
+		if (isTexture ? textures.count(filepath) != 0 : sounds.count(filepath) != 0)
+		{
+			return;
+		}
+
+		if (isTexture)
+		{
+			textures[filepath];
+		}
+		else
+		{
+			sounds[filepath];
+		}
+
+		Decode({ { filepath, isTexture } });
+		#endif
+	}
+
+	void AssetCache::WorkerLoop()
+	{
+		#ifdef CRISPY_OCTO_SPORK_THREADS
+		std::unique_lock<std::mutex> lock(mutex);
+
+		while (true)
+		{
+			jobAdded.wait(lock, [this]() { return !jobs.empty() || !running; });
+
+			if (!running)
+			{
+				return;
+			}
+
+			// take everything queued so its files can be read as one batch.
+			std::vector<Job> batchJobs;
+			batchJobs.swap(jobs);
+
+			lock.unlock();
+			Decode(batchJobs);
+			lock.lock();
+
+			jobFinished.notify_all();
+		}
+		#endif
+	}
+
+	void AssetCache::Decode(const std::vector<Job>& batchJobs)
+	{
+		// read every file together, trying the baked copy of each image first.
+		FileBatch reads;
+		for (auto& job : batchJobs)
+		{
+			reads.AddRead(job.isTexture ? Texture::GetBakedPath(job.filepath.c_str()) : job.filepath);
+		}
+
+		FileIO::Get().Run(reads);
+
+		FileBatch fallbacks;
+		std::vector<size_t> fallbackJobs;
+		for (size_t i = 0; i < batchJobs.size(); i++)
+		{
+			FileRequest& read = reads.requests[i];
+
+			if (batchJobs[i].isTexture && (!read.success || !Texture::IsBakeCurrent(read.data.data(), read.data.size(), batchJobs[i].filepath.c_str())))
+			{
+				fallbacks.AddRead(batchJobs[i].filepath);
+				fallbackJobs.push_back(i);
+			}
+		}
+
+		if (!fallbackJobs.empty())
+		{
+			FileIO::Get().Run(fallbacks);
+
+			for (size_t i = 0; i < fallbackJobs.size(); i++)
+			{
+				reads.requests[fallbackJobs[i]] = std::move(fallbacks.requests[i]);
+			}
+		}
+
+		// decoding only touches the cpu, anything needing the renderer waits for the main thread.
+		for (size_t i = 0; i < batchJobs.size(); i++)
+		{
+			const Job& job = batchJobs[i];
+			FileRequest& file = reads.requests[i];
+
+			if (job.isTexture)
+			{
+				std::vector<Uint8> baked;
+				SDL_Surface* surface = NULL;
+
+				if (file.success && Texture::IsBakedTexture(file.data.data(), file.data.size()))
+				{
+					baked.swap(file.data);
+				}
+				else if (file.success)
+				{
+					surface = IMG_Load_RW(SDL_RWFromConstMem(file.data.data(), (int)file.data.size()), 1);
+				}
+
+				#ifdef CRISPY_OCTO_SPORK_THREADS
+				std::lock_guard<std::mutex> lock(mutex);
+				#endif
+				TextureAsset& asset = textures[job.filepath];
+				asset.baked.swap(baked);
+				asset.surface = surface;
+				asset.state = asset.baked.empty() && surface == NULL ? AssetState::FAILED : AssetState::DECODED;
+
+				if (asset.state == AssetState::FAILED)
+				{
+					COS_LOG_ERR("Could not load the texture from: {} Error:{}", job.filepath, IMG_GetError());
+				}
+			}
+			else
+			{
+				SoundEffect* sound = new SoundEffect();
+				bool loaded = file.success && sound->LoadSoundFromMemory(file.data.data(), file.data.size());
+
+				if (!file.success)
+				{
+					COS_LOG_ERR("Could not read the sound: {}", job.filepath);
+				}
+
+				#ifdef CRISPY_OCTO_SPORK_THREADS
+				std::lock_guard<std::mutex> lock(mutex);
+				#endif
+				SoundAsset& asset = sounds[job.filepath];
+				asset.sound = sound;
+				asset.state = loaded ? AssetState::READY : AssetState::FAILED;
+			}
+		}
+	}
+
+	void AssetCache::Upload(TextureAsset& asset)
+	{
+		// reloads go back into the texture that was handed out, so nobody holding it has to ask again.
+		Texture* texture = asset.texture != NULL ? asset.texture : new Texture(renderer);
+		bool loaded = asset.surface != NULL
+			? texture->LoadFromSurface(asset.surface)
+			: texture->LoadTextureFromBakedMemory(asset.baked.data(), asset.baked.size());
+
+		if (asset.surface != NULL)
+		{
+			SDL_FreeSurface(asset.surface);
+			asset.surface = NULL;
+		}
+
+		std::vector<Uint8>().swap(asset.baked);
+		asset.texture = texture;
+		asset.state = loaded ? AssetState::READY : AssetState::FAILED;
+
+		// counts as used, or a texture preloaded for the next scene could be evicted before it's ever drawn.
+		texture->MarkUsed();
+	}
+
+	void AssetCache::Reload(const std::string& filepath, TextureAsset& asset)
+	{
+		asset.state = AssetState::QUEUED;
+		reloads++;
+
+		#ifdef CRISPY_OCTO_SPORK_THREADS
+		jobs.push_back({ filepath, true });
+		jobAdded.notify_one();
+		#else
+		Decode({ { filepath, true } });
+		#endif
+	}
+
+	void AssetCache::EnforceTextureBudget()
+	{
+		if (textureBudget <= 0 || renderer == NULL)
+		{
+			return;
+		}
+
+		Sint64 used = MemoryTracker::Get().GetStats(MemoryTag::TEXTURES).currentBytes;
+
+		if (used <= textureBudget)
+		{
+			overBudgetWarned = false;
+			return;
+		}
+
+		// anything drawn last frame is likely to be drawn again this one, so it stays even if that leaves us over.
+		Uint32 frame = renderer->GetFrame();
+		std::vector<TextureAsset*> candidates;
+
+		for (auto& entry : textures)
+		{
+			TextureAsset& asset = entry.second;
+
+			if (asset.state == AssetState::READY && asset.texture->GetSDLTexture() != NULL && asset.texture->GetLastUsedFrame() + 1 < frame)
+			{
+				candidates.push_back(&asset);
+			}
+		}
+
+		std::sort(candidates.begin(), candidates.end(), [](TextureAsset* a, TextureAsset* b)
+		{
+			return a->texture->GetLastUsedFrame() < b->texture->GetLastUsedFrame();
+		});
+
+		for (size_t i = 0; i < candidates.size() && used > textureBudget; i++)
+		{
+			used -= candidates[i]->texture->GetTextureBytes();
+			candidates[i]->texture->Evict();
+			candidates[i]->state = AssetState::EVICTED;
+			candidates[i]->evictedFrame = frame;
+			evictions++;
+		}
+
+		if (used > textureBudget && !overBudgetWarned)
+		{
+			COS_LOG_WARN("Textures drawn last frame need {} bytes, over the texture budget of {}", used, textureBudget);
+			overBudgetWarned = true;
+		}
+	}
+
+	void AssetCache::SetTextureBudget(Sint64 bytes)
+	{
+		#ifdef CRISPY_OCTO_SPORK_THREADS
+		std::lock_guard<std::mutex> lock(mutex);
+		#endif
+
+		textureBudget = bytes;
+		overBudgetWarned = false;
+	}
+
+	TextureCacheStats AssetCache::GetTextureStats()
+	{
+		#ifdef CRISPY_OCTO_SPORK_THREADS
+		std::lock_guard<std::mutex> lock(mutex);
+		#endif
+
+		return { textureBudget, MemoryTracker::Get().GetStats(MemoryTag::TEXTURES).currentBytes, evictions, reloads };
+	}
+
+	void AssetCache::Update()
+	{
+		std::vector<TextureAsset*> uploads;
+
+		{
+			#ifdef CRISPY_OCTO_SPORK_THREADS
+			std::lock_guard<std::mutex> lock(mutex);
+			#endif
+
+			// anything drawn since it was evicted goes back to the background thread, and draws nothing until it's uploaded.
+			for (auto& entry : textures)
+			{
+				if (entry.second.state == AssetState::EVICTED && entry.second.texture->GetLastUsedFrame() >= entry.second.evictedFrame)
+				{
+					Reload(entry.first, entry.second);
+				}
+			}
+
+			// map entries never move, so these stay valid after the lock is let go.
+			for (auto& entry : textures)
+			{
+				if (entry.second.state == AssetState::DECODED)
+				{
+					entry.second.state = AssetState::UPLOADING;
+					uploads.push_back(&entry.second);
+				}
+			}
+		}
+
+		for (TextureAsset* asset : uploads)
+		{
+			Upload(*asset);
+		}
+
+		#ifdef CRISPY_OCTO_SPORK_THREADS
+		std::lock_guard<std::mutex> lock(mutex);
+		#endif
+
+		EnforceTextureBudget();
+	}
+
+	Texture* AssetCache::GetTexture(const std::string& filepath)
+	{
+		Queue(filepath, true);
+
+		#ifdef CRISPY_OCTO_SPORK_THREADS
+		std::unique_lock<std::mutex> lock(mutex);
+		#endif
+
+		// asking for an evicted texture by name means it's wanted now, not whenever it's next drawn.
+		if (textures[filepath].state == AssetState::EVICTED)
+		{
+			Reload(filepath, textures[filepath]);
+		}
+
+		#ifdef CRISPY_OCTO_SPORK_THREADS
+		jobFinished.wait(lock, [this, &filepath]() { return textures[filepath].state != AssetState::QUEUED; });
+		#endif
+
+		TextureAsset& asset = textures[filepath];
+
+		if (asset.state == AssetState::DECODED)
+		{
+			asset.state = AssetState::UPLOADING;
+
+			#ifdef CRISPY_OCTO_SPORK_THREADS
+			lock.unlock();
+			#endif
+
+			Upload(asset);
+		}
+
+		// hand out an empty texture on failure so it renders nothing, the same as a failed LoadTextureFromFile.
+		if (asset.texture == NULL)
+		{
+			asset.texture = new Texture(renderer);
+		}
+
+		return asset.texture;
+	}
+
+	SoundEffect* AssetCache::GetSound(const std::string& filepath)
+	{
+		Queue(filepath, false);
+
+		#ifdef CRISPY_OCTO_SPORK_THREADS
+		std::unique_lock<std::mutex> lock(mutex);
+		jobFinished.wait(lock, [this, &filepath]() { return sounds[filepath].state != AssetState::QUEUED; });
+		#endif
+
+		return sounds[filepath].state == AssetState::READY ? sounds[filepath].sound : NULL;
+	}
+
+	void AssetCache::Shutdown()
+	{
+		#ifdef CRISPY_OCTO_SPORK_THREADS
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			bool wasRunning = running;
+			running = false;
+			jobs.clear();
+
+			if (!wasRunning)
+			{
+				goto stopped;
+			}
+		}
+
+		jobAdded.notify_all();
+		worker.join();
+
+	stopped:
+		#endif
+
+		for (auto& entry : textures)
+		{
+			if (entry.second.surface != NULL)
+			{
+				SDL_FreeSurface(entry.second.surface);
+			}
+
+			delete entry.second.texture;
+		}
+
+		for (auto& entry : sounds)
+		{
+			delete entry.second.sound;
+		}
+
+		textures.clear();
+		sounds.clear();
+	}
+
+	Scene::Scene()
+	{
+		engine = NULL;
+	}
+
+	Scene::~Scene()
+	{}
+
+	void Scene::DeclareAssets(SceneAssets& assets)
+	{}
+
+	void Scene::OnEnter()
+	{}
+
+	void Scene::OnExit()
+	{}
+
+	bool Scene::OnEvent(SDL_Event event)
+	{
+		return true;
+	}
+
+	bool Scene::OnUpdate(float deltaTime)
+	{
+		return true;
+	}
+
+	bool Scene::OnRender(float deltaTime)
+	{
+		return true;
+	}
+
+	void Scene::OnQueueSprites(SpriteBatch& sprites)
+	{
+	}
+
+	bool Scene::IsOverlay()
+	{
+		return false;
+	}
+
+	Arena::Arena(size_t blockSize, MemoryTag tag)
+	{
+		this->blocks = NULL;
+		this->current = NULL;
+		this->offset = 0;
+		this->blockSize = blockSize;
+		this->bytesUsed = 0;
+		this->tag = tag;
+	}
+
+	Arena::~Arena()
+	{
+		while (blocks != NULL)
+		{
+			Block* next = blocks->next;
+			MemoryTracker::Get().Free(blocks);
+			blocks = next;
+		}
+	}
+
+	void* Arena::Allocate(size_t size, size_t alignment)
+	{
+		const size_t HEADER_SIZE = (sizeof(Block) + alignof(std::max_align_t) - 1) & ~(alignof(std::max_align_t) - 1);
+
+		while (true)
+		{
+			if (current != NULL)
+			{
+				size_t aligned = (offset + alignment - 1) & ~(alignment - 1);
+
+				if (aligned + size <= current->size)
+				{
+					offset = aligned + size;
+					bytesUsed += size;
+					return (Uint8*)current + HEADER_SIZE + aligned;
+				}
+
+				// blocks from before a reset get used again before anything new is allocated.
+				if (current->next != NULL)
+				{
+					current = current->next;
+					offset = 0;
+					continue;
+				}
+			}
+
+			// anything bigger than a block gets a block of its own.
+			size_t newSize = SDL_max(blockSize, size + alignment);
+			Block* block = (Block*)MemoryTracker::Get().Allocate(HEADER_SIZE + newSize, tag);
+
+			if (block == NULL)
+			{
+				return NULL;
+			}
+
+			block->next = NULL;
+			block->size = newSize;
+
+			if (current != NULL)
+			{
+				current->next = block;
+			}
+			else
+			{
+				blocks = block;
+			}
+
+			current = block;
+			offset = 0;
+		}
+	}
+
+	void Arena::Reset()
+	{
+		current = blocks;
+		offset = 0;
+		bytesUsed = 0;
+	}
+
+	size_t Arena::GetBytesUsed()
+	{
+		return bytesUsed;
+	}
+
+	#ifdef CRISPY_OCTO_SPORK_COROUTINES
+	CoroutineFrameAllocator& CoroutineFrameAllocator::Get()
+	{
+		static CoroutineFrameAllocator instance;
+		return instance;
+	}
+
+	CoroutineFrameAllocator::CoroutineFrameAllocator()
+	{
+		for (int i = 0; i < SIZE_CLASSES; i++)
+		{
+			freeLists[i] = NULL;
+		}
+	}
+
+	void* CoroutineFrameAllocator::Allocate(size_t size)
+	{
+		size_t sizeClass = (size + GRANULARITY - 1) / GRANULARITY - 1;
+
+		// frames too big to pool are rare, so they just come straight from the tracker.
+		if (sizeClass >= (size_t)SIZE_CLASSES)
+		{
+			return MemoryTracker::Get().Allocate(size, MemoryTag::GAMEPLAY);
+		}
+
+		FreeFrame* frame = freeLists[sizeClass];
+
+		if (frame != NULL)
+		{
+			freeLists[sizeClass] = frame->next;
+			return frame;
+		}
+
+		return MemoryTracker::Get().Allocate((sizeClass + 1) * GRANULARITY, MemoryTag::GAMEPLAY);
+	}
+
+	void CoroutineFrameAllocator::Free(void* pointer, size_t size)
+	{
+		size_t sizeClass = (size + GRANULARITY - 1) / GRANULARITY - 1;
+
+		if (sizeClass >= (size_t)SIZE_CLASSES)
+		{
+			MemoryTracker::Get().Free(pointer);
+			return;
+		}
+
+		FreeFrame* frame = (FreeFrame*)pointer;
+		frame->next = freeLists[sizeClass];
+		freeLists[sizeClass] = frame;
+	}
+
+	void CoroutineFrameAllocator::Trim()
+	{
+		for (int i = 0; i < SIZE_CLASSES; i++)
+		{
+			while (freeLists[i] != NULL)
+			{
+				FreeFrame* frame = freeLists[i];
+				freeLists[i] = frame->next;
+				MemoryTracker::Get().Free(frame);
+			}
+		}
+	}
+
+	CoroutineScheduler::CoroutineScheduler()
+	{
+		nextId = 1;
+		frame = 0;
+		time = 0;
+		updating = false;
+		running.reserve(32);
+	}
+
+	CoroutineScheduler::~CoroutineScheduler()
+	{
+		StopAll();
+	}
+
+	Uint32 CoroutineScheduler::Start(Coroutine coroutine)
+	{
+		std::coroutine_handle<Coroutine::promise_type> handle = coroutine.Release();
+
+		if (!handle)
+		{
+			return 0;
+		}
+
+		handle.promise().scheduler = this;
+
+		Uint32 id = nextId++;
+		if (nextId == 0)
+		{
+			nextId = 1;
+		}
+
+		running.push_back({ id, handle, false });
+		Resume(running.size() - 1);
+
+		if (!updating)
+		{
+			RemoveFinished();
+		}
+
+		return IsRunning(id) ? id : 0;
+	}
+
+	bool CoroutineScheduler::Stop(Uint32 id)
+	{
+		for (auto& coroutine : running)
+		{
+			if (coroutine.id == id && !coroutine.stopped)
+			{
+				// destroying is left to RemoveFinished in case the coroutine is stopping itself.
+				coroutine.stopped = true;
+
+				if (!updating)
+				{
+					RemoveFinished();
+				}
+
+				return true;
+			}
+		}
+
+		return false;
+	}
+
+	void CoroutineScheduler::StopAll()
+	{
+		for (auto& coroutine : running)
+		{
+			coroutine.stopped = true;
+		}
+
+		if (!updating)
+		{
+			RemoveFinished();
+		}
+	}
+
+	bool CoroutineScheduler::IsRunning(Uint32 id)
+	{
+		for (auto& coroutine : running)
+		{
+			if (coroutine.id == id)
+			{
+				return !coroutine.stopped && !coroutine.handle.done();
+			}
+		}
+
+		return false;
+	}
+
+	bool CoroutineScheduler::IsReady(Coroutine::promise_type& promise)
+	{
+		if (promise.condition != NULL)
+		{
+			return promise.condition(promise.conditionState);
+		}
+
+		return (Sint32)(frame - promise.wakeFrame) >= 0 && (Sint32)(time - promise.wakeTime) >= 0;
+	}
+
+	void CoroutineScheduler::Resume(size_t index)
+	{
+		bool wasUpdating = updating;
+		updating = true;
+
+		// copy the handle out, the coroutine can start others and move the vector.
+		std::coroutine_handle<Coroutine::promise_type> handle = running[index].handle;
+		handle.resume();
+
+		updating = wasUpdating;
+	}
+
+	void CoroutineScheduler::Update(Uint32 now)
+	{
+		frame++;
+		time = now;
+		updating = true;
+
+		// anything started during this loop already ran up to its first wait, so only look at what was here before.
+		size_t count = running.size();
+		for (size_t i = 0; i < count; i++)
+		{
+			if (!running[i].stopped && !running[i].handle.done() && IsReady(running[i].handle.promise()))
+			{
+				Resume(i);
+			}
+		}
+
+		updating = false;
+		RemoveFinished();
+	}
+
+	void CoroutineScheduler::RemoveFinished()
+	{
+		size_t kept = 0;
+
+		for (size_t i = 0; i < running.size(); i++)
+		{
+			if (running[i].stopped || running[i].handle.done())
+			{
+				running[i].handle.destroy();
+			}
+			else
+			{
+				running[kept++] = running[i];
+			}
+		}
+
+		running.resize(kept);
+	}
+
+	Uint32 CoroutineScheduler::GetFrame()
+	{
+		return frame;
+	}
+
+	Uint32 CoroutineScheduler::GetTime()
+	{
+		return time;
+	}
+	#endif
+
+	// null renderers hand this out in place of real textures so callers can still check for NULL.
+	static char nullTextureTag;
+	static SDL_Texture* const NULL_TEXTURE = (SDL_Texture*)&nullTextureTag;
+
+	// every wrapper with an sdl renderer, so the old constructors can find the one to use.
+	static std::vector<Renderer*>& GetRendererWrappers()
+	{
+		static std::vector<Renderer*> wrappers;
+		return wrappers;
+	}
+
+	Renderer::Renderer()
+	{
+		renderer = NULL;
+		ownsRenderer = true;
+		isNull = false;
+		countCalls = false;
+		nullWidth = 0;
+		nullHeight = 0;
+		frame = 0;
+		ResetStats();
+		InvalidateStateCache();
+	}
+
+	Renderer::~Renderer()
+	{
+		std::vector<Renderer*>& wrappers = GetRendererWrappers();
+		wrappers.erase(std::remove(wrappers.begin(), wrappers.end(), this), wrappers.end());
+
+		if (renderer != NULL && ownsRenderer)
+		{
+			SDL_DestroyRenderer(renderer);
+		}
+	}
+
+	Renderer* Renderer::FromSDLRenderer(SDL_Renderer* renderer)
+	{
+		if (renderer == NULL)
+		{
+			return NULL;
+		}
+
+		for (Renderer* wrapper : GetRendererWrappers())
+		{
+			if (wrapper->renderer == renderer)
+			{
+				return wrapper;
+			}
+		}
+
+		// not one of ours, so wrap it without taking it over.
+		Renderer* wrapper = new Renderer();
+		wrapper->renderer = renderer;
+		wrapper->ownsRenderer = false;
+		GetRendererWrappers().push_back(wrapper);
+		return wrapper;
+	}
+
+	bool Renderer::Create(SDL_Window* window, Uint32 flags)
+	{
+		renderer = SDL_CreateRenderer(window, -1, flags);
+
+		if (renderer == NULL)
+		{
+			COS_LOG_ERR("Failed to create renderer: {}", SDL_GetError());
+			return false;
+		}
+
+		isNull = false;
+		ownsRenderer = true;
+		GetRendererWrappers().push_back(this);
+		InvalidateStateCache();
+		return true;
+	}
+
+	void Renderer::CreateNull(int width, int height)
+	{
+		isNull = true;
+		nullWidth = width;
+		nullHeight = height;
+	}
+
+	bool Renderer::IsNull()
+	{
+		return isNull;
+	}
+
+	void Renderer::SetCallCounting(bool enabled)
+	{
+		countCalls = enabled;
+	}
+
+	RenderStats Renderer::GetStats()
+	{
+		return stats;
+	}
+
+	void Renderer::ResetStats()
+	{
+		stats = { 0, 0, 0, 0, 0 };
+	}
+
+	Uint32 Renderer::GetFrame()
+	{
+		return frame;
+	}
+
+	SDL_Renderer* Renderer::GetSDLRenderer()
+	{
+		return renderer;
+	}
+
+	void Renderer::InvalidateStateCache()
+	{
+		drawColor = SDL_Color{ 0, 0, 0, 0 };
+		drawBlendMode = SDL_BLENDMODE_NONE;
+		target = NULL;
+		scaleX = 1;
+		scaleY = 1;
+		clipRect = SDL_Rect{ 0, 0, 0, 0 };
+		clipEnabled = false;
+		drawColorKnown = false;
+		drawBlendModeKnown = false;
+		scaleKnown = false;
+		clipKnown = false;
+		textureStates.clear();
+	}
+
+	Renderer::TextureState& Renderer::GetTextureState(SDL_Texture* texture)
+	{
+		auto found = textureStates.find(texture);
+
+		if (found != textureStates.end())
+		{
+			return found->second;
+		}
+
+		// mods start at full on every new texture, the blend mode depends on how it was made.
+		TextureState state;
+		state.alpha = 255;
+		state.color = SDL_Color{ 255, 255, 255, 255 };
+		state.blendMode = SDL_BLENDMODE_NONE;
+		state.scaleMode = SDL_ScaleModeLinear;
+		state.blendModeKnown = false;
+		state.scaleModeKnown = false;
+		return textureStates.emplace(texture, state).first->second;
+	}
+
+	bool Renderer::SkipStateChange(bool unchanged)
+	{
+		if (countCalls)
+		{
+			if (unchanged)
+			{
+				stats.skippedStateChanges++;
+			}
+			else
+			{
+				stats.stateChanges++;
+			}
+		}
+
+		return unchanged;
+	}
+
+	Uint32 Renderer::GetNativeTextureFormat()
+	{
+		SDL_RendererInfo info;
+
+		if (isNull || SDL_GetRendererInfo(renderer, &info) != 0 || info.num_texture_formats == 0)
+		{
+			return SDL_PIXELFORMAT_ARGB8888;
+		}
+
+		return info.texture_formats[0];
+	}
+
+	bool Renderer::SupportsTextureFormat(Uint32 format)
+	{
+		SDL_RendererInfo info;
+
+		if (isNull || SDL_GetRendererInfo(renderer, &info) != 0)
+		{
+			return true;
+		}
+
+		for (Uint32 i = 0; i < info.num_texture_formats; i++)
+		{
+			if (info.texture_formats[i] == format)
+			{
+				return true;
+			}
+		}
+
+		return false;
+	}
+
+	Uint32 Renderer::GetDefaultNativeTextureFormat()
+	{
+		SDL_RendererInfo info;
+
+		// yuv and other fourcc formats can't hold an image with alpha, so those drivers get the usual format.
+		if (SDL_GetRenderDriverInfo(0, &info) != 0 || info.num_texture_formats == 0 || SDL_ISPIXELFORMAT_FOURCC(info.texture_formats[0])
+			|| SDL_BYTESPERPIXEL(info.texture_formats[0]) != 4)
+		{
+			return SDL_PIXELFORMAT_ARGB8888;
+		}
+
+		return info.texture_formats[0];
+	}
+
+	SDL_Texture* Renderer::CreateTexture(Uint32 format, int access, int width, int height)
+	{
+		if (countCalls)
+		{
+			stats.textureUploads++;
+		}
+
+		return isNull ? NULL_TEXTURE : SDL_CreateTexture(renderer, format, access, width, height);
+	}
+
+	SDL_Texture* Renderer::CreateTextureFromSurface(SDL_Surface* surface)
+	{
+		if (countCalls)
+		{
+			stats.textureUploads++;
+		}
+
+		return isNull ? NULL_TEXTURE : SDL_CreateTextureFromSurface(renderer, surface);
+	}
+
+	SDL_Texture* Renderer::LoadTexture(SDL_RWops* source, int* width, int* height)
+	{
+		if (countCalls)
+		{
+			stats.textureUploads++;
+		}
+
+		if (!isNull)
+		{
+			SDL_Texture* texture = IMG_LoadTexture_RW(renderer, source, 1);
+
+			if (texture != NULL)
+			{
+				SDL_QueryTexture(texture, NULL, NULL, width, height);
+			}
+
+			return texture;
+		}
+
+		// still decode so the size matches what a real renderer would report.
+		SDL_Surface* surface = IMG_Load_RW(source, 1);
+
+		if (surface == NULL)
+		{
+			return NULL;
+		}
+
+		*width = surface->w;
+		*height = surface->h;
+		SDL_FreeSurface(surface);
+
+		return NULL_TEXTURE;
+	}
+
+	void Renderer::DestroyTexture(SDL_Texture* texture)
+	{
+		if (!isNull && texture != NULL)
+		{
+			// the next texture could be given the same address.
+			textureStates.erase(texture);
+
+			if (texture == target)
+			{
+				target = NULL;
+			}
+
+			SDL_DestroyTexture(texture);
+		}
+	}
+
+	int Renderer::UpdateTexture(SDL_Texture* texture, const SDL_Rect* rect, const void* pixels, int pitch)
+	{
+		if (countCalls)
+		{
+			stats.textureUploads++;
+		}
+
+		return isNull ? 0 : SDL_UpdateTexture(texture, rect, pixels, pitch);
+	}
+
+	int Renderer::LockTexture(SDL_Texture* texture, const SDL_Rect* rect, void** pixels, int* pitch)
+	{
+		if (!isNull)
+		{
+			return SDL_LockTexture(texture, rect, pixels, pitch);
+		}
+
+		if (rect == NULL)
+		{
+			return -1;
+		}
+
+		nullPixels.resize((size_t)rect->w * rect->h * 4);
+		*pixels = nullPixels.data();
+		*pitch = rect->w * 4;
+		return 0;
+	}
+
+	void Renderer::UnlockTexture(SDL_Texture* texture)
+	{
+		// unlocking is when the locked area actually goes up to the gpu.
+		if (countCalls)
+		{
+			stats.textureUploads++;
+		}
+
+		if (!isNull)
+		{
+			SDL_UnlockTexture(texture);
+		}
+	}
+
+	int Renderer::SetTextureAlphaMod(SDL_Texture* texture, Uint8 alpha)
+	{
+		TextureState& state = GetTextureState(texture);
+
+		if (SkipStateChange(state.alpha == alpha))
+		{
+			return 0;
+		}
+
+		state.alpha = alpha;
+		return isNull ? 0 : SDL_SetTextureAlphaMod(texture, alpha);
+	}
+
+	int Renderer::SetTextureColorMod(SDL_Texture* texture, Uint8 r, Uint8 g, Uint8 b)
+	{
+		TextureState& state = GetTextureState(texture);
+
+		if (SkipStateChange(state.color.r == r && state.color.g == g && state.color.b == b))
+		{
+			return 0;
+		}
+
+		state.color = SDL_Color{ r, g, b, 255 };
+		return isNull ? 0 : SDL_SetTextureColorMod(texture, r, g, b);
+	}
+
+	int Renderer::SetTextureBlendMode(SDL_Texture* texture, SDL_BlendMode blendMode)
+	{
+		TextureState& state = GetTextureState(texture);
+
+		if (SkipStateChange(state.blendModeKnown && state.blendMode == blendMode))
+		{
+			return 0;
+		}
+
+		state.blendMode = blendMode;
+		state.blendModeKnown = true;
+		return isNull ? 0 : SDL_SetTextureBlendMode(texture, blendMode);
+	}
+
+	int Renderer::SetTextureScaleMode(SDL_Texture* texture, SDL_ScaleMode scaleMode)
+	{
+		TextureState& state = GetTextureState(texture);
+
+		if (SkipStateChange(state.scaleModeKnown && state.scaleMode == scaleMode))
+		{
+			return 0;
+		}
+
+		state.scaleMode = scaleMode;
+		state.scaleModeKnown = true;
+
+		#if SDL_VERSION_ATLEAST(2, 0, 12)
+		return isNull ? 0 : SDL_SetTextureScaleMode(texture, scaleMode);
+		#else
+		return 0;
+		#endif
+	}
+
+	int Renderer::SetDrawColor(Uint8 r, Uint8 g, Uint8 b, Uint8 a)
+	{
+		if (SkipStateChange(drawColorKnown && drawColor.r == r && drawColor.g == g && drawColor.b == b && drawColor.a == a))
+		{
+			return 0;
+		}
+
+		drawColor = SDL_Color{ r, g, b, a };
+		drawColorKnown = true;
+		return isNull ? 0 : SDL_SetRenderDrawColor(renderer, r, g, b, a);
+	}
+
+	int Renderer::SetDrawBlendMode(SDL_BlendMode blendMode)
+	{
+		if (SkipStateChange(drawBlendModeKnown && drawBlendMode == blendMode))
+		{
+			return 0;
+		}
+
+		drawBlendMode = blendMode;
+		drawBlendModeKnown = true;
+		return isNull ? 0 : SDL_SetRenderDrawBlendMode(renderer, blendMode);
+	}
+
+	int Renderer::SetTarget(SDL_Texture* texture)
+	{
+		if (SkipStateChange(target == texture))
+		{
+			return 0;
+		}
+
+		// sdl keeps a separate scale and clip rect for the window and for targets, and swaps them over here.
+		target = texture;
+		scaleKnown = false;
+		clipKnown = false;
+		return isNull ? 0 : SDL_SetRenderTarget(renderer, texture);
+	}
+
+	int Renderer::SetScale(float scaleX, float scaleY)
+	{
+		if (SkipStateChange(scaleKnown && this->scaleX == scaleX && this->scaleY == scaleY))
+		{
+			return 0;
+		}
+
+		this->scaleX = scaleX;
+		this->scaleY = scaleY;
+		scaleKnown = true;
+		return isNull ? 0 : SDL_RenderSetScale(renderer, scaleX, scaleY);
+	}
+
+	int Renderer::SetClipRect(const SDL_Rect* rect)
+	{
+		bool unchanged = rect == NULL ? !clipEnabled : clipEnabled && SDL_RectEquals(rect, &clipRect);
+
+		if (SkipStateChange(clipKnown && unchanged))
+		{
+			return 0;
+		}
+
+		clipEnabled = rect != NULL;
+		clipRect = rect != NULL ? *rect : SDL_Rect{ 0, 0, 0, 0 };
+		clipKnown = true;
+		return isNull ? 0 : SDL_RenderSetClipRect(renderer, rect);
+	}
+
+	int Renderer::GetOutputSize(int* width, int* height)
+	{
+		if (isNull)
+		{
+			*width = nullWidth;
+			*height = nullHeight;
+			return 0;
+		}
+
+		return SDL_GetRendererOutputSize(renderer, width, height);
+	}
+
+	int Renderer::Clear()
+	{
+		if (countCalls)
+		{
+			stats.draws++;
+		}
+
+		return isNull ? 0 : SDL_RenderClear(renderer);
+	}
+
+	int Renderer::Copy(SDL_Texture* texture, const SDL_Rect* source, const SDL_Rect* destination)
+	{
+		if (countCalls)
+		{
+			stats.draws++;
+		}
+
+		return isNull ? 0 : SDL_RenderCopy(renderer, texture, source, destination);
+	}
+
+	int Renderer::CopyEx(SDL_Texture* texture, const SDL_Rect* source, const SDL_FRect* destination, double angle, const SDL_FPoint* center, SDL_RendererFlip flip)
+	{
+		if (countCalls)
+		{
+			stats.draws++;
+		}
+
+		return isNull ? 0 : SDL_RenderCopyExF(renderer, texture, source, destination, angle, center, flip);
+	}
+
+	int Renderer::FillRect(const SDL_Rect* rect)
+	{
+		if (countCalls)
+		{
+			stats.draws++;
+		}
+
+		return isNull ? 0 : SDL_RenderFillRect(renderer, rect);
+	}
+
+	int Renderer::FillRectF(const SDL_FRect* rect)
+	{
+		if (countCalls)
+		{
+			stats.draws++;
+		}
+
+		return isNull ? 0 : SDL_RenderFillRectF(renderer, rect);
+	}
+
+	int Renderer::DrawLinesF(const SDL_FPoint* points, int count)
+	{
+		if (countCalls)
+		{
+			stats.draws++;
+		}
+
+		return isNull ? 0 : SDL_RenderDrawLinesF(renderer, points, count);
+	}
+
+	int Renderer::DrawPoint(int x, int y)
+	{
+		if (countCalls)
+		{
+			stats.draws++;
+		}
+
+		return isNull ? 0 : SDL_RenderDrawPoint(renderer, x, y);
+	}
+
+	#if SDL_VERSION_ATLEAST(2, 0, 18)
+	int Renderer::Geometry(SDL_Texture* texture, const SDL_Vertex* vertices, int vertexCount, const int* indices, int indexCount)
+	{
+		if (countCalls)
+		{
+			stats.draws++;
+		}
+
+		return isNull ? 0 : SDL_RenderGeometry(renderer, texture, vertices, vertexCount, indices, indexCount);
+	}
+	#endif
+
+	void Renderer::Present()
+	{
+		frame++;
+
+		if (countCalls)
+		{
+			stats.presents++;
+		}
+
+		if (!isNull)
+		{
+			SDL_RenderPresent(renderer);
+		}
+	}
+
+	AudioDevice& AudioDevice::Get()
+	{
+		static AudioDevice instance;
+		return instance;
+	}
+
+	AudioDevice::AudioDevice() : soundsLoaded(0), soundsPlayed(0)
+	{
+		isOpen = false;
+		isNull = false;
+	}
+
+	bool AudioDevice::Open()
+	{
+		if (Mix_OpenAudio(44100, MIX_DEFAULT_FORMAT, 2, 2048) < 0)
+		{
+			COS_LOG_ERR("Failed to start the mixer: {}", Mix_GetError());
+			return false;
+		}
+
+		isOpen = true;
+		isNull = false;
+		return true;
+	}
+
+	void AudioDevice::OpenNull()
+	{
+		isOpen = true;
+		isNull = true;
+	}
+
+	void AudioDevice::Close()
+	{
+		{
+			#ifdef CRISPY_OCTO_SPORK_THREADS
+			std::lock_guard<std::mutex> lock(pendingMutex);
+			#endif
+			pendingPlays.clear();
+		}
+
+		if (isOpen && !isNull)
+		{
+			Mix_CloseAudio();
+		}
+
+		isOpen = false;
+	}
+
+	bool AudioDevice::IsNull()
+	{
+		return isNull;
+	}
+
+	AudioStats AudioDevice::GetStats()
+	{
+		return { soundsLoaded.load(), soundsPlayed.load() };
+	}
+
+	void AudioDevice::QueuePlay(Mix_Chunk* chunk)
+	{
+		#ifdef CRISPY_OCTO_SPORK_THREADS
+		std::lock_guard<std::mutex> lock(pendingMutex);
+		#endif
+		pendingPlays.push_back(chunk);
+	}
+
+	void AudioDevice::Forget(Mix_Chunk* chunk)
+	{
+		#ifdef CRISPY_OCTO_SPORK_THREADS
+		std::lock_guard<std::mutex> lock(pendingMutex);
+		#endif
+		pendingPlays.erase(std::remove(pendingPlays.begin(), pendingPlays.end(), chunk), pendingPlays.end());
+	}
+
+	void AudioDevice::Flush()
+	{
+		// held for the whole flush so a sound can't be freed halfway through. starting a channel is quick.
+		#ifdef CRISPY_OCTO_SPORK_THREADS
+		std::lock_guard<std::mutex> lock(pendingMutex);
+		#endif
+
+		for (Mix_Chunk* chunk : pendingPlays)
+		{
+			if (isNull)
+			{
+				soundsPlayed++;
+			}
+			else if (isOpen)
+			{
+				// no free channel just means this one isn't heard, the same as when it played straight away.
+				Mix_PlayChannel(-1, chunk, 0);
+			}
+		}
+
+		pendingPlays.clear();
+	}
+
+	Engine::Engine()
+	{
+		window = NULL;
+		renderer = NULL;
+		screenWidth = 0;
+		screenHeight = 0;
+		isVsyncEnabled = true;
+		isFullscreenEnabled = false;
+		name = "";
+		isEngineRunning = false;
+		currentInputId = 0;
+		renderTarget = NULL;
+		internalWidth = 0;
+		internalHeight = 0;
+		renderTargetDivisor = 1;
+		memoryReportInterval = 0;
+		lastMemoryReport = 0;
+		isHeadless = false;
+		countRenderCalls = false;
+		frameLimit = 0;
+		framesRun = 0;
+		frameStartCounter = 0;
+		frameTime = 0;
+		frameDeltaTime = 0;
+		renderingToTarget = false;
+		particleTaskAdded = false;
+		builtViewports = NULL;
+		builtViewportCount = 0;
+
+		// the phases have always run in this order on the main thread, now games can hang work off them.
+		// building the sprite batch and flushing the sounds played during update don't touch the renderer, so they
+		// run on workers next to each other and the render only waits for them.
+		frameGraph.AddTask("input", [this]() { FrameInput(); }, {}, true);
+		frameGraph.AddTask("update", [this]() { FrameUpdate(); }, { "input" }, true);
+		frameGraph.AddTask("sprites", [this]() { BuildSprites(); }, { "update" });
+		frameGraph.AddTask("audio", []() { AudioDevice::Get().Flush(); }, { "update" });
+		frameGraph.AddTask("render", [this]() { FrameRender(); }, { "update", "sprites", "audio" }, true);
+		frameGraph.AddTask("present", [this]() { FramePresent(); }, { "render" }, true);
+		frameGraph.AddTask("end frame", [this]() { FrameEnd(); }, { "present" }, true);
+	}
+
+	Engine::~Engine()
+	{}
+
+	bool Engine::Create(std::string name, int width, int height, bool vsync, bool fullscreen)
+	{
+		this->name = name;
+		this->screenWidth = width;
+		this->screenHeight = height;
+		this->isVsyncEnabled = vsync;
+		this->isFullscreenEnabled = fullscreen;
+
+		// headless runs never touch the video or audio subsystems, so they work without a display or sound card.
+		if (SDL_Init(isHeadless ? SDL_INIT_EVENTS | SDL_INIT_TIMER : SDL_INIT_VIDEO) < 0)
+		{
+			COS_LOG_ERR("Failed to initialize SDL: {}", SDL_GetError());
+			return false;
+		}
+
+		StartupGraph startup;
+
+		// SDL's subsystem init isn't thread safe, so the audio driver comes up here first.
+		// opening the device is the slow part and that gets a worker thread.
+		startup.AddTask("audio driver", [this]()
+		{
+			if (this->isHeadless)
+			{
+				return true;
+			}
+
+			if (SDL_InitSubSystem(SDL_INIT_AUDIO) < 0)
+			{
+				COS_LOG_ERR("Failed to start the audio driver: {}", SDL_GetError());
+				return false;
+			}
+
+			return true;
+		}, {}, true);
+
+		startup.AddTask("window", [this]()
+		{
+			if (this->isHeadless)
+			{
+				return true;
+			}
+
+			Uint32 windowFlags = SDL_WINDOW_SHOWN;
+
+			if (this->isFullscreenEnabled)
+			{
+				// with an internal render target we scale ourselves, so there's no need to switch display modes.
+				windowFlags |= this->internalWidth > 0 ? SDL_WINDOW_FULLSCREEN_DESKTOP : SDL_WINDOW_FULLSCREEN;
+			}
+
+			this->window = SDL_CreateWindow(this->name.c_str(), 
+											SDL_WINDOWPOS_UNDEFINED, 
+											SDL_WINDOWPOS_UNDEFINED, 
+											this->screenWidth, 
+											this->screenHeight, 
+											windowFlags);
+
+			if (this->window == NULL) 
+			{
+				COS_LOG_ERR("Failed to create window: {}", SDL_GetError());
+				return false;
+			}
+
+			return true;
+		}, {}, true);
+
+		startup.AddTask("renderer", [this]()
+		{
+			Uint32 rendererFlags = SDL_RENDERER_ACCELERATED | SDL_RENDERER_TARGETTEXTURE;
+
+			if (this->isVsyncEnabled)
+			{
+				rendererFlags |= SDL_RENDERER_PRESENTVSYNC;
+			}
+
+			this->renderer = new Renderer();
+			this->renderer->SetCallCounting(this->countRenderCalls);
+
+			if (this->isHeadless)
+			{
+				this->renderer->CreateNull(this->screenWidth, this->screenHeight);
+				return true;
+			}
+
+			return this->renderer->Create(window, rendererFlags);
+		}, { "window" }, true);
+
+		startup.AddTask("image", []()
+		{
+			int imgFlags = IMG_INIT_PNG;
+			if (!(IMG_Init(imgFlags) & imgFlags))
+			{
+				COS_LOG_ERR("SDL_image could not initialize PNG support: {}", IMG_GetError());
+				return false;
+			}
+
+			return true;
+		});
+
+		startup.AddTask("text", []()
+		{
+			if (TTF_Init() == -1)
+			{
+				COS_LOG_ERR("SDL_ttf could not initialize!: {}", TTF_GetError());
+				return false;
+			}
+
+			return true;
+		});
+
+		startup.AddTask("audio", [this]()
+		{
+			if (this->isHeadless)
+			{
+				AudioDevice::Get().OpenNull();
+				return true;
+			}
+
+			return AudioDevice::Get().Open();
+		}, { "audio driver" });
+
+		if (!OnCreateStartupTasks(startup))
+		{
+			return false;
+		}
+
+		bool success = startup.Run();
+		startup.Report();
+
+		assetCache.SetRenderer(renderer);
+
+		return success;
+	}
+
+	bool Engine::Start()
+	{
+		isEngineRunning = true;
+
+		this->OnCreate();
+
+		Uint64 loopStart = SDL_GetPerformanceCounter();
+
+		#ifdef __EMSCRIPTEN__
+		emscripten_set_main_loop_arg(Engine::Update, this, -1, 1);
+		#else
+		while (isEngineRunning)
+		{
+			Update(this);
+		}
+		#endif
+
+		if (isHeadless)
+		{
+			double seconds = (double)(SDL_GetPerformanceCounter() - loopStart) / (double)SDL_GetPerformanceFrequency();
+			COS_LOG_INFO("Headless run: {} frames in {} s ({} FPS)", framesRun, seconds, seconds > 0 ? framesRun / seconds : 0.0);
+
+			if (countRenderCalls)
+			{
+				RenderStats renderStats = renderer->GetStats();
+				AudioStats audioStats = AudioDevice::Get().GetStats();
+				COS_LOG_INFO("Calls: {} draws, {} state changes ({} skipped), {} texture uploads, {} presents, {} sounds loaded, {} sounds played",
+					renderStats.draws, renderStats.stateChanges, renderStats.skippedStateChanges, renderStats.textureUploads, renderStats.presents,
+					audioStats.soundsLoaded, audioStats.soundsPlayed);
+			}
+
+			TextureCacheStats textureStats = assetCache.GetTextureStats();
+			if (textureStats.budgetBytes > 0)
+			{
+				COS_LOG_INFO("Textures: {} of {} bytes, {} evictions, {} reloads",
+					textureStats.residentBytes, textureStats.budgetBytes, textureStats.evictions, textureStats.reloads);
+			}
+		}
+
+		inputLatency.Report();
+		MemoryTracker::Get().Dump();
+
+		// scenes, coroutines and frame tasks can point at game objects, so they go before the game cleans up.
+		frameGraph.Shutdown();
+
+		#ifdef CRISPY_OCTO_SPORK_COROUTINES
+		coroutines.StopAll();
+		#endif
+
+		while (!sceneStack.empty())
+		{
+			scenes[sceneStack.back()].scene->OnExit();
+			sceneStack.pop_back();
+		}
+
+		for (auto& entry : scenes)
+		{
+			delete entry.scene;
+		}
+
+		scenes.clear();
+
+		OnDestroy();
+
+		assetCache.Shutdown();
+		FileIO::Get().Shutdown();
+
+		#ifdef CRISPY_OCTO_SPORK_COROUTINES
+		CoroutineFrameAllocator::Get().Trim();
+		#endif
+
+		if (renderTarget != NULL)
+		{
+			renderer->DestroyTexture(renderTarget);
+			renderTarget = NULL;
+		}
+
+		delete renderer;
+		renderer = NULL;
+		AudioDevice::Get().Close();
+
+		SDL_Quit();
+		IMG_Quit();
+		TTF_Quit();
+		Logger::Get().Flush();
+		return true;
+	}
+
+
+	void Engine::Update(void* arg)
+	{
+		Engine* engine = (Engine*)arg;
+		engine->frameStartCounter = SDL_GetPerformanceCounter();
+		engine->frameGraph.Run();
+	}
+
+	void Engine::FrameInput()
+	{
+		SDL_Event event;
+		while (SDL_PollEvent(&event))
+		{
+			switch (event.type)
+			{
+			case SDL_QUIT:
+				isEngineRunning = false;
+				break;
+			}
+
+			if (event.type == SDL_KEYDOWN)
+			{
+				currentInputId = inputLatency.OnInputPolled(event.key.timestamp);
+			}
+
+			OnEvent(event);
+
+			if (!sceneStack.empty())
+			{
+				scenes[sceneStack.back()].scene->OnEvent(event);
+			}
+
+			inputLatency.OnEventDispatched(currentInputId);
+			currentInputId = 0;
+		}
+	}
+
+	void Engine::FrameUpdate()
+	{
+		frameTime = SDL_GetTicks();
+		frameDeltaTime = frameTime - lastFrameTime;
+		lastFrameTime = frameTime;
+
+		OnUpdate(frameDeltaTime);
+
+		// only the top scene updates, but everything down to the first non-overlay is drawn bottom up.
+		ApplySceneChanges();
+		assetCache.Update();
+
+		if (!sceneStack.empty())
+		{
+			scenes[sceneStack.back()].scene->OnUpdate(frameDeltaTime);
+		}
+
+		#ifdef CRISPY_OCTO_SPORK_COROUTINES
+		coroutines.Update(frameTime);
+		#endif
+
+		ApplySceneChanges();
+
+		for (int i = GetFirstVisibleScene(); i < (int)sceneStack.size(); i++)
+		{
+			scenes[sceneStack[i]].scene->OnQueueSprites(sprites);
+		}
+
+		// worked out here since the whole screen viewport may need to ask the renderer for its size.
+		builtViewports = GetActiveViewports(builtViewportCount);
+	}
+
+	void Engine::FrameRender()
+	{
+		renderingToTarget = BeginRenderTarget();
+
+		renderer->SetDrawColor(135, 206, 235, 255);
+		renderer->Clear();
+
+		OnRender(frameDeltaTime);
+		sprites.Submit(renderer);
+
+		for (int i = GetFirstVisibleScene(); i < (int)sceneStack.size(); i++)
+		{
+			scenes[sceneStack[i]].scene->OnRender(frameDeltaTime);
+
+			// flushed per scene so an overlay still draws over everything under it.
+			FlushSprites();
+		}
+
+		if (renderingToTarget)
+		{
+			PresentRenderTarget();
+		}
+	}
+
+	void Engine::FramePresent()
+	{
+		float workTime = (float)((double)(SDL_GetPerformanceCounter() - frameStartCounter) * 1000.0 / (double)SDL_GetPerformanceFrequency());
+		if (qualityGovernor.OnFrame(frameDeltaTime, workTime))
+		{
+			ApplyQuality();
+		}
+
+		renderer->Present();
+		inputLatency.OnFramePresented();
+	}
+
+	void Engine::FrameEnd()
+	{
+		if (memoryReportInterval > 0 && frameTime - lastMemoryReport >= memoryReportInterval)
+		{
+			MemoryTracker::Get().Dump();
+			lastMemoryReport = frameTime;
+		}
+
+		Telemetry::Get().Update();
+
+		framesRun++;
+		if (frameLimit > 0 && framesRun >= frameLimit)
+		{
+			isEngineRunning = false;
+		}
+
+		if (frameRate.OnUpdate() != 0.0 && window != NULL)
+		{
+			std::string newWindowTitle = name + " - " + std::to_string(frameRate.GetCurrentFramesPerSecond()) + " FPS - " + std::to_string(frameDeltaTime);
+			SDL_SetWindowTitle(window, newWindowTitle.c_str());
+		}
+	}
+
+	bool Engine::OnCreate()
+	{
+		lastFrameTime = SDL_GetTicks();
+		return true;
+	}
+
+	bool Engine::OnCreateStartupTasks(StartupGraph& startup)
+	{
+		return true;
+	}
+
+	bool Engine::OnUpdate(float deltaTime)
+	{
+		for (auto& entity : entities)
+		{
+			entity->OnUpdate(deltaTime);
+		}
+
+		for (auto& pool : entityPools)
+		{
+			if (pool)
+			{
+				pool->UpdateAll(deltaTime);
+			}
+		}
+
+		return true;
+	}
+
+	bool Engine::OnRender(float deltaTime)
+	{
+		for (auto& entity : entities)
+		{
+			entity->OnRender(deltaTime);
+		}
+
+		for (auto& pool : entityPools)
+		{
+			if (pool)
+			{
+				pool->RenderAll(deltaTime);
+			}
+		}
+
+		return true;
+	}
+
+	bool Engine::OnEvent(SDL_Event event)
+	{
+		return true;
+	}
+
+	bool Engine::OnDestroy()
+	{
+		for (auto p : entities)
+		{
+			delete p;
+		}
+
+		entities.clear();
+
+		for (auto& pool : entityPools)
+		{
+			if (pool)
+			{
+				pool->DestroyAll();
+			}
+		}
+
+		return true;
+	}
+
+	void Engine::AddEntity(Entity* entity)
+	{
+		entities.push_back(entity);
+	}
+
+	Uint32 Engine::NextPoolTypeId()
+	{
+		static std::atomic<Uint32> nextTypeId{ 0 };
+		return nextTypeId++;
+	}
+
+	Uint32 Engine::AcknowledgeInput()
+	{
+		inputLatency.OnInputApplied(currentInputId);
+		return currentInputId;
+	}
+
+	void Engine::MarkInputTicked(Uint32 inputId)
+	{
+		inputLatency.OnInputTicked(inputId);
+	}
+
+	void Engine::EnableQualityGovernor(int targetFramesPerSecond)
+	{
+		qualityGovernor.SetTargetFrameRate(targetFramesPerSecond);
+		qualityGovernor.enabled = true;
+	}
+
+	void Engine::RegisterParticleEmitter(ParticleEmitter* emitter, bool simulate)
+	{
+		particleEmitters.push_back(emitter);
+		emitter->SetQuality(qualityGovernor.GetParticleRateScale(), qualityGovernor.GetParticleCapScale());
+
+		if (!simulate)
+		{
+			return;
+		}
+
+		// the task only goes in once there's something for it to do, so games without particles never start the workers.
+		if (!particleTaskAdded)
+		{
+			frameGraph.AddTask("particles", [this]() { SimulateParticles(); }, { "update" });
+			frameGraph.AddDependency("render", "particles");
+			particleTaskAdded = true;
+		}
+
+		simulatedEmitters.push_back(emitter);
+	}
+
+	void Engine::UnregisterParticleEmitter(ParticleEmitter* emitter)
+	{
+		for (size_t i = 0; i < simulatedEmitters.size(); i++)
+		{
+			if (simulatedEmitters[i] == emitter)
+			{
+				simulatedEmitters.erase(simulatedEmitters.begin() + i);
+				break;
+			}
+		}
+
+		for (size_t i = 0; i < particleEmitters.size(); i++)
+		{
+			if (particleEmitters[i] == emitter)
+			{
+				particleEmitters.erase(particleEmitters.begin() + i);
+				return;
+			}
+		}
+	}
+
+	void Engine::SimulateParticles()
+	{
+		// scenes register and unregister in "update", which this task waits on, so the list holds still while it runs.
+		float deltaTime = GetFrameDeltaTime();
+
+		for (auto emitter : simulatedEmitters)
+		{
+			emitter->Simulate(deltaTime);
+		}
+	}
+
+	QualityGovernor& Engine::GetQualityGovernor()
+	{
+		return qualityGovernor;
+	}
+
+	void Engine::ApplyQuality()
+	{
+		COS_LOG_INFO("Quality level changed to {}", qualityGovernor.GetLevel());
+
+		for (auto emitter : particleEmitters)
+		{
+			emitter->SetQuality(qualityGovernor.GetParticleRateScale(), qualityGovernor.GetParticleCapScale());
+		}
+	}
+
+	void Engine::SetInternalResolution(int width, int height)
+	{
+		internalWidth = width;
+		internalHeight = height;
+
+		// the target is recreated lazily on the next frame, textures loaded against the renderer stay valid.
+		if (renderTarget != NULL)
+		{
+			renderer->DestroyTexture(renderTarget);
+			renderTarget = NULL;
+		}
+	}
+
+	int Engine::AddViewport(SDL_Rect area)
+	{
+		Viewport viewport;
+		viewport.area = area;
+		viewport.camera.x = area.x + area.w * 0.5f;
+		viewport.camera.y = area.y + area.h * 0.5f;
+		viewports.push_back(viewport);
+
+		return (int)viewports.size() - 1;
+	}
+
+	Viewport& Engine::GetViewport(int index)
+	{
+		return viewports[index];
+	}
+
+	void Engine::ClearViewports()
+	{
+		viewports.clear();
+	}
+
+	SpriteBatch& Engine::GetSprites()
+	{
+		return sprites;
+	}
+
+	void Engine::BuildSprites()
+	{
+		sprites.Build(builtViewports, builtViewportCount);
+	}
+
+	int Engine::GetFirstVisibleScene()
+	{
+		int firstVisible = (int)sceneStack.size() - 1;
+		while (firstVisible > 0 && scenes[sceneStack[firstVisible]].scene->IsOverlay())
+		{
+			firstVisible--;
+		}
+
+		return SDL_max(firstVisible, 0);
+	}
+
+	void Engine::FlushSprites()
+	{
+		int count = 0;
+		const Viewport* active = GetActiveViewports(count);
+		sprites.Flush(renderer, active, count);
+	}
+
+	void Engine::ForEachViewport(std::function<void(const Viewport&)> draw)
+	{
+		int count = 0;
+		const Viewport* active = GetActiveViewports(count);
+
+		// the whole screen needs no clipping.
+		if (viewports.empty())
+		{
+			draw(active[0]);
+			return;
+		}
+
+		for (int i = 0; i < count; i++)
+		{
+			renderer->SetClipRect(&active[i].area);
+			draw(active[i]);
+		}
+
+		renderer->SetClipRect(NULL);
+	}
+
+	const Viewport* Engine::GetActiveViewports(int& count)
+	{
+		if (!viewports.empty())
+		{
+			count = (int)viewports.size();
+			return viewports.data();
+		}
+
+		int width = internalWidth;
+		int height = internalHeight;
+
+		if (width <= 0 || height <= 0)
+		{
+			renderer->GetOutputSize(&width, &height);
+		}
+
+		screenViewport.area = SDL_Rect{ 0, 0, width, height };
+		screenViewport.camera.x = width * 0.5f;
+		screenViewport.camera.y = height * 0.5f;
+		screenViewport.camera.zoom = 1;
+
+		count = 1;
+		return &screenViewport;
+	}
+
+	void Engine::SetHeadless(bool headless, bool countCalls)
+	{
+		isHeadless = headless;
+		countRenderCalls = countCalls;
+	}
+
+	bool Engine::IsHeadless()
+	{
+		return isHeadless;
+	}
+
+	void Engine::SetFrameLimit(Uint32 frames)
+	{
+		frameLimit = frames;
+	}
+
+	bool Engine::BeginRenderTarget()
+	{
+		if (internalWidth <= 0 || internalHeight <= 0)
+		{
+			return false;
+		}
+
+		int divisor = qualityGovernor.enabled ? qualityGovernor.GetResolutionDivisor() : 1;
+
+		// a divisor that doesn't split the internal size evenly would stretch the target by a fraction when it's
+		// presented, so step down to the nearest one that does. 1 always does.
+		while (divisor > 1 && (internalWidth % divisor != 0 || internalHeight % divisor != 0))
+		{
+			divisor--;
+		}
+
+		if (renderTarget != NULL && divisor != renderTargetDivisor)
+		{
+			renderer->DestroyTexture(renderTarget);
+			renderTarget = NULL;
+		}
+
+		if (renderTarget == NULL)
+		{
+			renderTarget = renderer->CreateTexture(SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_TARGET, internalWidth / divisor, internalHeight / divisor);
+
+			if (renderTarget == NULL)
+			{
+				COS_LOG_ERR("Failed to create the internal render target: {}", SDL_GetError());
+				internalWidth = 0;
+				internalHeight = 0;
+				return false;
+			}
+
+			#if SDL_VERSION_ATLEAST(2, 0, 12)
+			renderer->SetTextureScaleMode(renderTarget, SDL_ScaleModeNearest);
+			#endif
+			renderTargetDivisor = divisor;
+		}
+
+		renderer->SetTarget(renderTarget);
+
+		// games keep drawing in internal resolution coordinates even when the target is divided down.
+		renderer->SetScale(1.0f / renderTargetDivisor, 1.0f / renderTargetDivisor);
+		return true;
+	}
+
+	void Engine::PresentRenderTarget()
+	{
+		renderer->SetTarget(NULL);
+
+		int outputWidth = 0;
+		int outputHeight = 0;
+		renderer->GetOutputSize(&outputWidth, &outputHeight);
+
+		// largest whole number scale that fits, falling back to a plain fit if the window is smaller than the target.
+		float scale = (float)SDL_min(outputWidth / internalWidth, outputHeight / internalHeight);
+
+		if (scale < 1)
+		{
+			scale = SDL_min((float)outputWidth / internalWidth, (float)outputHeight / internalHeight);
+		}
+
+		SDL_Rect destination;
+		destination.w = (int)(internalWidth * scale);
+		destination.h = (int)(internalHeight * scale);
+		destination.x = (outputWidth - destination.w) / 2;
+		destination.y = (outputHeight - destination.h) / 2;
+
+		renderer->SetDrawColor(0, 0, 0, 255);
+		renderer->Clear();
+		renderer->Copy(renderTarget, NULL, &destination);
+	}
+
+	void Engine::RegisterScene(int id, Scene* scene)
+	{
+		SceneEntry entry;
+		entry.id = id;
+		entry.scene = scene;
+		scene->engine = this;
+		scene->DeclareAssets(entry.assets);
+		scenes.push_back(entry);
+	}
+
+	void Engine::AddSceneTransition(int from, int to)
+	{
+		int index = FindScene(from);
+
+		if (index == -1 || FindScene(to) == -1)
+		{
+			COS_LOG_ERR("Scene transition from {} to {} uses an unregistered scene", from, to);
+			return;
+		}
+
+		scenes[index].transitions.push_back(to);
+	}
+
+	void Engine::ChangeScene(int id)
+	{
+		pendingSceneChanges.push_back({ SceneChange::Type::CHANGE, id });
+	}
+
+	void Engine::PushScene(int id)
+	{
+		pendingSceneChanges.push_back({ SceneChange::Type::PUSH, id });
+	}
+
+	void Engine::PopScene()
+	{
+		pendingSceneChanges.push_back({ SceneChange::Type::POP, 0 });
+	}
+
+	int Engine::GetCurrentSceneId()
+	{
+		return sceneStack.empty() ? -1 : scenes[sceneStack.back()].id;
+	}
+
+	#ifdef CRISPY_OCTO_SPORK_COROUTINES
+	Uint32 Engine::StartCoroutine(Coroutine coroutine)
+	{
+		return coroutines.Start(std::move(coroutine));
+	}
+
+	bool Engine::StopCoroutine(Uint32 id)
+	{
+		return coroutines.Stop(id);
+	}
+	#endif
+
+	AssetCache& Engine::GetAssets()
+	{
+		return assetCache;
+	}
+
+	FrameGraph& Engine::GetFrameGraph()
+	{
+		return frameGraph;
+	}
+
+	float Engine::GetFrameDeltaTime()
+	{
+		return frameDeltaTime;
+	}
+
+	int Engine::FindScene(int id)
+	{
+		for (size_t i = 0; i < scenes.size(); i++)
+		{
+			if (scenes[i].id == id)
+			{
+				return (int)i;
+			}
+		}
+
+		return -1;
+	}
+
+	void Engine::EnterScene(int index)
+	{
+		// normally a no-op since the assets were preloaded while the previous scene was up.
+		assetCache.LoadNow(scenes[index].assets);
+		sceneStack.push_back(index);
+		scenes[index].scene->OnEnter();
+	}
+
+	void Engine::ApplySceneChanges()
+	{
+		if (pendingSceneChanges.empty())
+		{
+			return;
+		}
+
+		int previousScene = GetCurrentSceneId();
+
+		// swap first since entering a scene is allowed to queue more changes.
+		std::vector<SceneChange> changes;
+		changes.swap(pendingSceneChanges);
+
+		for (auto& change : changes)
+		{
+			switch (change.type)
+			{
+			case SceneChange::Type::POP:
+				if (!sceneStack.empty())
+				{
+					scenes[sceneStack.back()].scene->OnExit();
+					sceneStack.pop_back();
+				}
+				break;
+			case SceneChange::Type::CHANGE:
+			case SceneChange::Type::PUSH:
+			{
+				int index = FindScene(change.id);
+
+				if (index == -1)
+				{
+					COS_LOG_ERR("No scene is registered with ID {}", change.id);
+					break;
+				}
+
+				while (change.type == SceneChange::Type::CHANGE && !sceneStack.empty())
+				{
+					scenes[sceneStack.back()].scene->OnExit();
+					sceneStack.pop_back();
+				}
+
+				EnterScene(index);
+				break;
+			}
+			}
+		}
+
+		if (!sceneStack.empty())
+		{
+			for (int next : scenes[sceneStack.back()].transitions)
+			{
+				assetCache.Preload(scenes[FindScene(next)].assets);
+			}
+		}
+
+		Telemetry::Get().Record((Uint32)TelemetryEventType::SCENE_CHANGE, previousScene, GetCurrentSceneId(), (Sint32)sceneStack.size());
+	}
+
+	void Engine::SetMemoryReportInterval(Uint32 milliseconds)
+	{
+		memoryReportInterval = milliseconds;
+		lastMemoryReport = SDL_GetTicks();
+	}
+
+	void Engine::DrawQuad(SDL_FPoint* points, SDL_Color color, float rotation)
+	{
+		renderer->SetDrawColor(color.r, color.g, color.b, color.a);
+
+		// if we have a rotation then let's apply the rotation matrix.
+		if (rotation == 0.0)
+		{
+			renderer->DrawLinesF(points, 4);
+			return;
+		}
+
+		SDL_FPoint rotatedPoints[4];
+
+		for (int i = 0; i < 3; i++)
+		{
+			rotatedPoints[i].x = (points[i].x * cosf(rotation)) - (points[i].y * sinf(rotation));
+			rotatedPoints[i].y = (points[i].x * sinf(rotation)) + (points[i].y * cosf(rotation));
+		}
+
+		renderer->DrawLinesF(rotatedPoints, 4);
+	}
+
+	FrameRate::FrameRate()
+	{
+		timeStampOfBeginingOfSecond = SDL_GetTicks();
+		currentFramesPerSecond = 0.0;
+		currentSecondsFrameCount = 0;
+	}
+
+	int FrameRate::GetCurrentFramesPerSecond()
+	{
+		return currentFramesPerSecond;
+	}
+
+	int FrameRate::OnUpdate() 
+	{
+		Uint32 currentFrameTime = SDL_GetTicks();
+
+		if (currentFrameTime - timeStampOfBeginingOfSecond >= 1000.0)
+		{
+			currentSecondsFrameCount++;
+			currentFramesPerSecond = currentSecondsFrameCount;
+			currentSecondsFrameCount = 0;
+			timeStampOfBeginingOfSecond = currentFrameTime;
+			return currentFramesPerSecond;
+		}
+
+		currentSecondsFrameCount++;
+		return 0;
+	}
+
+	/// <summary>
+	/// What each quality level turns into, from lowest to highest.
+	/// </summary>
+	struct QualityLevelSettings
+	{
+		float particleRateScale;
+		float particleCapScale;
+		int effectDetail;
+		int resolutionDivisor;
+	};
+
+	const QualityLevelSettings QUALITY_LEVELS[QualityGovernor::LEVEL_COUNT] =
+	{
+		{ 0.15f, 0.15f, 0, 4 },
+		{ 0.35f, 0.35f, 1, 3 },
+		{ 0.65f, 0.65f, 1, 2 },
+		{ 1.0f, 1.0f, 2, 1 }
+	};
+
+	QualityGovernor::QualityGovernor()
+	{
+		enabled = false;
+		frameIndex = 0;
+		framesRecorded = 0;
+		framesWithHeadroom = 0;
+		targetFrameTime = 1000.0f / 60.0f;
+		level = LEVEL_COUNT - 1;
+	}
+
+	void QualityGovernor::SetTargetFrameRate(int framesPerSecond)
+	{
+		targetFrameTime = 1000.0f / framesPerSecond;
+	}
+
+	bool QualityGovernor::OnFrame(float frameTime, float workTime)
+	{
+		if (!enabled)
+		{
+			return false;
+		}
+
+		frameTimes[frameIndex] = frameTime;
+		workTimes[frameIndex] = workTime;
+		frameIndex = (frameIndex + 1) % WINDOW_SIZE;
+
+		if (framesRecorded < WINDOW_SIZE)
+		{
+			framesRecorded++;
+			return false;
+		}
+
+		float averageFrameTime = 0;
+		float averageWorkTime = 0;
+
+		for (int i = 0; i < WINDOW_SIZE; i++)
+		{
+			averageFrameTime += frameTimes[i];
+			averageWorkTime += workTimes[i];
+		}
+
+		averageFrameTime /= WINDOW_SIZE;
+		averageWorkTime /= WINDOW_SIZE;
+
+		// step down as soon as a full window misses the target, but only step back up after
+		// several windows in a row had plenty of headroom so we don't flip back and forth.
+		if (averageFrameTime > targetFrameTime * 1.15f && level > 0)
+		{
+			level--;
+			framesRecorded = 0;
+			framesWithHeadroom = 0;
+			return true;
+		}
+
+		if (averageWorkTime < targetFrameTime * 0.6f)
+		{
+			framesWithHeadroom++;
+		}
+		else
+		{
+			framesWithHeadroom = 0;
+		}
+
+		if (framesWithHeadroom >= WINDOW_SIZE * 4 && level < LEVEL_COUNT - 1)
+		{
+			level++;
+			framesRecorded = 0;
+			framesWithHeadroom = 0;
+			return true;
+		}
+
+		return false;
+	}
+
+	int QualityGovernor::GetLevel()
+	{
+		return level;
+	}
+
+	float QualityGovernor::GetParticleRateScale()
+	{
+		return QUALITY_LEVELS[level].particleRateScale;
+	}
+
+	float QualityGovernor::GetParticleCapScale()
+	{
+		return QUALITY_LEVELS[level].particleCapScale;
+	}
+
+	int QualityGovernor::GetEffectDetail()
+	{
+		return QUALITY_LEVELS[level].effectDetail;
+	}
+
+	int QualityGovernor::GetResolutionDivisor()
+	{
+		return QUALITY_LEVELS[level].resolutionDivisor;
+	}
+
+	StartupGraph::StartupGraph()
+	{
+		runStartCounter = 0;
+	}
+
+	void StartupGraph::AddTask(std::string name, std::function<bool()> run, std::vector<std::string> dependencies, bool mainThread)
+	{
+		Task task;
+		task.name = name;
+		task.run = run;
+		task.dependencyNames = dependencies;
+		task.mainThread = mainThread;
+		tasks.push_back(task);
+	}
+
+	bool StartupGraph::DependenciesFinished(Task& task)
+	{
+		for (int dependency : task.dependencies)
+		{
+			TaskState state = tasks[dependency].state;
+
+			if (state == TaskState::FAILED)
+			{
+				task.state = TaskState::FAILED;
+				return true;
+			}
+
+			if (state != TaskState::SUCCEEDED)
+			{
+				return false;
+			}
+		}
+
+		return true;
+	}
+
+	void StartupGraph::Execute(Task& task)
+	{
+		task.startCounter = SDL_GetPerformanceCounter();
+		bool success = task.run();
+		task.endCounter = SDL_GetPerformanceCounter();
+
+		#ifdef CRISPY_OCTO_SPORK_THREADS
+		std::lock_guard<std::mutex> lock(mutex);
+		#endif
+		task.state = success ? TaskState::SUCCEEDED : TaskState::FAILED;
+
+		#ifdef CRISPY_OCTO_SPORK_THREADS
+		taskFinished.notify_all();
+		#endif
+	}
+
+	bool StartupGraph::Run()
+	{
+		if (!ResolveGraphTasks(tasks, "Startup step"))
+		{
+			return false;
+		}
+
+		runStartCounter = SDL_GetPerformanceCounter();
+
+		#ifdef CRISPY_OCTO_SPORK_THREADS
+		std::vector<std::thread> workers;
+
+		for (auto& task : tasks)
+		{
+			if (task.mainThread)
+			{
+				continue;
+			}
+
+			Task* workerTask = &task;
+			workers.push_back(std::thread([this, workerTask]()
+			{
+				{
+					std::unique_lock<std::mutex> lock(mutex);
+					taskFinished.wait(lock, [this, workerTask]() { return DependenciesFinished(*workerTask); });
+
+					if (workerTask->state == TaskState::FAILED)
+					{
+						taskFinished.notify_all();
+						return;
+					}
+
+					workerTask->state = TaskState::RUNNING;
+				}
+
+				Execute(*workerTask);
+			}));
+		}
+
+		// the main thread works through its own steps in order as their dependencies finish.
+		while (true)
+		{
+			Task* next = NULL;
+			bool waiting = false;
+			bool skipped = false;
+
+			{
+				std::unique_lock<std::mutex> lock(mutex);
+
+				for (auto& task : tasks)
+				{
+					if (!task.mainThread || task.state != TaskState::PENDING)
+					{
+						continue;
+					}
+
+					if (!DependenciesFinished(task))
+					{
+						waiting = true;
+						continue;
+					}
+
+					if (task.state == TaskState::FAILED)
+					{
+						skipped = true;
+						continue;
+					}
+
+					task.state = TaskState::RUNNING;
+					next = &task;
+					break;
+				}
+
+				if (next == NULL && skipped)
+				{
+					// failing a step may have unblocked others, so look again before sleeping.
+					taskFinished.notify_all();
+					continue;
+				}
+
+				if (next == NULL && waiting)
+				{
+					taskFinished.wait(lock);
+					continue;
+				}
+			}
+
+			if (next == NULL)
+			{
+				break;
+			}
+
+			Execute(*next);
+		}
+
+		for (auto& worker : workers)
+		{
+			worker.join();
+		}
+		#else
+		// no threads, so just keep running whatever is ready until nothing is left.
+		bool progress = true;
+
+		while (progress)
+		{
+			progress = false;
+
+			for (auto& task : tasks)
+			{
+				if (task.state == TaskState::PENDING && DependenciesFinished(task) && task.state == TaskState::PENDING)
+				{
+					task.state = TaskState::RUNNING;
+					Execute(task);
+					progress = true;
+				}
+			}
+		}
+		#endif
+
+		bool success = true;
+		for (auto& task : tasks)
+		{
+			success &= task.state == TaskState::SUCCEEDED;
+		}
+
+		return success;
+	}
+
+	void StartupGraph::Report()
+	{
+		double frequency = (double)SDL_GetPerformanceFrequency();
+		Uint64 lastEndCounter = runStartCounter;
+
+		COS_LOG_INFO("Startup timings (ms):");
+
+		for (auto& task : tasks)
+		{
+			if (task.startCounter == 0)
+			{
+				COS_LOG_INFO("  {} skipped", task.name);
+				continue;
+			}
+
+			COS_LOG_INFO("  {} started at {} took {}{}{}", task.name,
+				(task.startCounter - runStartCounter) * 1000.0 / frequency,
+				(task.endCounter - task.startCounter) * 1000.0 / frequency,
+				task.mainThread ? " on the main thread" : " on a worker",
+				task.state == TaskState::FAILED ? " and failed" : "");
+
+			lastEndCounter = SDL_max(lastEndCounter, task.endCounter);
+		}
+
+		COS_LOG_INFO("  total {}", (lastEndCounter - runStartCounter) * 1000.0 / frequency);
+	}
+
+	FrameGraph::FrameGraph() : remainingTasks(0)
+	{
+		resolved = false;
+		broken = false;
+		runningFrame = false;
+		traceFramesLeft = 0;
+		tracedFrames = 0;
+		traceStartCounter = 0;
+
+		#ifdef CRISPY_OCTO_SPORK_THREADS
+		// the main thread is busy with the pinned tasks, so leave it a core.
+		workerCount = SDL_max(1, SDL_min(SDL_GetCPUCount() - 1, 8));
+		queuedTasks = 0;
+		nextQueue = 0;
+		running = false;
+		#else
+		workerCount = 0;
+		#endif
+	}
+
+	FrameGraph::~FrameGraph()
+	{
+		Shutdown();
+	}
+
+	void FrameGraph::AddTask(std::string name, std::function<void()> run, std::vector<std::string> dependencies, bool mainThread)
+	{
+		Task task;
+		task.name = name;
+		task.run = run;
+		task.dependencyNames = dependencies;
+		task.mainThread = mainThread;
+
+		if (runningFrame)
+		{
+			addedTasks.push_back(task);
+			return;
+		}
+
+		tasks.push_back(task);
+		resolved = false;
+	}
+
+	void FrameGraph::AddDependency(const std::string& name, const std::string& dependency)
+	{
+		if (runningFrame)
+		{
+			addedDependencies.push_back({ name, dependency });
+			return;
+		}
+
+		for (auto& task : tasks)
+		{
+			if (task.name == name)
+			{
+				task.dependencyNames.push_back(dependency);
+				resolved = false;
+				return;
+			}
+		}
+
+		COS_LOG_ERR("Frame task {} does not exist to depend on {}", name, dependency);
+	}
+
+	void FrameGraph::SetWorkerCount(int count)
+	{
+		#ifdef CRISPY_OCTO_SPORK_THREADS
+		workerCount = SDL_max(0, count);
+		#endif
+	}
+
+	bool FrameGraph::Resolve()
+	{
+		if (!ResolveGraphTasks(tasks, "Frame task"))
+		{
+			return false;
+		}
+
+		waitingOn.reset(new std::atomic<int>[tasks.size()]);
+		return true;
+	}
+
+	void FrameGraph::ApplyAdditions()
+	{
+		for (auto& task : addedTasks)
+		{
+			tasks.push_back(task);
+		}
+
+		resolved &= addedTasks.empty();
+		addedTasks.clear();
+
+		for (auto& added : addedDependencies)
+		{
+			AddDependency(added.first, added.second);
+		}
+
+		addedDependencies.clear();
+	}
+
+	void FrameGraph::Run()
+	{
+		if (!addedTasks.empty() || !addedDependencies.empty())
+		{
+			ApplyAdditions();
+		}
+
+		if (!resolved)
+		{
+			resolved = true;
+			broken = !Resolve();
+		}
+
+		runningFrame = true;
+
+		// a broken graph still has to draw frames, so fall back to running everything in the order it was added.
+		if (broken)
+		{
+			for (auto& task : tasks)
+			{
+				task.run();
+			}
+
+			runningFrame = false;
+			return;
+		}
+
+		#ifdef CRISPY_OCTO_SPORK_THREADS
+		StartWorkers();
+		#endif
+
+		if (traceFramesLeft > 0 && traceStartCounter == 0)
+		{
+			traceStartCounter = SDL_GetPerformanceCounter();
+		}
+
+		remainingTasks = (int)tasks.size();
+
+		for (size_t i = 0; i < tasks.size(); i++)
+		{
+			waitingOn[i] = (int)tasks[i].dependencies.size();
+		}
+
+		for (size_t i = 0; i < tasks.size(); i++)
+		{
+			if (tasks[i].dependencies.empty())
+			{
+				Push((int)i, -1);
+			}
+		}
+
+		// the main thread only ever runs pinned tasks, the workers handle everything else.
+		while (true)
+		{
+			int next = -1;
+
+			{
+				#ifdef CRISPY_OCTO_SPORK_THREADS
+				std::unique_lock<std::mutex> lock(sleepMutex);
+				mainWoken.wait(lock, [this]() { return !mainTasks.empty() || remainingTasks == 0; });
+				#endif
+
+				if (mainTasks.empty())
+				{
+					break;
+				}
+
+				next = mainTasks.front();
+				mainTasks.pop_front();
+			}
+
+			Execute(next, -1);
+		}
+
+		runningFrame = false;
+
+		if (traceFramesLeft > 0)
+		{
+			for (size_t i = 0; i < tasks.size(); i++)
+			{
+				traceEvents.push_back({ tracedFrames, (int)i, tasks[i].thread, tasks[i].startCounter, tasks[i].endCounter });
+			}
+
+			tracedFrames++;
+
+			if (--traceFramesLeft == 0)
+			{
+				WriteTrace();
+			}
+		}
+	}
+
+	void FrameGraph::Push(int task, int queue)
+	{
+		#ifdef CRISPY_OCTO_SPORK_THREADS
+		if (!tasks[task].mainThread && !queues.empty())
+		{
+			// readied by a worker means it probably wants what that worker just made, so keep it there.
+			int target = queue >= 0 ? queue : (int)(nextQueue++ % queues.size());
+
+			{
+				std::lock_guard<std::mutex> lock(queues[target]->mutex);
+				queues[target]->tasks.push_back(task);
+			}
+
+			queuedTasks++;
+
+			{
+				std::lock_guard<std::mutex> lock(sleepMutex);
+			}
+
+			workAdded.notify_one();
+			return;
+		}
+
+		std::lock_guard<std::mutex> lock(sleepMutex);
+		mainTasks.push_back(task);
+		mainWoken.notify_one();
+		#else
+		mainTasks.push_back(task);
+		#endif
+	}
+
+	void FrameGraph::Execute(int task, int queue)
+	{
+		Task& current = tasks[task];
+		current.thread = queue + 1;
+
+		// timings are only for the trace, and reading the counter isn't free on every platform.
+		if (traceFramesLeft > 0)
+		{
+			current.startCounter = SDL_GetPerformanceCounter();
+			current.run();
+			current.endCounter = SDL_GetPerformanceCounter();
+		}
+		else
+		{
+			current.run();
+		}
+
+		for (int dependent : current.dependents)
+		{
+			if (--waitingOn[dependent] == 0)
+			{
+				Push(dependent, queue);
+			}
+		}
+
+		if (--remainingTasks == 0)
+		{
+			#ifdef CRISPY_OCTO_SPORK_THREADS
+			std::lock_guard<std::mutex> lock(sleepMutex);
+			mainWoken.notify_one();
+			#endif
+		}
+	}
+
+	#ifdef CRISPY_OCTO_SPORK_THREADS
+	void FrameGraph::StartWorkers()
+	{
+		if (running || workerCount == 0)
+		{
+			return;
+		}
+
+		bool needed = false;
+		for (auto& task : tasks)
+		{
+			needed |= !task.mainThread;
+		}
+
+		if (!needed)
+		{
+			return;
+		}
+
+		running = true;
+
+		for (int i = 0; i < workerCount; i++)
+		{
+			queues.push_back(std::unique_ptr<WorkerQueue>(new WorkerQueue()));
+		}
+
+		for (int i = 0; i < workerCount; i++)
+		{
+			workers.push_back(std::thread([this, i]() { WorkerLoop(i); }));
+		}
+	}
+
+	void FrameGraph::WorkerLoop(int queue)
+	{
+		while (true)
+		{
+			int task = TakeTask(queue);
+
+			if (task >= 0)
+			{
+				Execute(task, queue);
+				continue;
+			}
+
+			std::unique_lock<std::mutex> lock(sleepMutex);
+			workAdded.wait(lock, [this]() { return queuedTasks > 0 || !running; });
+
+			if (!running)
+			{
+				return;
+			}
+		}
+	}
+
+	int FrameGraph::TakeTask(int queue)
+	{
+		// newest first from our own queue while it's still warm in the cache, oldest first from anyone else's.
+		for (size_t i = 0; i < queues.size(); i++)
+		{
+			WorkerQueue& victim = *queues[(queue + i) % queues.size()];
+			std::lock_guard<std::mutex> lock(victim.mutex);
+
+			if (victim.tasks.empty())
+			{
+				continue;
+			}
+
+			int task;
+
+			if (i == 0)
+			{
+				task = victim.tasks.back();
+				victim.tasks.pop_back();
+			}
+			else
+			{
+				task = victim.tasks.front();
+				victim.tasks.pop_front();
+			}
+
+			queuedTasks--;
+			return task;
+		}
+
+		return -1;
+	}
+	#endif
+
+	void FrameGraph::Shutdown()
+	{
+		#ifdef CRISPY_OCTO_SPORK_THREADS
+		{
+			std::lock_guard<std::mutex> lock(sleepMutex);
+			running = false;
+		}
+
+		workAdded.notify_all();
+
+		for (auto& worker : workers)
+		{
+			worker.join();
+		}
+
+		workers.clear();
+		queues.clear();
+		#endif
+	}
+
+	void FrameGraph::BeginTrace(const std::string& filepath, Uint32 frames)
+	{
+		tracePath = filepath;
+		traceFramesLeft = frames;
+		tracedFrames = 0;
+		traceStartCounter = 0;
+		traceEvents.clear();
+	}
+
+	void FrameGraph::WriteTrace()
+	{
+		double microsecondsPerCount = 1000000.0 / (double)SDL_GetPerformanceFrequency();
+		auto timestamp = [this, microsecondsPerCount](Uint64 counter)
+		{
+			return std::to_string((double)(counter - traceStartCounter) * microsecondsPerCount);
+		};
+
+		std::string json = "{\"traceEvents\":[\n";
+		json += "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":0,\"args\":{\"name\":\"main\"}}";
+
+		for (int i = 1; i <= workerCount; i++)
+		{
+			json += ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" + std::to_string(i) + ",\"args\":{\"name\":\"worker " + std::to_string(i) + "\"}}";
+		}
+
+		// each frame recorded its tasks in order, so a dependency is found at its own index from the start of the frame.
+		Uint64 flowId = 0;
+
+		for (size_t i = 0; i < traceEvents.size(); i++)
+		{
+			const TraceEvent& event = traceEvents[i];
+			const Task& task = tasks[event.task];
+			size_t frameStart = i - event.task;
+
+			json += ",\n{\"name\":\"" + EscapeJson(task.name) + "\",\"cat\":\"frame\",\"ph\":\"X\",\"pid\":1,\"tid\":" + std::to_string(event.thread)
+				+ ",\"ts\":" + timestamp(event.startCounter) + ",\"dur\":" + std::to_string((double)(event.endCounter - event.startCounter) * microsecondsPerCount)
+				+ ",\"args\":{\"frame\":" + std::to_string(event.frame) + "}}";
+
+			// an arrow from the end of each dependency to the start of the task.
+			for (int dependency : task.dependencies)
+			{
+				// anything added to the graph partway through the trace wasn't there to be recorded in earlier frames.
+				if (frameStart + dependency >= traceEvents.size() || traceEvents[frameStart + dependency].frame != event.frame)
+				{
+					continue;
+				}
+
+				const TraceEvent& from = traceEvents[frameStart + dependency];
+				std::string id = std::to_string(flowId++);
+
+				json += ",\n{\"name\":\"waits on\",\"cat\":\"frame\",\"ph\":\"s\",\"id\":" + id + ",\"pid\":1,\"tid\":" + std::to_string(from.thread)
+					+ ",\"ts\":" + timestamp(from.endCounter) + "}";
+				json += ",\n{\"name\":\"waits on\",\"cat\":\"frame\",\"ph\":\"f\",\"bp\":\"e\",\"id\":" + id + ",\"pid\":1,\"tid\":" + std::to_string(event.thread)
+					+ ",\"ts\":" + timestamp(event.startCounter) + "}";
+			}
+		}
+
+		json += "\n]}\n";
+
+		FileBatch batch;
+		batch.AddWrite(tracePath, std::vector<Uint8>(json.begin(), json.end()));
+
+		if (FileIO::Get().Run(batch))
+		{
+			COS_LOG_INFO("Wrote a trace of {} frames to {}", tracedFrames, tracePath);
+		}
+		else
+		{
+			COS_LOG_ERR("Could not write the frame trace: {}", tracePath);
+		}
+
+		std::vector<TraceEvent>().swap(traceEvents);
+	}
+
+	std::string FrameGraph::EscapeJson(const std::string& text)
+	{
+		std::string escaped;
+		escaped.reserve(text.size());
+
+		for (char character : text)
+		{
+			if (character == '"' || character == '\\')
+			{
+				escaped += '\\';
+				escaped += character;
+			}
+			else if ((unsigned char)character < 0x20)
+			{
+				char code[8];
+				SDL_snprintf(code, sizeof(code), "\\u%04x", (unsigned char)character);
+				escaped += code;
+			}
+			else
+			{
+				escaped += character;
+			}
+		}
+
+		return escaped;
+	}
+
+	LatencyHistogram::LatencyHistogram()
+	{
+		Reset();
+	}
+
+	void LatencyHistogram::Record(float milliseconds)
+	{
+		int bucket = milliseconds < 0 ? 0 : (int)milliseconds;
+
+		if (bucket >= BUCKET_COUNT)
+		{
+			bucket = BUCKET_COUNT - 1;
+		}
+
+		buckets[bucket]++;
+		count++;
+		total += milliseconds;
+	}
+
+	float LatencyHistogram::GetPercentile(float percentile)
+	{
+		if (count == 0)
+		{
+			return 0;
+		}
+
+		// walk the buckets until we've passed the requested share of the samples.
+		int target = (int)ceilf(count * percentile / 100.0f);
+		int seen = 0;
+
+		for (int i = 0; i < BUCKET_COUNT; i++)
+		{
+			seen += buckets[i];
+			if (seen >= target && seen > 0)
+			{
+				return (float)(i + 1);
+			}
+		}
+
+		return (float)BUCKET_COUNT;
+	}
+
+	float LatencyHistogram::GetAverage()
+	{
+		return count == 0 ? 0 : (float)(total / count);
+	}
+
+	int LatencyHistogram::GetCount()
+	{
+		return count;
+	}
+
+	void LatencyHistogram::Reset()
+	{
+		for (int i = 0; i < BUCKET_COUNT; i++)
+		{
+			buckets[i] = 0;
+		}
+
+		count = 0;
+		total = 0;
+	}
+
+	InputLatencyTracker::InputLatencyTracker()
+	{
+		nextId = 1;
+		ticksAwaitingPresent = 0;
+	}
+
+	Uint32 InputLatencyTracker::OnInputPolled(Uint32 eventTimestamp)
+	{
+		Uint32 id = nextId++;
+
+		// 0 means "no input" so skip it when the counter wraps.
+		if (nextId == 0)
+		{
+			nextId = 1;
+		}
+
+		Sample* sample = &samples[id % MAX_INPUTS_IN_FLIGHT];
+		sample->id = id;
+		sample->stage = Stage::POLLED;
+		sample->queueing = (float)(SDL_GetTicks() - eventTimestamp);
+		sample->polledCounter = SDL_GetPerformanceCounter();
+		sample->tickedCounter = 0;
+
+		return id;
+	}
+
+	void InputLatencyTracker::OnInputApplied(Uint32 id)
+	{
+		Sample* sample = Find(id);
+
+		if (sample != NULL && sample->stage == Stage::POLLED)
+		{
+			sample->stage = Stage::APPLIED;
+		}
+	}
+
+	void InputLatencyTracker::OnEventDispatched(Uint32 id)
+	{
+		Sample* sample = Find(id);
+
+		if (sample != NULL && sample->stage == Stage::POLLED)
+		{
+			sample->stage = Stage::NONE;
+		}
+	}
+
+	void InputLatencyTracker::OnInputTicked(Uint32 id)
+	{
+		Sample* sample = Find(id);
+
+		if (sample != NULL && sample->stage == Stage::APPLIED)
+		{
+			sample->stage = Stage::TICKED;
+			sample->tickedCounter = SDL_GetPerformanceCounter();
+			ticksAwaitingPresent++;
+		}
+	}
+
+	void InputLatencyTracker::OnFramePresented()
+	{
+		if (ticksAwaitingPresent == 0)
+		{
+			return;
+		}
+
+		Uint64 presentedCounter = SDL_GetPerformanceCounter();
+
+		for (int i = 0; i < MAX_INPUTS_IN_FLIGHT; i++)
+		{
+			Sample* sample = &samples[i];
+
+			if (sample->stage != Stage::TICKED)
+			{
+				continue;
+			}
+
+			float waiting = CounterToMilliseconds(sample->tickedCounter - sample->polledCounter);
+			float rendering = CounterToMilliseconds(presentedCounter - sample->tickedCounter);
+
+			queueing.Record(sample->queueing);
+			waitingForTick.Record(waiting);
+			render.Record(rendering);
+			total.Record(sample->queueing + waiting + rendering);
+
+			sample->stage = Stage::NONE;
+		}
+
+		ticksAwaitingPresent = 0;
+	}
+
+	void InputLatencyTracker::Report()
+	{
+		if (total.GetCount() == 0)
+		{
+			return;
+		}
+
+		LatencyHistogram* histograms[] = { &queueing, &waitingForTick, &render, &total };
+		const char* names[] = { "queueing", "waiting for tick", "render", "total" };
+
+		COS_LOG_INFO("Input to present latency over {} inputs (ms):", total.GetCount());
+
+		for (int i = 0; i < 4; i++)
+		{
+			COS_LOG_INFO("  {} avg {} p50 {} p95 {} p99 {}", names[i],
+				histograms[i]->GetAverage(),
+				histograms[i]->GetPercentile(50),
+				histograms[i]->GetPercentile(95),
+				histograms[i]->GetPercentile(99));
+		}
+	}
+
+	InputLatencyTracker::Sample* InputLatencyTracker::Find(Uint32 id)
+	{
+		if (id == 0)
+		{
+			return NULL;
+		}
+
+		Sample* sample = &samples[id % MAX_INPUTS_IN_FLIGHT];
+		return sample->id == id ? sample : NULL;
+	}
+
+	float InputLatencyTracker::CounterToMilliseconds(Uint64 counterDelta)
+	{
+		return (float)((double)counterDelta * 1000.0 / (double)SDL_GetPerformanceFrequency());
+	}
+
+	Entity::Entity()
+	{
+		x = 0;
+		y = 0;
+	}
+
+	Entity::Entity(float x, float y)
+	{
+		this->x = x;
+		this->y = y;
+	}
+
+	Sprite::Sprite()
+	{
+		this->width = 0;
+		this->height = 0;
+		this->texture = NULL;
+		this->renderer = NULL;
+	}
+
+	Sprite::Sprite(float x, float y, float width, float height, Texture* texture, Renderer* renderer) : Entity(x, y)
+	{
+		this->width = width;
+		this->height = height;
+		this->texture = texture;
+		this->renderer = renderer;
+	}
+
+	Sprite::Sprite(float x, float y, float width, float height, Texture* texture, SDL_Renderer* renderer) : Sprite(x, y, width, height, texture, Renderer::FromSDLRenderer(renderer))
+	{}
+
+	bool Sprite::OnRender(float deltaTime)
+	{
+		texture->Render(x, y);
+
+		return true;
+	}
+
+	Rectangle::Rectangle()
 	{
-		SDL_Init(SDL_INIT_VIDEO);
+		this->width = 0;
+		this->height = 0;
+		this->color = SDL_Color{255, 255, 255, 255};
+		this->renderer = NULL;
+	}
 
-		window = NULL;
-		renderer = NULL;
-		screenWidth = 0;
-		screenHeight = 0;
-		isVsyncEnabled = true;
-		isFullscreenEnabled = false;
-		name = "";
-		isEngineRunning = false;
+	Rectangle::Rectangle(float x, float y, float width, float height, SDL_Color color, Renderer* renderer) : Entity(x, y)
+	{
+		this->width = width;
+		this->height = height;
+		this->color = color;
+		this->renderer = renderer;
 	}
 
-	Engine::~Engine()
+	Rectangle::Rectangle(float x, float y, float width, float height, SDL_Color color, SDL_Renderer* renderer) : Rectangle(x, y, width, height, color, Renderer::FromSDLRenderer(renderer))
 	{}
 
-	bool Engine::Create(std::string name, int width, int height, bool vsync, bool fullscreen)
+	bool Rectangle::OnRender(float deltaTime)
 	{
-		this->name = name;
-		this->screenWidth = width;
-		this->screenHeight = height;
-		this->isVsyncEnabled = vsync;
-		this->isFullscreenEnabled = fullscreen;
+		renderer->SetDrawColor(color.r, color.g, color.b, color.a);
+		SDL_FRect rect = { x, y, width, height };
+		renderer->FillRectF(&rect);
+		return false;
+	}
+
+	Circle::Circle()
+	{
+		this->radius = 0;
+		this->color = SDL_Color{ 255, 255, 255, 255 };
+		this->renderer = NULL;
+	}
+
+	Circle::Circle(float x, float y, float radius, SDL_Color color, Renderer* renderer) : Entity(x, y)
+	{
+		this->radius = radius;
+		this->color = color;
+		this->renderer = renderer;
+	}
+
+	Circle::Circle(float x, float y, float radius, SDL_Color color, SDL_Renderer* renderer) : Circle(x, y, radius, color, Renderer::FromSDLRenderer(renderer))
+	{}
+
+	bool Circle::OnRender(float deltaTime)
+	{
+		renderer->SetDrawColor(color.r, color.g, color.b, color.a);
+		for (int w = 0; w < radius * 2; w++)
+		{
+			for (int h = 0; h < radius * 2; h++)
+			{
+				int dx = radius - w; // horizontal offset
+				int dy = radius - h; // vertical offset
+				if ((dx * dx + dy * dy) <= (radius * radius))
+				{
+					renderer->DrawPoint(x + dx, y + dy);
+				}
+			}
+		}
+		return false;
+	}
+
+	Entity::~Entity()
+	{
+	}
+
+	bool Entity::OnUpdate(float deltaTime)
+	{
+		return true;
+	}
+
+	bool Entity::OnRender(float deltaTime)
+	{
+		return true;
+	}
+
+	SoundEffect::SoundEffect()
+	{
+		mixChunk = NULL;
+		trackedBytes = 0;
+	}
+
+	SoundEffect::~SoundEffect()
+	{
+		Free();
+	}
+
+	bool SoundEffect::LoadSoundFromFile(const char* filepath)
+	{
+		Free();
+
+		if (AudioDevice::Get().IsNull())
+		{
+			AudioDevice::Get().soundsLoaded++;
+			return true;
+		}
+
+		mixChunk = Mix_LoadWAV(filepath);
+		if (mixChunk == NULL)
+		{
+			COS_LOG_ERR("Failed to load scratch sound effect! SDL_mixer Error: {}", Mix_GetError());
+			return false;
+		}
+
+		trackedBytes = mixChunk->alen;
+		MemoryTracker::Get().AddExternal(MemoryTag::AUDIO, trackedBytes);
+
+		return true;
+	}
+
+	bool SoundEffect::LoadSoundFromMemory(const void* data, size_t size)
+	{
+		Free();
+
+		if (AudioDevice::Get().IsNull())
+		{
+			AudioDevice::Get().soundsLoaded++;
+			return true;
+		}
+
+		mixChunk = Mix_LoadWAV_RW(SDL_RWFromConstMem(data, (int)size), 1);
+		if (mixChunk == NULL)
+		{
+			COS_LOG_ERR("Failed to decode sound effect! SDL_mixer Error: {}", Mix_GetError());
+			return false;
+		}
+
+		trackedBytes = mixChunk->alen;
+		MemoryTracker::Get().AddExternal(MemoryTag::AUDIO, trackedBytes);
+
+		return true;
+	}
+
+	void SoundEffect::Free()
+	{
+		if (mixChunk != NULL) 
+		{
+			AudioDevice::Get().Forget(mixChunk);
+			Mix_FreeChunk(mixChunk);
+			MemoryTracker::Get().RemoveExternal(MemoryTag::AUDIO, trackedBytes);
+			trackedBytes = 0;
+		}
+
+		mixChunk = NULL;		
+	}
+
+	bool SoundEffect::PlaySound()
+	{
+		if (mixChunk == NULL && !AudioDevice::Get().IsNull())
+		{
+			return false;
+		}
+
+		AudioDevice::Get().QueuePlay(mixChunk);
+		return true;
+	}
+
+	Texture::Texture()
+	{
+		this->texture = NULL;
+		this->renderer = NULL;
+		this->width = 0;
+		this->height = 0;
+		this->font = NULL;
+		this->trackedTextureBytes = 0;
+		this->trackedFontBytes = 0;
+		this->lastUsedFrame = 0;
+	}
+
+	Texture::Texture(Renderer* renderer, const char* fontFilePath, int fontSize)
+	{
+		this->texture = NULL;
+		this->width = 0;
+		this->height = 0;
+		this->renderer = renderer;
+		this->fontSize = fontSize;
+		this->font = NULL;
+		this->trackedTextureBytes = 0;
+		this->trackedFontBytes = 0;
+		this->lastUsedFrame = 0;
+
+		if (fontFilePath != NULL) 
+		{
+			FileBatch batch;
+			batch.AddRead(fontFilePath);
+
+			if (!FileIO::Get().Run(batch))
+			{
+				COS_LOG_ERR("Could not read the font: {}", fontFilePath);
+			}
+			else
+			{
+				LoadFontFromMemory(std::move(batch.requests[0].data), fontSize);
+			}
+		}
+	}
+
+	Texture::Texture(SDL_Renderer* renderer, const char* fontFilePath, int fontSize) : Texture(Renderer::FromSDLRenderer(renderer), fontFilePath, fontSize)
+	{}
+
+	bool Texture::LoadFontFromMemory(std::vector<Uint8> data, int fontSize)
+	{
+		if (font != NULL)
+		{
+			TTF_CloseFont(font);
+			MemoryTracker::Get().RemoveExternal(MemoryTag::FONTS, trackedFontBytes);
+			trackedFontBytes = 0;
+		}
+
+		fontData = std::move(data);
+		this->fontSize = fontSize;
+		font = TTF_OpenFontRW(SDL_RWFromConstMem(fontData.data(), (int)fontData.size()), 1, fontSize);
+
+		if (font == NULL)
+		{
+			COS_LOG_ERR("Could not load the font{}", TTF_GetError());
+			std::vector<Uint8>().swap(fontData);
+			return false;
+		}
+
+		// SDL_ttf keeps the whole face loaded, so the file size is a fair estimate.
+		trackedFontBytes = (Sint64)fontData.size();
+		MemoryTracker::Get().AddExternal(MemoryTag::FONTS, trackedFontBytes);
+
+		return true;
+	}
+
+	Texture::~Texture()
+	{
+		Free();
+
+		if (font != NULL) 
+		{
+			TTF_CloseFont(font);
+			MemoryTracker::Get().RemoveExternal(MemoryTag::FONTS, trackedFontBytes);
+		}
+	}
+
+	bool Texture::LoadTextureFromFile(const char* filepath)
+	{
+		Free();
+
+		// prefer a baked copy if one has been built and is still current, it skips the png decode entirely.
+		std::vector<Uint8> baked;
+
+		if (ReadFileContents(GetBakedPath(filepath).c_str(), baked) && IsBakeCurrent(baked.data(), baked.size(), filepath)
+			&& LoadTextureFromBakedMemory(baked.data(), baked.size()))
+		{
+			return true;
+		}
+
+		texture = renderer->LoadTexture(SDL_RWFromFile(filepath, "rb"), &width, &height);
+
+		if (texture == NULL)
+		{
+			COS_LOG_ERR("Could not load the texture from: {} Error:{}", filepath, SDL_GetError());
+			return false;
+		}
+
+		TrackTextureMemory();
+
+		return true;
+	}
+
+	bool Texture::LoadTextureFromBakedFile(const char* filepath)
+	{
+		std::vector<Uint8> data;
+
+		if (!ReadFileContents(filepath, data))
+		{
+			COS_LOG_ERR("Could not read the baked texture: {} Error:{}", filepath, SDL_GetError());
+			return false;
+		}
+
+		return LoadTextureFromBakedMemory(data.data(), data.size());
+	}
+
+	bool Texture::LoadFromSurface(SDL_Surface* surface)
+	{
+		Free();
+
+		texture = renderer->CreateTextureFromSurface(surface);
+
+		if (texture == NULL)
+		{
+			COS_LOG_ERR("There was an error creating the texture{}", SDL_GetError());
+			return false;
+		}
+
+		width = surface->w;
+		height = surface->h;
+		TrackTextureMemory();
+
+		return true;
+	}
+
+	bool Texture::IsBakedTexture(const void* data, size_t size)
+	{
+		return size >= sizeof(BakedTextureHeader) && SDL_memcmp(data, BAKED_TEXTURE_MAGIC, sizeof(BAKED_TEXTURE_MAGIC)) == 0;
+	}
+
+	bool Texture::IsBakeCurrent(const void* data, size_t size, const char* sourcePath)
+	{
+		if (!IsBakedTexture(data, size))
+		{
+			return false;
+		}
+
+		BakedTextureHeader header;
+		SDL_memcpy(&header, data, sizeof(header));
+
+		if (header.version != BAKED_TEXTURE_VERSION)
+		{
+			COS_LOG_WARN("The baked copy of {} is from an older version, using the image. Rebake it.", sourcePath);
+			return false;
+		}
+
+		Uint32 sourceSize;
+		Uint64 sourceModified;
+
+		if (!GetFileStamp(sourcePath, sourceSize, sourceModified))
+		{
+			return true;
+		}
+
+		if (sourceSize != header.sourceSize || sourceModified != header.sourceModified)
+		{
+			COS_LOG_WARN("{} has changed since it was baked, using the image. Rebake it.", sourcePath);
+			return false;
+		}
+
+		return true;
+	}
+
+	bool Texture::GetFileStamp(const char* filepath, Uint32& size, Uint64& modified)
+	{
+		struct stat fileStat;
+
+		if (stat(filepath, &fileStat) != 0)
+		{
+			return false;
+		}
 
-		Uint32 windowFlags = SDL_WINDOW_SHOWN;
+		size = (Uint32)fileStat.st_size;
+		modified = (Uint64)fileStat.st_mtime;
+		return true;
+	}
 
-		if (this->isFullscreenEnabled)
+	bool Texture::LoadTextureFromMemory(const void* data, size_t size)
+	{
+		if (IsBakedTexture(data, size))
 		{
-			windowFlags |= SDL_WINDOW_FULLSCREEN;
+			return LoadTextureFromBakedMemory(data, size);
 		}
 
-		this->window = SDL_CreateWindow(this->name.c_str(), 
-										SDL_WINDOWPOS_UNDEFINED, 
-										SDL_WINDOWPOS_UNDEFINED, 
-										this->screenWidth, 
-										this->screenHeight, 
-										windowFlags);
+		Free();
+
+		texture = renderer->LoadTexture(SDL_RWFromConstMem(data, (int)size), &width, &height);
 
-		if (this->window == NULL) 
+		if (texture == NULL)
 		{
-			std::cout << "Failed to create window: " << SDL_GetError() << std::endl;
+			COS_LOG_ERR("Could not decode the texture. Error:{}", IMG_GetError());
 			return false;
 		}
 
-		Uint32 rendererFlags = SDL_RENDERER_ACCELERATED;
+		TrackTextureMemory();
+
+		return true;
+	}
+
+	bool Texture::LoadTextureFromBakedMemory(const void* data, size_t size)
+	{
+		Free();
 
-		if (this->isVsyncEnabled)
+		if (size < sizeof(BakedTextureHeader))
 		{
-			rendererFlags |= SDL_RENDERER_PRESENTVSYNC;
+			COS_LOG_ERR("Baked texture is too small to hold a header.");
+			return false;
 		}
 
-		this->renderer = SDL_CreateRenderer(window, -1, rendererFlags);
+		BakedTextureHeader header;
+		SDL_memcpy(&header, data, sizeof(header));
 
-		if (renderer == NULL)
+		if (SDL_memcmp(header.magic, BAKED_TEXTURE_MAGIC, sizeof(header.magic)) != 0 || header.version != BAKED_TEXTURE_VERSION)
 		{
-			std::cout << "Failed to create renderer: " << SDL_GetError() << std::endl;
+			COS_LOG_ERR("Baked texture has an unknown header, rebake it.");
 			return false;
 		}
 
-		int imgFlags = IMG_INIT_PNG;
-		if (!(IMG_Init(imgFlags) & imgFlags))
+		// checked before any of it is multiplied, so a corrupt header can't wrap the size check around.
+		if (header.width == 0 || header.height == 0 || header.width > BAKED_TEXTURE_MAX_SIZE || header.height > BAKED_TEXTURE_MAX_SIZE
+			|| SDL_ISPIXELFORMAT_FOURCC(header.format) || SDL_BYTESPERPIXEL(header.format) == 0)
 		{
-			std::cout << "Failed to create renderer: " << IMG_GetError() << std::endl;
+			COS_LOG_ERR("Baked texture has a corrupt header, rebake it.");
 			return false;
 		}
 
-		if (TTF_Init() == -1)
+		size_t pitch = (size_t)header.width * SDL_BYTESPERPIXEL(header.format);
+
+		if (size - sizeof(header) < pitch * header.height)
 		{
-			std::cout << "SDL_ttf could not initialize!: " << TTF_GetError() << std::endl;
+			COS_LOG_ERR("Baked texture is missing pixel data.");
 			return false;
 		}
 
-		if (Mix_OpenAudio(44100, MIX_DEFAULT_FORMAT, 2, 2048) < 0)
+		const Uint8* pixels = (const Uint8*)data + sizeof(header);
+		Uint32 format = header.format;
+		std::vector<Uint8> converted;
+
+		// baked for another renderer. converted once here, or SDL would convert on every upload behind our back.
+		if (!renderer->SupportsTextureFormat(format))
+		{
+			Uint32 nativeFormat = renderer->GetNativeTextureFormat();
+			size_t nativePitch = (size_t)header.width * SDL_BYTESPERPIXEL(nativeFormat);
+
+			if (!SDL_ISPIXELFORMAT_FOURCC(nativeFormat) && SDL_BYTESPERPIXEL(nativeFormat) != 0)
+			{
+				converted.resize(nativePitch * header.height);
+
+				if (SDL_ConvertPixels(header.width, header.height, format, pixels, (int)pitch, nativeFormat, converted.data(), (int)nativePitch) == 0)
+				{
+					COS_LOG_WARN("Baked texture is {} but the renderer wants {}, rebake it to skip converting.",
+						SDL_GetPixelFormatName(format), SDL_GetPixelFormatName(nativeFormat));
+					pixels = converted.data();
+					pitch = nativePitch;
+					format = nativeFormat;
+				}
+			}
+		}
+
+		texture = renderer->CreateTexture(format, SDL_TEXTUREACCESS_STATIC, header.width, header.height);
+
+		if (texture == NULL)
 		{
-			std::cout << "Failed to start the mixer: " << Mix_GetError() << std::endl;
+			COS_LOG_ERR("Could not create the baked texture. Error:{}", SDL_GetError());
 			return false;
 		}
 
+		renderer->UpdateTexture(texture, NULL, pixels, (int)pitch);
+		renderer->SetTextureBlendMode(texture, SDL_BLENDMODE_BLEND);
+
+		width = header.width;
+		height = header.height;
+		TrackTextureMemory();
+
 		return true;
 	}
 
-	bool Engine::Start()
+	bool Texture::BakeTextureFile(const char* sourcePath, const char* bakedPath, Uint32 format)
 	{
-		isEngineRunning = true;
+		if (SDL_ISPIXELFORMAT_FOURCC(format) || SDL_BYTESPERPIXEL(format) == 0)
+		{
+			COS_LOG_ERR("Can't bake {} into {}, it needs a packed pixel format.", sourcePath, SDL_GetPixelFormatName(format));
+			return false;
+		}
 
-		this->OnCreate();
+		SDL_Surface* loaded = IMG_Load(sourcePath);
 
-		#ifdef __EMSCRIPTEN__
-		emscripten_set_main_loop_arg(Engine::Update, this, -1, 1);
-		#else
-		while (isEngineRunning)
+		if (loaded == NULL)
 		{
-			Update(this);
+			COS_LOG_ERR("Could not load the image to bake from: {} Error:{}", sourcePath, IMG_GetError());
+			return false;
 		}
-		#endif
 
-		OnDestroy();
-		SDL_Quit();
-		IMG_Quit();
-		return true;
-	}
+		SDL_Surface* converted = SDL_ConvertSurfaceFormat(loaded, format, 0);
+		SDL_FreeSurface(loaded);
 
+		if (converted == NULL)
+		{
+			COS_LOG_ERR("Could not convert the image to bake: {} Error:{}", sourcePath, SDL_GetError());
+			return false;
+		}
 
-	void Engine::Update(void* arg)
-	{
-		Engine* engine = (Engine*)arg;
+		SDL_RWops* file = SDL_RWFromFile(bakedPath, "wb");
 
-		SDL_Event event;
-		while (SDL_PollEvent(&event))
+		if (file == NULL)
 		{
-			switch (event.type)
-			{
-			case SDL_QUIT:
-				engine->isEngineRunning = false;
-				break;
-			}
-
-			engine->OnEvent(event);
+			COS_LOG_ERR("Could not open the baked texture for writing: {} Error:{}", bakedPath, SDL_GetError());
+			SDL_FreeSurface(converted);
+			return false;
 		}
 
-		Uint32 currentFrameTime = SDL_GetTicks();
-		float deltaTime = currentFrameTime - engine->lastFrameTime;
-		engine->lastFrameTime = currentFrameTime;
-
-		SDL_SetRenderDrawColor(engine->renderer, 135, 206, 235, 255);
-		SDL_RenderClear(engine->renderer);
+		BakedTextureHeader header = {};
+		SDL_memcpy(header.magic, BAKED_TEXTURE_MAGIC, sizeof(header.magic));
+		header.version = BAKED_TEXTURE_VERSION;
+		header.format = format;
+		header.width = converted->w;
+		header.height = converted->h;
+		GetFileStamp(sourcePath, header.sourceSize, header.sourceModified);
 
-		engine->OnUpdate(deltaTime);
-		SDL_RenderPresent(engine->renderer);
+		bool success = SDL_RWwrite(file, &header, sizeof(header), 1) == 1;
 
-		if (engine->frameRate.OnUpdate() != 0.0)
+		SDL_LockSurface(converted);
+		for (int row = 0; row < converted->h && success; row++)
 		{
-			std::string newWindowTitle = engine->name + " - " + std::to_string(engine->frameRate.GetCurrentFramesPerSecond()) + " FPS - " + std::to_string(deltaTime);
-			SDL_SetWindowTitle(engine->window, newWindowTitle.c_str());
+			const Uint8* pixels = (const Uint8*)converted->pixels + row * converted->pitch;
+			success = SDL_RWwrite(file, pixels, converted->w * SDL_BYTESPERPIXEL(format), 1) == 1;
 		}
-	}
-
-	bool Engine::OnCreate()
-	{
-		lastFrameTime = SDL_GetTicks();
-		return true;
-	}
+		SDL_UnlockSurface(converted);
 
-	bool Engine::OnUpdate(float deltaTime)
-	{
-		return true;
-	}
+		SDL_RWclose(file);
+		SDL_FreeSurface(converted);
 
-	bool Engine::OnRender(float deltaTime)
-	{
-		for (auto& entity : entities)
+		if (!success)
 		{
-			entity->OnRender(deltaTime);
+			COS_LOG_ERR("Could not write the baked texture: {}", bakedPath);
 		}
 
-		return true;
+		return success;
 	}
 
-	bool Engine::OnEvent(SDL_Event event)
+	std::string Texture::GetBakedPath(const char* filepath)
 	{
-		return true;
-	}
+		std::string path = filepath;
+		size_t extension = path.find_last_of('.');
+		size_t directory = path.find_last_of("/\\");
 
-	bool Engine::OnDestroy()
-	{
-		for (auto p : entities)
+		if (extension != std::string::npos && (directory == std::string::npos || extension > directory))
 		{
-			delete p;
+			path.erase(extension);
 		}
 
-		entities.clear();
-		return true;
+		return path + ".raw";
 	}
 
-	void Engine::AddEntity(Entity* entity)
+	inline bool Texture::LoadFromRenderedText(std::string text, SDL_Color textColor)
 	{
-		entities.push_back(entity);
-	}
+		Free();
 
-	void Engine::DrawQuad(SDL_FPoint* points, SDL_Color color, float rotation)
-	{
-		SDL_SetRenderDrawColor(renderer, color.r, color.g, color.b, color.a);
+		if (font == NULL)
+		{
+			COS_LOG_ERR("No font associated with this texture! Make sure you construct it with one.");
+			return false;
+		}
 
-		// if we have a rotation then let's apply the rotation matrix.
-		if (rotation == 0.0)
+		SDL_Surface* textSurface = TTF_RenderText_Solid(font, text.c_str(), textColor);
+
+		if (textSurface == NULL)
 		{
-			SDL_RenderDrawLinesF(renderer, points, 4);
-			return;
+			COS_LOG_ERR("There was an error rendering the text surface.{}", TTF_GetError());
+			return false;
 		}
 
-		SDL_FPoint rotatedPoints[4];
+		texture = renderer->CreateTextureFromSurface(textSurface);
 
-		for (int i = 0; i < 3; i++)
+		if (texture == NULL)
 		{
-			rotatedPoints[i].x = (points[i].x * cosf(rotation)) - (points[i].y * sinf(rotation));
-			rotatedPoints[i].y = (points[i].x * sinf(rotation)) + (points[i].y * cosf(rotation));
+			COS_LOG_ERR("There was an error creating the texture{}", SDL_GetError());
+			return false;
 		}
 
-		SDL_RenderDrawLinesF(renderer, rotatedPoints, 4);
-	}
+		width = textSurface->w;
+		height = textSurface->h;
+		TrackTextureMemory();
 
-	FrameRate::FrameRate()
-	{
-		timeStampOfBeginingOfSecond = SDL_GetTicks();
-		currentFramesPerSecond = 0.0;
-		currentSecondsFrameCount = 0;
+		SDL_FreeSurface(textSurface);
+
+		return true;
 	}
 
-	int FrameRate::GetCurrentFramesPerSecond()
+	void Texture::Free()
 	{
-		return currentFramesPerSecond;
+		if (texture != NULL)
+		{
+			renderer->DestroyTexture(texture);
+			MemoryTracker::Get().RemoveExternal(MemoryTag::TEXTURES, trackedTextureBytes);
+			texture = NULL;
+			trackedTextureBytes = 0;
+			width = 0;
+			height = 0;
+		}
 	}
 
-	int FrameRate::OnUpdate() 
+	void Texture::Evict()
 	{
-		Uint32 currentFrameTime = SDL_GetTicks();
+		int evictedWidth = width;
+		int evictedHeight = height;
 
-		if (currentFrameTime - timeStampOfBeginingOfSecond >= 1000.0)
-		{
-			currentSecondsFrameCount++;
-			currentFramesPerSecond = currentSecondsFrameCount;
-			currentSecondsFrameCount = 0;
-			timeStampOfBeginingOfSecond = currentFrameTime;
-			return currentFramesPerSecond;
-		}
+		Free();
 
-		currentSecondsFrameCount++;
-		return 0;
+		width = evictedWidth;
+		height = evictedHeight;
 	}
 
-	Entity::Entity()
+	void Texture::MarkUsed()
 	{
-		x = 0;
-		y = 0;
+		if (renderer != NULL)
+		{
+			lastUsedFrame = renderer->GetFrame();
+		}
 	}
 
-	Entity::Entity(float x, float y)
+	Uint32 Texture::GetLastUsedFrame()
 	{
-		this->x = x;
-		this->y = y;
+		return lastUsedFrame;
 	}
 
-	Sprite::Sprite()
+	Sint64 Texture::GetTextureBytes()
 	{
-		this->width = 0;
-		this->height = 0;
-		this->texture = NULL;
-		this->renderer = NULL;
+		return trackedTextureBytes;
 	}
 
-	Sprite::Sprite(float x, float y, float width, float height, Texture* texture, SDL_Renderer* renderer) : Entity(x, y)
+	void Texture::TrackTextureMemory()
 	{
-		this->width = width;
-		this->height = height;
-		this->texture = texture;
-		this->renderer = renderer;
+		trackedTextureBytes = (Sint64)width * height * 4;
+		MemoryTracker::Get().AddExternal(MemoryTag::TEXTURES, trackedTextureBytes);
 	}
 
-	bool Sprite::OnRender(float deltaTime)
+	void Texture::Render(float x, float y, SDL_Rect* clip, float angle, SDL_FPoint* center, SDL_RendererFlip flip, int alpha)
 	{
-		texture->Render(x, y);
+		MarkUsed();
 
-		return true;
-	}
+		SDL_FRect renderQuad = { x, y, (float) width, (float) height };
 
-	Rectangle::Rectangle()
+		if (clip != NULL)
+		{
+			renderQuad.w = clip->w;
+			renderQuad.h = clip->h;
+		}
+
+		renderer->SetTextureAlphaMod(texture, alpha);
+		renderer->CopyEx(texture, clip, &renderQuad, angle, center, flip);
+	}
+	Renderer* Texture::GetRenderer()
 	{
-		this->width = 0;
-		this->height = 0;
-		this->color = SDL_Color{255, 255, 255, 255};
-		this->renderer = NULL;
+		return renderer;
 	}
 
-	Rectangle::Rectangle(float x, float y, float width, float height, SDL_Color color, SDL_Renderer* renderer) : Entity(x, y)
+	SDL_Texture* Texture::GetSDLTexture()
 	{
-		this->width = width;
-		this->height = height;
-		this->color = color;
-		this->renderer = renderer;
+		return texture;
 	}
 
-	bool Rectangle::OnRender(float deltaTime)
+	void SpriteBatch::Draw(Texture* texture, float x, float y, const SDL_Rect* clip, SDL_Color color, int layer)
 	{
-		SDL_SetRenderDrawColor(renderer, color.r, color.b, color.g, color.a);
-		SDL_FRect rect = { x, y, width, height };
-		SDL_RenderFillRectF(renderer, &rect);
-		return false;
+		if (texture == NULL)
+		{
+			return;
+		}
+
+		// stamped even when there's nothing to draw, an evicted texture is how the asset cache knows to reload it.
+		texture->MarkUsed();
+
+		if (texture->GetSDLTexture() == NULL)
+		{
+			return;
+		}
+
+		BatchedSprite sprite;
+		sprite.texture = texture->GetSDLTexture();
+		sprite.textureWidth = texture->width;
+		sprite.textureHeight = texture->height;
+		sprite.source = clip != NULL ? *clip : SDL_Rect{ 0, 0, texture->width, texture->height };
+		sprite.destination = SDL_FRect{ x, y, (float)sprite.source.w, (float)sprite.source.h };
+		sprite.color = color;
+		sprite.group = -1;
+
+		// there are only ever a handful of textures a frame, a linear search beats anything cleverer.
+		for (int i = 0; i < (int)groups.size(); i++)
+		{
+			if (groups[i].layer == layer && groups[i].texture == sprite.texture)
+			{
+				sprite.group = i;
+				break;
+			}
+		}
+
+		if (sprite.group < 0)
+		{
+			sprite.group = (int)groups.size();
+			groups.push_back(Group{ layer, sprite.texture });
+		}
+
+		sprites.push_back(sprite);
 	}
 
-	Circle::Circle()
+	void SpriteBatch::Flush(Renderer* renderer, const Viewport* viewports, int count)
 	{
-		this->radius = 0;
-		this->color = SDL_Color{ 255, 255, 255, 255 };
-		this->renderer = NULL;
+		Build(viewports, count);
+		Submit(renderer);
 	}
 
-	Circle::Circle(float x, float y, float radius, SDL_Color color, SDL_Renderer* renderer) : Entity(x, y)
-	{
-		this->radius = radius;
-		this->color = color;
-		this->renderer = renderer;
+	void SpriteBatch::Build(const Viewport* viewports, int count)
+	{
+		if (sprites.empty())
+		{
+			groups.clear();
+			return;
+		}
+
+		// layers in order, and each layers textures in the order they first turned up.
+		groupOrder.resize(groups.size());
+
+		for (int i = 0; i < (int)groups.size(); i++)
+		{
+			groupOrder[i] = i;
+		}
+
+		std::stable_sort(groupOrder.begin(), groupOrder.end(), [this](int a, int b) { return groups[a].layer < groups[b].layer; });
+
+		groupRank.resize(groups.size());
+
+		for (int i = 0; i < (int)groupOrder.size(); i++)
+		{
+			groupRank[groupOrder[i]] = i;
+		}
+
+		std::stable_sort(sprites.begin(), sprites.end(), [this](const BatchedSprite& a, const BatchedSprite& b) { return groupRank[a.group] < groupRank[b.group]; });
+
+		size_t runStart = 0;
+
+		while (runStart < sprites.size())
+		{
+			size_t runEnd = runStart;
+
+			while (runEnd < sprites.size() && sprites[runEnd].group == sprites[runStart].group)
+			{
+				runEnd++;
+			}
+
+			SDL_Texture* texture = sprites[runStart].texture;
+			SDL_FRect destination;
+			SDL_FRect source;
+
+			#if SDL_VERSION_ATLEAST(2, 0, 18)
+			int firstIndex = (int)indices.size();
+
+			for (int v = 0; v < count; v++)
+			{
+				for (size_t i = runStart; i < runEnd; i++)
+				{
+					const BatchedSprite& sprite = sprites[i];
+
+					if (!ClipToViewport(sprite, viewports[v], destination, source))
+					{
+						continue;
+					}
+
+					float left = source.x / sprite.textureWidth;
+					float top = source.y / sprite.textureHeight;
+					float right = (source.x + source.w) / sprite.textureWidth;
+					float bottom = (source.y + source.h) / sprite.textureHeight;
+					int base = (int)vertices.size();
+
+					vertices.push_back(SDL_Vertex{ { destination.x, destination.y }, sprite.color, { left, top } });
+					vertices.push_back(SDL_Vertex{ { destination.x + destination.w, destination.y }, sprite.color, { right, top } });
+					vertices.push_back(SDL_Vertex{ { destination.x + destination.w, destination.y + destination.h }, sprite.color, { right, bottom } });
+					vertices.push_back(SDL_Vertex{ { destination.x, destination.y + destination.h }, sprite.color, { left, bottom } });
+
+					for (int corner : { 0, 1, 2, 0, 2, 3 })
+					{
+						indices.push_back(base + corner);
+					}
+				}
+			}
+
+			if ((int)indices.size() > firstIndex)
+			{
+				runs.push_back(BuiltRun{ texture, firstIndex, (int)indices.size() - firstIndex });
+			}
+			#else
+			// without geometry every sprite is its own copy of its whole source, so the texels stay exact. only sprites
+			// hanging over the edge of a viewport need the clip rect.
+			(void)source;
+
+			for (int v = 0; v < count; v++)
+			{
+				const SDL_Rect& area = viewports[v].area;
+
+				for (size_t i = runStart; i < runEnd; i++)
+				{
+					const BatchedSprite& sprite = sprites[i];
+					SDL_FPoint topLeft = viewports[v].WorldToScreen(sprite.destination.x, sprite.destination.y);
+					destination = SDL_FRect{ topLeft.x, topLeft.y, sprite.destination.w * viewports[v].camera.zoom, sprite.destination.h * viewports[v].camera.zoom };
+
+					if (destination.x >= area.x + area.w || destination.y >= area.y + area.h || destination.x + destination.w <= area.x || destination.y + destination.h <= area.y)
+					{
+						continue;
+					}
+
+					bool inside = destination.x >= area.x && destination.y >= area.y && destination.x + destination.w <= area.x + area.w && destination.y + destination.h <= area.y + area.h;
+					copies.push_back(BuiltCopy{ texture, sprite.source, destination, sprite.color, area, !inside });
+				}
+			}
+			#endif
+
+			runStart = runEnd;
+		}
+
+		sprites.clear();
+		groups.clear();
 	}
 
-	bool Circle::OnRender(float deltaTime)
+	void SpriteBatch::Submit(Renderer* renderer)
 	{
-		SDL_SetRenderDrawColor(renderer, color.r, color.b, color.g, color.a);
-		for (int w = 0; w < radius * 2; w++)
+		submissions = 0;
+
+		#if SDL_VERSION_ATLEAST(2, 0, 18)
+		for (const BuiltRun& run : runs)
 		{
-			for (int h = 0; h < radius * 2; h++)
+			// vertex colors take over from the mods, which Texture::Render may have left set.
+			renderer->SetTextureColorMod(run.texture, 255, 255, 255);
+			renderer->SetTextureAlphaMod(run.texture, 255);
+			renderer->Geometry(run.texture, vertices.data(), (int)vertices.size(), indices.data() + run.firstIndex, run.indexCount);
+			submissions++;
+		}
+
+		runs.clear();
+		vertices.clear();
+		indices.clear();
+		#else
+		// the clip rect only changes between a sprite inside a viewport and one over an edge, or between viewports.
+		bool clipping = false;
+		SDL_Rect clippedTo = SDL_Rect{ 0, 0, 0, 0 };
+
+		for (const BuiltCopy& copy : copies)
+		{
+			if (copy.clipped && (!clipping || !SDL_RectEquals(&clippedTo, &copy.clip)))
 			{
-				int dx = radius - w; // horizontal offset
-				int dy = radius - h; // vertical offset
-				if ((dx * dx + dy * dy) <= (radius * radius))
-				{
-					SDL_RenderDrawPoint(renderer, x + dx, y + dy);
-				}
+				renderer->SetClipRect(&copy.clip);
+				clippedTo = copy.clip;
+				clipping = true;
+			}
+			else if (!copy.clipped && clipping && !SDL_RectEquals(&clippedTo, &copy.clip))
+			{
+				renderer->SetClipRect(NULL);
+				clipping = false;
 			}
+
+			renderer->SetTextureColorMod(copy.texture, copy.color.r, copy.color.g, copy.color.b);
+			renderer->SetTextureAlphaMod(copy.texture, copy.color.a);
+			renderer->CopyEx(copy.texture, &copy.source, &copy.destination, 0, NULL, SDL_FLIP_NONE);
+			submissions++;
 		}
-		return false;
-	}
 
-	Entity::~Entity()
-	{
+		if (clipping)
+		{
+			renderer->SetClipRect(NULL);
+		}
+
+		copies.clear();
+		#endif
 	}
 
-	bool Entity::OnUpdate(float deltaTime)
+	Uint32 SpriteBatch::GetSubmissionCount()
 	{
-		return true;
+		return submissions;
 	}
 
-	bool Entity::OnRender(float deltaTime)
+	bool SpriteBatch::ClipToViewport(const BatchedSprite& sprite, const Viewport& viewport, SDL_FRect& destination, SDL_FRect& source)
 	{
+		SDL_FPoint topLeft = viewport.WorldToScreen(sprite.destination.x, sprite.destination.y);
+		float width = sprite.destination.w * viewport.camera.zoom;
+		float height = sprite.destination.h * viewport.camera.zoom;
+
+		float left = SDL_max(topLeft.x, (float)viewport.area.x);
+		float top = SDL_max(topLeft.y, (float)viewport.area.y);
+		float right = SDL_min(topLeft.x + width, (float)(viewport.area.x + viewport.area.w));
+		float bottom = SDL_min(topLeft.y + height, (float)(viewport.area.y + viewport.area.h));
+
+		if (left >= right || top >= bottom)
+		{
+			return false;
+		}
+
+		// trim the texture by the same fraction as the quad.
+		float texelsPerPixelX = sprite.source.w / width;
+		float texelsPerPixelY = sprite.source.h / height;
+
+		destination = SDL_FRect{ left, top, right - left, bottom - top };
+		source = SDL_FRect{ sprite.source.x + (left - topLeft.x) * texelsPerPixelX, sprite.source.y + (top - topLeft.y) * texelsPerPixelY,
+			(right - left) * texelsPerPixelX, (bottom - top) * texelsPerPixelY };
+
 		return true;
 	}
 
-	SoundEffect::SoundEffect()
+	SdfFont::SdfFont(Renderer* renderer)
 	{
-		mixChunk = NULL;
+		this->renderer = renderer;
+		this->bakeSize = 0;
+		this->lineHeight = 0;
+		this->atlasHeight = 0;
+		this->trackedTextureBytes = 0;
+		this->trackedFontBytes = 0;
+
+		for (int i = 0; i < SCALE_COUNT; i++)
+		{
+			atlases[i] = NULL;
+		}
 	}
 
-	SoundEffect::~SoundEffect()
+	SdfFont::~SdfFont()
 	{
 		Free();
 	}
 
-	bool SoundEffect::LoadSoundFromFile(const char* filepath)
+	bool SdfFont::LoadFromFile(const char* filepath, int bakeSize)
 	{
-		mixChunk = Mix_LoadWAV(filepath);
-		if (mixChunk == NULL)
+		FileBatch batch;
+		batch.AddRead(filepath);
+
+		if (!FileIO::Get().Run(batch))
 		{
-			printf("Failed to load scratch sound effect! SDL_mixer Error: %s\n", Mix_GetError());
+			COS_LOG_ERR("Could not read the font: {}", filepath);
 			return false;
 		}
 
-		return true;
+		return LoadFromMemory(batch.requests[0].data, bakeSize);
 	}
 
-	void SoundEffect::Free()
+	bool SdfFont::LoadFromMemory(const std::vector<Uint8>& data, int bakeSize)
 	{
-		if (mixChunk != NULL) 
+		Free();
+
+		TTF_Font* font = TTF_OpenFontRW(SDL_RWFromConstMem(data.data(), (int)data.size()), 1, bakeSize);
+
+		if (font == NULL)
 		{
-			Mix_FreeChunk(mixChunk);
+			COS_LOG_ERR("Could not load the font{}", TTF_GetError());
+			return false;
 		}
 
-		mixChunk = NULL;		
-	}
+		this->bakeSize = bakeSize;
+		lineHeight = TTF_FontHeight(font);
 
-	bool SoundEffect::PlaySound()
-	{
-		if (mixChunk == NULL) 
+		// rasterize every glyph once, keeping only the alpha.
+		std::vector<SDL_Surface*> surfaces;
+
+		for (int character = FIRST_GLYPH; character <= LAST_GLYPH; character++)
 		{
-			return false;
+			Glyph& glyph = glyphs[character - FIRST_GLYPH];
+			glyph.atlas = SDL_Rect{ 0, 0, 0, 0 };
+			glyph.advance = 0;
+
+			int minX, maxX, minY, maxY;
+			SDL_Surface* surface = NULL;
+
+			if (TTF_GlyphMetrics(font, (Uint16)character, &minX, &maxX, &minY, &maxY, &glyph.advance) == 0)
+			{
+				SDL_Surface* rendered = TTF_RenderGlyph_Blended(font, (Uint16)character, COLOR_WHITE);
+
+				if (rendered != NULL)
+				{
+					surface = SDL_ConvertSurfaceFormat(rendered, SDL_PIXELFORMAT_ARGB8888, 0);
+					SDL_FreeSurface(rendered);
+				}
+			}
+
+			surfaces.push_back(surface);
 		}
 
-		Mix_PlayChannel(-1, mixChunk, 0);
-	}
+		TTF_CloseFont(font);
 
-	Texture::Texture()
-	{
-		this->texture = NULL;
-		this->renderer = NULL;
-		this->width = 0;
-		this->height = 0;
-		this->font = NULL;
+		// shelf pack, tallest first so the shelves waste less.
+		std::vector<int> order;
+
+		for (int i = 0; i < (int)surfaces.size(); i++)
+		{
+			if (surfaces[i] != NULL)
+			{
+				order.push_back(i);
+			}
+		}
+
+		std::sort(order.begin(), order.end(), [&surfaces](int a, int b) { return surfaces[a]->h > surfaces[b]->h; });
+
+		int shelfX = 0;
+		int shelfY = 0;
+		int shelfHeight = 0;
+
+		for (int i : order)
+		{
+			int width = surfaces[i]->w + SPREAD * 2;
+			int height = surfaces[i]->h + SPREAD * 2;
+
+			if (shelfX + width > ATLAS_WIDTH)
+			{
+				shelfX = 0;
+				shelfY += shelfHeight;
+				shelfHeight = 0;
+			}
+
+			glyphs[i].atlas = SDL_Rect{ shelfX, shelfY, width, height };
+			shelfX += width;
+			shelfHeight = SDL_max(shelfHeight, height);
+		}
+
+		atlasHeight = 1;
+
+		while (atlasHeight < shelfY + shelfHeight)
+		{
+			atlasHeight *= 2;
+		}
+
+		// everything outside a glyph is as far out as the field goes.
+		distances.assign((size_t)ATLAS_WIDTH * atlasHeight, 0);
+		std::vector<Uint8> coverage;
+
+		for (int i : order)
+		{
+			SDL_Surface* surface = surfaces[i];
+			coverage.resize((size_t)surface->w * surface->h);
+			SDL_LockSurface(surface);
+
+			for (int y = 0; y < surface->h; y++)
+			{
+				const Uint32* row = (const Uint32*)((const Uint8*)surface->pixels + y * surface->pitch);
+
+				for (int x = 0; x < surface->w; x++)
+				{
+					coverage[y * surface->w + x] = (Uint8)(row[x] >> 24);
+				}
+			}
+
+			SDL_UnlockSurface(surface);
+
+			const SDL_Rect& atlas = glyphs[i].atlas;
+			BuildDistanceField(coverage.data(), surface->w, surface->w, surface->h, &distances[atlas.y * ATLAS_WIDTH + atlas.x], ATLAS_WIDTH);
+		}
+
+		for (SDL_Surface* surface : surfaces)
+		{
+			if (surface != NULL)
+			{
+				SDL_FreeSurface(surface);
+			}
+		}
+
+		trackedFontBytes = (Sint64)distances.size();
+		MemoryTracker::Get().AddExternal(MemoryTag::FONTS, trackedFontBytes);
+
+		return true;
 	}
 
-	Texture::Texture(SDL_Renderer* renderer, const char* fontFilePath, int fontSize)
+	void SdfFont::BuildDistanceField(const Uint8* coverage, int coveragePitch, int width, int height, Uint8* distances, int distancesPitch)
 	{
-		this->texture = NULL;
-		this->width = 0;
-		this->height = 0;
-		this->renderer = renderer;
-		this->fontSize = fontSize;
-		this->font = NULL;
+		// brute force over a window the size of the spread. it only runs once per glyph at load, so simple wins.
+		auto isInside = [&](int x, int y)
+		{
+			return x >= 0 && y >= 0 && x < width && y < height && coverage[y * coveragePitch + x] >= 128;
+		};
 
-		if (fontFilePath != NULL) 
+		for (int y = 0; y < height + SPREAD * 2; y++)
 		{
-			font = TTF_OpenFont(fontFilePath, fontSize);
-			if (font == NULL)
+			for (int x = 0; x < width + SPREAD * 2; x++)
 			{
-				std::cout << "Could not load the font" << TTF_GetError() << std::endl;
+				int sourceX = x - SPREAD;
+				int sourceY = y - SPREAD;
+				bool inside = isInside(sourceX, sourceY);
+				int nearest = (SPREAD + 1) * (SPREAD + 1);
+
+				for (int offsetY = -SPREAD; offsetY <= SPREAD; offsetY++)
+				{
+					for (int offsetX = -SPREAD; offsetX <= SPREAD; offsetX++)
+					{
+						int squared = offsetX * offsetX + offsetY * offsetY;
+
+						if (squared < nearest && isInside(sourceX + offsetX, sourceY + offsetY) != inside)
+						{
+							nearest = squared;
+						}
+					}
+				}
+
+				// the edge lies roughly halfway between a texel and its nearest opposite. a partly covered texel has the
+				// edge running through it, and its coverage says where exactly, which is where the threshold lands.
+				float distance = SDL_min((float)SDL_sqrt((double)nearest), (float)SPREAD + 0.5f) - 0.5f;
+				bool inBounds = sourceX >= 0 && sourceY >= 0 && sourceX < width && sourceY < height;
+				int covered = inBounds ? coverage[sourceY * coveragePitch + sourceX] : 0;
+
+				if (nearest == 1 && covered > 0 && covered < 255)
+				{
+					distance = SDL_fabs(covered - 127.5f) / 255.0f;
+				}
+
+				float value = 128.0f + (inside ? distance : -distance) * (127.0f / SPREAD);
+				distances[y * distancesPitch + x] = (Uint8)SDL_max(0.0f, SDL_min(255.0f, value + 0.5f));
 			}
 		}
 	}
 
-	Texture::~Texture()
+	void SdfFont::Free()
 	{
-		Free();
-
-		if (font != NULL) 
+		for (int i = 0; i < SCALE_COUNT; i++)
 		{
-			TTF_CloseFont(font);
+			if (atlases[i] != NULL)
+			{
+				renderer->DestroyTexture(atlases[i]);
+				atlases[i] = NULL;
+			}
 		}
+
+		MemoryTracker::Get().RemoveExternal(MemoryTag::TEXTURES, trackedTextureBytes);
+		MemoryTracker::Get().RemoveExternal(MemoryTag::FONTS, trackedFontBytes);
+		trackedTextureBytes = 0;
+		trackedFontBytes = 0;
+		std::vector<Uint8>().swap(distances);
+		bakeSize = 0;
 	}
 
-	bool Texture::LoadTextureFromFile(const char* filepath)
+	SDL_Texture* SdfFont::GetAtlas(float scale)
 	{
-		Free();
+		// nearest power of two, rounding at the geometric midpoints.
+		int power = 0;
+		float bucketScale = 1;
 
-		texture = IMG_LoadTexture(renderer, filepath);
+		while (power < MAX_SCALE_POWER && scale > bucketScale * 1.41421f)
+		{
+			power++;
+			bucketScale *= 2;
+		}
 
-		if (texture == NULL)
+		while (power > MIN_SCALE_POWER && scale < bucketScale / 1.41421f)
 		{
-			std::cout << "Could not load the texture from: " << filepath << " Error:" << SDL_GetError() << std::endl;
-			return false;
+			power--;
+			bucketScale /= 2;
 		}
 
-		SDL_QueryTexture(texture, NULL, NULL, &width, &height);
+		SDL_Texture*& atlas = atlases[power - MIN_SCALE_POWER];
 
-		return true;
+		if (atlas != NULL)
+		{
+			return atlas;
+		}
+
+		// the alpha ramps from 0 to 1 over one screen pixel at this scale, which is what a shader would have done.
+		float rampScale = bucketScale * SPREAD / 127.0f;
+		std::vector<Uint32> pixels(distances.size());
+
+		for (size_t i = 0; i < distances.size(); i++)
+		{
+			float alpha = 0.5f + (distances[i] - 128.0f) * rampScale;
+			pixels[i] = ((Uint32)(SDL_max(0.0f, SDL_min(1.0f, alpha)) * 255.0f + 0.5f) << 24) | 0x00FFFFFF;
+		}
+
+		atlas = renderer->CreateTexture(SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_STATIC, ATLAS_WIDTH, atlasHeight);
+
+		if (atlas == NULL)
+		{
+			COS_LOG_ERR("Could not create the font atlas: {}", SDL_GetError());
+			return NULL;
+		}
+
+		renderer->UpdateTexture(atlas, NULL, pixels.data(), ATLAS_WIDTH * 4);
+		renderer->SetTextureBlendMode(atlas, SDL_BLENDMODE_BLEND);
+		renderer->SetTextureScaleMode(atlas, SDL_ScaleModeLinear);
+
+		Sint64 bytes = (Sint64)pixels.size() * 4;
+		trackedTextureBytes += bytes;
+		MemoryTracker::Get().AddExternal(MemoryTag::TEXTURES, bytes);
+
+		return atlas;
 	}
 
-	inline bool Texture::LoadFromRenderedText(std::string text, SDL_Color textColor)
+	void SdfFont::Render(const std::string& text, float x, float y, float size, SDL_Color color)
 	{
-		Free();
-
-		if (font == NULL)
+		if (bakeSize == 0)
 		{
-			std::cout << "No font associated with this texture! Make sure you construct it with one." << std::endl;
-			return false;
+			return;
 		}
 
-		SDL_Surface* textSurface = TTF_RenderText_Solid(font, text.c_str(), textColor);
+		float scale = size / bakeSize;
+		SDL_Texture* atlas = GetAtlas(scale);
 
-		if (textSurface == NULL)
+		if (atlas == NULL)
 		{
-			std::cout << "There was an error rendering the text surface." << TTF_GetError() << std::endl;
-			return false;
+			return;
 		}
 
-		texture = SDL_CreateTextureFromSurface(renderer, textSurface);
+		// glyphs are packed with a border of field around them, so they're drawn that much up and to the left.
+		float penX = x - SPREAD * scale;
+		float penY = y - SPREAD * scale;
 
-		if (texture == NULL)
+		#if SDL_VERSION_ATLEAST(2, 0, 18)
+		vertices.clear();
+		indices.clear();
+
+		for (char character : text)
 		{
-			std::cout << "There was an error creating the texture" << SDL_GetError() << std::endl;
-			return false;
+			if (character < FIRST_GLYPH || character > LAST_GLYPH)
+			{
+				continue;
+			}
+
+			const Glyph& glyph = glyphs[character - FIRST_GLYPH];
+
+			if (glyph.atlas.w > 0)
+			{
+				float left = (float)glyph.atlas.x / ATLAS_WIDTH;
+				float top = (float)glyph.atlas.y / atlasHeight;
+				float right = (float)(glyph.atlas.x + glyph.atlas.w) / ATLAS_WIDTH;
+				float bottom = (float)(glyph.atlas.y + glyph.atlas.h) / atlasHeight;
+				float width = glyph.atlas.w * scale;
+				float height = glyph.atlas.h * scale;
+				int base = (int)vertices.size();
+
+				vertices.push_back(SDL_Vertex{ { penX, penY }, color, { left, top } });
+				vertices.push_back(SDL_Vertex{ { penX + width, penY }, color, { right, top } });
+				vertices.push_back(SDL_Vertex{ { penX + width, penY + height }, color, { right, bottom } });
+				vertices.push_back(SDL_Vertex{ { penX, penY + height }, color, { left, bottom } });
+
+				for (int corner : { 0, 1, 2, 0, 2, 3 })
+				{
+					indices.push_back(base + corner);
+				}
+			}
+
+			penX += glyph.advance * scale;
 		}
 
-		width = textSurface->w;
-		height = textSurface->h;
+		if (!indices.empty())
+		{
+			renderer->Geometry(atlas, vertices.data(), (int)vertices.size(), indices.data(), (int)indices.size());
+		}
+		#else
+		renderer->SetTextureColorMod(atlas, color.r, color.g, color.b);
+		renderer->SetTextureAlphaMod(atlas, color.a);
 
-		SDL_FreeSurface(textSurface);
+		for (char character : text)
+		{
+			if (character < FIRST_GLYPH || character > LAST_GLYPH)
+			{
+				continue;
+			}
 
-		return true;
+			const Glyph& glyph = glyphs[character - FIRST_GLYPH];
+
+			if (glyph.atlas.w > 0)
+			{
+				SDL_FRect destination = { penX, penY, glyph.atlas.w * scale, glyph.atlas.h * scale };
+				renderer->CopyEx(atlas, &glyph.atlas, &destination, 0, NULL, SDL_FLIP_NONE);
+			}
+
+			penX += glyph.advance * scale;
+		}
+		#endif
 	}
 
-	void Texture::Free()
+	float SdfFont::GetWidth(const std::string& text, float size)
 	{
-		if (texture != NULL)
+		if (bakeSize == 0)
 		{
-			SDL_DestroyTexture(texture);
-			texture = NULL;
-			width = 0;
-			height = 0;
+			return 0;
 		}
-	}
 
-	void Texture::Render(float x, float y, SDL_Rect* clip, float angle, SDL_FPoint* center, SDL_RendererFlip flip, int alpha)
-	{
-		SDL_FRect renderQuad = { x, y, (float) width, (float) height };
+		int advance = 0;
 
-		if (clip != NULL)
+		for (char character : text)
 		{
-			renderQuad.w = clip->w;
-			renderQuad.h = clip->h;
+			if (character >= FIRST_GLYPH && character <= LAST_GLYPH)
+			{
+				advance += glyphs[character - FIRST_GLYPH].advance;
+			}
 		}
 
-		SDL_SetTextureAlphaMod(texture, alpha);
-		SDL_RenderCopyExF(renderer, texture, clip, &renderQuad, angle, center, flip);
+		return advance * size / bakeSize;
 	}
-	SDL_Renderer* Texture::GetRenderer()
+
+	float SdfFont::GetHeight(float size)
 	{
-		return renderer;
+		return bakeSize == 0 ? 0 : lineHeight * size / bakeSize;
 	}
 
 	ParticleEmitter::ParticleEmitter()
@@ -927,11 +10221,12 @@ namespace CrispyOctoSpork
 		this->active = false;
 		this->maxParticles = 0;
 		this->particlePool = NULL;
+		this->activeParticleCap = 0;
 	}
 
 	ParticleEmitter::~ParticleEmitter()
 	{
-		delete[] this->particlePool;
+		MemoryTracker::Get().Free(this->particlePool);
 	}
 
 	ParticleEmitter::ParticleEmitter(float x, float y, float lifeInMiliseconds, Texture* texture, float speed, int newParticlesPerSecond, float startSizeMultiplier, float endSizeMultiplier, int maxParticles)
@@ -949,7 +10244,37 @@ namespace CrispyOctoSpork
 		this->startOfSecond = SDL_GetTicks();
 		this->particlesCreatedThisSecond = 0;
 		this->active = true;
-		this->particlePool = new Particle[maxParticles];
+		this->particlePool = (Particle*)MemoryTracker::Get().Allocate(sizeof(Particle) * maxParticles, MemoryTag::PARTICLES);
+
+		// without a pool the emitter stays inactive and empty, check active to see if creation worked.
+		if (this->particlePool == NULL)
+		{
+			COS_LOG_ERR("Could not allocate a pool of {} particles.", maxParticles);
+			this->active = false;
+			this->maxParticles = 0;
+			this->activeParticleCap = 0;
+			return;
+		}
+
+		for (int i = 0; i < maxParticles; i++)
+		{
+			new (&this->particlePool[i]) Particle();
+		}
+
+		this->activeParticleCap = maxParticles;
+	}
+
+	void ParticleEmitter::SetQuality(float spawnRateScale, float capScale)
+	{
+		if (spawnRateScale != this->spawnRateScale)
+		{
+			// restart the spawn accounting so a higher rate doesn't burst out the particles it "missed".
+			this->startOfSecond = SDL_GetTicks();
+			this->particlesCreatedThisSecond = 0;
+		}
+
+		this->spawnRateScale = spawnRateScale;
+		this->activeParticleCap = (int)(maxParticles * capScale);
 	}
 
 	void ParticleEmitter::OnUpdate(float deltaTime)
@@ -959,19 +10284,43 @@ namespace CrispyOctoSpork
 			return;
 		}
 
+		Simulate(deltaTime);
+		OnRender();
+	}
+
+	void ParticleEmitter::Simulate(float deltaTime)
+	{
+		if (!active)
+		{
+			return;
+		}
+
 		// first get the amount of time since the begining of the second
 		// and determine if we've created enough particles at this point yet.
 		float currentTime = SDL_GetTicks();
 
 		float elapsedTimeInSecond = currentTime - startOfSecond;
-		int particlesThatShouldHaveBeenCreatedThisSecond = (elapsedTimeInSecond * newParticlesPerSecond) / 1000;
+		int particlesThatShouldHaveBeenCreatedThisSecond = (elapsedTimeInSecond * newParticlesPerSecond * spawnRateScale) / 1000;
 
 		if (particlesThatShouldHaveBeenCreatedThisSecond > particlesCreatedThisSecond)
 		{
 			int particlesToCreate = particlesThatShouldHaveBeenCreatedThisSecond - particlesCreatedThisSecond;
 			for (int i = 0; i < particlesToCreate; i++)
 			{
+				if (activeParticles >= activeParticleCap)
+				{
+					// still count it as created so we don't build up a backlog while capped.
+					particlesCreatedThisSecond++;
+					continue;
+				}
+
 				Particle* particle = &particlePool[currentParticlePoolIndex];
+
+				if (!particle->active)
+				{
+					activeParticles++;
+				}
+
 				particle->active = true;
 				particle->lifeTimeRemaining = lifeInMiliseconds;
 				particle->totalLifeTime = lifeInMiliseconds;
@@ -1002,6 +10351,7 @@ namespace CrispyOctoSpork
 				if (particle->lifeTimeRemaining <= 0.0)
 				{
 					particle->active = false;
+					activeParticles--;
 					continue;
 				}
 
@@ -1009,8 +10359,6 @@ namespace CrispyOctoSpork
 				particle->y += particle->yVelocity * speed * deltaTime;
 			}
 		}
-
-		OnRender();
 	}
 	void ParticleEmitter::OnRender()
 	{
@@ -1,5 +1,13 @@
 #include "crispyOctoSporkEngine.h"
+#include "snakeSimulation.h"
+#include "snakeBodyRenderer.h"
+#include "snakeBoardTexture.h"
+#include "snakeMinimap.h"
+#include "snakeDiffTest.h"
+#include "snakeServer.h"
+#include "snakeSwarm.h"
 #include <vector>
+#include <csignal>
 using namespace CrispyOctoSpork;
 
 enum class GameState
@@ -11,33 +19,52 @@ enum class GameState
 };
 
 /// <summary>
-/// Struct for the apple that the snake wants.
+/// The games telemetry events, recorded from the playing scene.
 /// </summary>
-struct Apple
+enum class SnakeTelemetry : Uint32
 {
-	float x = 0;
-	float y = 0;
-	Texture* texture = NULL;
+	// seed
+	GAME_START = (Uint32)TelemetryEventType::GAME,
+	// score, tick, length, head cell
+	APPLE_EATEN,
+	// direction, tick
+	DIRECTION_CHANGE,
+	// cause, score, tick, length, direction changes
+	DEATH
+};
+
+/// <summary>
+/// Why the snake died, for <see cref="SnakeTelemetry::DEATH"/>.
+/// </summary>
+enum class SnakeDeathCause
+{
+	HIT_ITSELF,
+	BOARD_FULL
 };
 
 /// <summary>
-/// Struct for a peice of the snakes tail.
+/// Every image the game loads. Used by --bake-assets to build the raw copies the engine loads instead.
+/// </summary>
+const char* TEXTURE_ASSETS[] = { "assets/snake.png", "assets/apple.png", "assets/menu.png", "assets/lose.png" };
+
+/// <summary>
+/// How many frames --frame-trace records, about five seconds at 60 FPS.
+/// </summary>
+const Uint32 FRAME_TRACE_FRAMES = 300;
+
+/// <summary>
+/// Struct for the apple that the snake wants.
 /// </summary>
-struct Tail
+struct Apple
 {
-	float x = 0;
-	float y = 0;
+	Texture* texture = NULL;
 };
 
 /// <summary>
-/// Struct for the snakey boi itself.
+/// Struct for the snakey boi itself. Where it is lives in the simulation.
 /// </summary>
 struct Snake
 {
-	float xVelocity = 0;
-	float yVelocity = 0;
-	std::vector<Tail> tail;
-	int tailLength = 0;
 	Texture* texture = NULL;
 };
 
@@ -46,7 +73,8 @@ struct Snake
 /// </summary>
 struct Score
 {
-	Texture* texture = NULL;
+	SdfFont* font = NULL;
+	std::string text;
 	int score = 0;
 };
 
@@ -58,99 +86,386 @@ class SnakeGame : public Engine
 public:
 	const int WIDTH = 640;
 	const int HEIGHT = 480;
+
+	/// <summary>
+	/// Draws the board from a single streaming texture instead of a sprite or bead per cell. Has to be set before Start.
+	/// </summary>
+	/// <param name="enabled">Whether to use the board texture.</param>
+	void SetBoardTexture(bool enabled)
+	{
+		useBoardTexture = enabled;
+	}
+
+	/// <summary>
+	/// Shows an overview of the board in the top right corner while playing. Has to be set before Start.
+	/// </summary>
+	/// <param name="enabled">Whether to show the minimap.</param>
+	void SetMinimap(bool enabled)
+	{
+		useMinimap = enabled;
+	}
+
 private:
 	const float GRID_SIZE = 32.0;
-	const int GRID_WIDTH = WIDTH / GRID_SIZE;
-	const int GRID_HEIGHT = HEIGHT / GRID_SIZE;
-	GameState state = GameState::MENU;
+	static const int MINIMAP_WIDTH = 80;
+	static const int MINIMAP_HEIGHT = 60;
 
 	float movesPerSecond = 10.0;
 	int movesPerformedThisSecond = 0;
 	float secondAccumulator = 0;
+	Uint32 pendingInputId = 0;
+	bool dying = false;
+	bool scoreVisible = true;
+	Uint32 loseSequence = 0;
+	Uint32 ticksPlayed = 0;
+	Uint32 directionChanges = 0;
+	bool useBoardTexture = false;
+	bool useMinimap = false;
 
 	Snake* snake = NULL;
 	Apple* apple = NULL;
 	Score* score = NULL;
-	Texture* menu = NULL;
-	Texture* lose = NULL;
+	SnakeSimulation simulation;
 
-	SoundEffect* nice = NULL;
+	#ifdef SNAKE_BODY_GEOMETRY
+	SnakeBodyRenderer body = SnakeBodyRenderer(GRID_SIZE);
+	#endif
 
-	bool OnCreate() override
+	SnakeBoardTexture board = SnakeBoardTexture(GRID_SIZE);
+	SnakeMinimap minimap;
+
+	/// <summary>
+	/// The title screen. Space starts a game.
+	/// </summary>
+	class MenuScene : public Scene
 	{
-		snake = new Snake();
-		apple = new Apple();
-		score = new Score();
+	public:
+		MenuScene(SnakeGame* game) : game(game) {}
 
-		snake->texture = new Texture(renderer);
-		apple->texture = new Texture(renderer);
-		score->texture = new Texture(renderer, "assets/coder-crux.ttf", 28);
-		menu = new Texture(renderer);
-		lose = new Texture(renderer);
+		void DeclareAssets(SceneAssets& assets) override
+		{
+			assets.AddTexture("assets/menu.png");
+		}
 
-		snake->texture->LoadTextureFromFile("assets/snake.png");
-		apple->texture->LoadTextureFromFile("assets/apple.png");
-		menu->LoadTextureFromFile("assets/menu.png");
-		lose->LoadTextureFromFile("assets/lose.png");
+		void OnEnter() override
+		{
+			background = game->GetAssets().GetTexture("assets/menu.png");
+		}
 
-		nice = new SoundEffect();
+		bool OnEvent(SDL_Event event) override
+		{
+			if (SDL_GetKeyboardState(NULL)[SDL_SCANCODE_SPACE])
+			{
+				game->ChangeScene((int)GameState::PLAYING);
+			}
 
-		nice->LoadSoundFromFile("assets/nice.wav");
+			return true;
+		}
 
-		return true;
-	}
+		bool OnRender(float deltaTime) override
+		{
+			background->Render(0, 0);
 
-	bool InitPlayingState()
+			return true;
+		}
+
+	private:
+		SnakeGame* game;
+		Texture* background = NULL;
+	};
+
+	/// <summary>
+	/// The game itself.
+	/// </summary>
+	class PlayingScene : public Scene
 	{
-		float startingX = 8.0;
-		float startingY = 8.0;
-		snake->xVelocity = 1.0;
-		snake->yVelocity = 0;
-		snake->tailLength = 6;
-		snake->tail.clear();
+	public:
+		PlayingScene(SnakeGame* game) : game(game) {}
 
-		for (int i = 0; i < snake->tailLength; i++)
+		void DeclareAssets(SceneAssets& assets) override
 		{
-			snake->tail.push_back({ startingX + (-snake->xVelocity * i), startingY });
+			assets.AddTexture("assets/snake.png");
+			assets.AddTexture("assets/apple.png");
+			assets.AddSound("assets/nice.wav");
 		}
 
-		apple->x = rand() % GRID_WIDTH;
-		apple->y = rand() % GRID_HEIGHT;
+		void OnEnter() override
+		{
+			game->snake->texture = game->GetAssets().GetTexture("assets/snake.png");
+			game->apple->texture = game->GetAssets().GetTexture("assets/apple.png");
+			nice = game->GetAssets().GetSound("assets/nice.wav");
+			game->InitPlayingState();
+		}
 
-		score->score = 0;
-		score->texture->LoadFromRenderedText("Score: " + std::to_string(score->score), COLOR_WHITE);
+		void OnExit() override
+		{
+			#ifdef CRISPY_OCTO_SPORK_COROUTINES
+			game->StopCoroutine(game->loseSequence);
+			#endif
+		}
+
+		bool OnEvent(SDL_Event event) override
+		{
+			if (event.type == SDL_KEYDOWN && !event.key.repeat && event.key.keysym.scancode == SDL_SCANCODE_P && !game->dying)
+			{
+				game->PushScene((int)GameState::PAUSE);
+				return true;
+			}
+
+			game->OnEventPlaying(SDL_GetKeyboardState(NULL));
+
+			return true;
+		}
+
+		bool OnUpdate(float deltaTime) override
+		{
+			return game->OnUpdatePlaying(deltaTime);
+		}
+
+		void OnQueueSprites(SpriteBatch& sprites) override
+		{
+			if (game->useBoardTexture)
+			{
+				return;
+			}
+
+			SnakeSimulation& simulation = game->simulation;
+			int appleCell = simulation.GetAppleCell();
+			sprites.Draw(game->apple->texture, (appleCell % SnakeSimulation::GRID_WIDTH) * game->GRID_SIZE, (appleCell / SnakeSimulation::GRID_WIDTH) * game->GRID_SIZE);
+
+			#ifndef SNAKE_BODY_GEOMETRY
+			for (int i = 0; i < simulation.GetLength(); i++)
+			{
+				int cell = simulation.GetSegment(i);
+				sprites.Draw(game->snake->texture, (cell % SnakeSimulation::GRID_WIDTH) * game->GRID_SIZE, (cell / SnakeSimulation::GRID_WIDTH) * game->GRID_SIZE);
+			}
+			#endif
+		}
+
+		bool OnRender(float deltaTime) override
+		{
+			// the apple and, without the geometry path, the body were queued in OnQueueSprites and are already drawn.
+			if (game->useBoardTexture)
+			{
+				game->ForEachViewport([this](const Viewport& viewport) { game->board.Render(viewport); });
+			}
+			#ifdef SNAKE_BODY_GEOMETRY
+			else
+			{
+				game->ForEachViewport([this](const Viewport& viewport) { game->body.Render(game->renderer, viewport); });
+			}
+			#endif
+
+			RenderHud();
+			return true;
+		}
+
+	private:
+		SnakeGame* game;
+		SoundEffect* nice = NULL;
+
+		void RenderHud()
+		{
+			if (game->useMinimap)
+			{
+				game->minimap.Render(game->WIDTH - MINIMAP_WIDTH - 10, 10);
+			}
+
+			if (game->scoreVisible)
+			{
+				game->score->font->Render(game->score->text, 10, 10, 28, COLOR_WHITE);
+			}
+		}
+	};
+
+	/// <summary>
+	/// Shown over the game while it's paused. P resumes, escape quits to the menu.
+	/// </summary>
+	class PauseScene : public Scene
+	{
+	public:
+		PauseScene(SnakeGame* game) : game(game) {}
+
+		~PauseScene()
+		{
+			delete text;
+		}
+
+		void OnEnter() override
+		{
+			if (text == NULL)
+			{
+				text = new Texture(game->renderer, "assets/coder-crux.ttf", 28);
+				text->LoadFromRenderedText("Paused", COLOR_WHITE);
+			}
+		}
+
+		bool OnEvent(SDL_Event event) override
+		{
+			if (event.type == SDL_KEYDOWN && !event.key.repeat && event.key.keysym.scancode == SDL_SCANCODE_P)
+			{
+				game->PopScene();
+			}
+			else if (SDL_GetKeyboardState(NULL)[SDL_SCANCODE_ESCAPE])
+			{
+				game->ChangeScene((int)GameState::MENU);
+			}
+
+			return true;
+		}
+
+		bool OnRender(float deltaTime) override
+		{
+			// dim the board underneath.
+			SDL_Rect screen = { 0, 0, game->WIDTH, game->HEIGHT };
+			game->renderer->SetDrawBlendMode(SDL_BLENDMODE_BLEND);
+			game->renderer->SetDrawColor(0, 0, 0, 160);
+			game->renderer->FillRect(&screen);
+			game->renderer->SetDrawBlendMode(SDL_BLENDMODE_NONE);
+
+			text->Render(game->WIDTH / 2 - text->width / 2, game->HEIGHT / 2 - text->height / 2);
+
+			return true;
+		}
+
+		bool IsOverlay() override
+		{
+			return true;
+		}
+
+	private:
+		SnakeGame* game;
+		Texture* text = NULL;
+	};
+
+	/// <summary>
+	/// The game over screen with the final score. Space plays again.
+	/// </summary>
+	class LoseScene : public Scene
+	{
+	public:
+		LoseScene(SnakeGame* game) : game(game) {}
+
+		void DeclareAssets(SceneAssets& assets) override
+		{
+			assets.AddTexture("assets/lose.png");
+		}
+
+		void OnEnter() override
+		{
+			background = game->GetAssets().GetTexture("assets/lose.png");
+		}
+
+		bool OnEvent(SDL_Event event) override
+		{
+			if (SDL_GetKeyboardState(NULL)[SDL_SCANCODE_SPACE])
+			{
+				game->ChangeScene((int)GameState::PLAYING);
+			}
+
+			return true;
+		}
+
+		bool OnRender(float deltaTime) override
+		{
+			SdfFont* font = game->score->font;
+			const std::string& text = game->score->text;
+
+			// same atlas as the in game score, just drawn bigger.
+			background->Render(0, 0);
+			font->Render(text, game->WIDTH / 2 - font->GetWidth(text, 48) / 2, game->HEIGHT / 2 - font->GetHeight(48) / 2, 48, COLOR_WHITE);
+
+			return true;
+		}
+
+	private:
+		SnakeGame* game;
+		Texture* background = NULL;
+	};
+
+	bool OnCreateStartupTasks(StartupGraph& startup) override
+	{
+		snake = new Snake();
+		apple = new Apple();
+		score = new Score();
+
+		// building the font's distance field doesn't need the main thread, so do it while the window comes up.
+		startup.AddTask("score font", [this]()
+		{
+			score->font = new SdfFont(renderer);
+			return score->font->LoadFromFile("assets/coder-crux.ttf");
+		}, { "renderer", "text" });
 
 		return true;
 	}
 
-	bool OnEvent(SDL_Event event) override
+	bool OnCreate() override
 	{
-		const Uint8* currentKeyStates = SDL_GetKeyboardState(NULL);
+		RegisterScene((int)GameState::MENU, new MenuScene(this));
+		RegisterScene((int)GameState::PLAYING, new PlayingScene(this));
+		RegisterScene((int)GameState::PAUSE, new PauseScene(this));
+		RegisterScene((int)GameState::LOSE, new LoseScene(this));
+
+		// each scene's neighbours get preloaded while it's up, so switching never waits on a decode.
+		AddSceneTransition((int)GameState::MENU, (int)GameState::PLAYING);
+		AddSceneTransition((int)GameState::PLAYING, (int)GameState::PAUSE);
+		AddSceneTransition((int)GameState::PLAYING, (int)GameState::LOSE);
+		AddSceneTransition((int)GameState::PLAYING, (int)GameState::MENU);
+		AddSceneTransition((int)GameState::PAUSE, (int)GameState::MENU);
+		AddSceneTransition((int)GameState::LOSE, (int)GameState::PLAYING);
+
+		if (useBoardTexture && !board.Create(renderer))
+		{
+			useBoardTexture = false;
+		}
+
+		// the body ring and occupancy grid live inside the simulation, so they're charged as an estimate like textures.
+		MemoryTracker::Get().AddExternal(MemoryTag::GAMEPLAY, sizeof(SnakeSimulation));
 
-		switch (state)
+		if (useMinimap && !minimap.Create(renderer, MINIMAP_WIDTH, MINIMAP_HEIGHT))
 		{
-		case GameState::MENU:
-			OnEventMenu(currentKeyStates);
-			break;
-		case GameState::PLAYING:
-			OnEventPlaying(currentKeyStates);
-			break;
-		case GameState::LOSE:
-			OnEventMenu(currentKeyStates);
-			break;
+			useMinimap = false;
 		}
 
+		// headless runs have nobody to press space, so go straight into a game.
+		ChangeScene(IsHeadless() ? (int)GameState::PLAYING : (int)GameState::MENU);
+
+		EnableQualityGovernor(60);
+		SetMemoryReportInterval(60000);
+
 		return true;
 	}
 
-	bool OnEventMenu(const Uint8* currentKeyStates)
+	bool InitPlayingState()
 	{
-		if (currentKeyStates[SDL_SCANCODE_SPACE])
+		Uint32 seed = (Uint32)SDL_GetPerformanceCounter();
+		simulation.Reset(seed);
+
+		#ifdef SNAKE_BODY_GEOMETRY
+		body.Rebuild(simulation);
+		#endif
+
+		if (useBoardTexture)
 		{
-			state = GameState::PLAYING;
-			InitPlayingState();
+			board.Rebuild(simulation);
 		}
 
+		if (useMinimap)
+		{
+			minimap.Rebuild(simulation);
+		}
+
+		Telemetry::Get().Record((Uint32)SnakeTelemetry::GAME_START, (Sint32)seed);
+
+		ticksPlayed = 0;
+		directionChanges = 0;
+		pendingInputId = 0;
+		dying = false;
+		scoreVisible = true;
+
+		score->score = 0;
+		score->text = "Score: " + std::to_string(score->score);
+
 		return true;
 	}
 
@@ -158,71 +473,86 @@ private:
 	{
 		if (currentKeyStates[SDL_SCANCODE_W] || currentKeyStates[SDL_SCANCODE_UP])
 		{
-			if (snake->yVelocity != 1.0) 
-			{
-				snake->yVelocity = -1.0;
-				snake->xVelocity = 0;
-			}			
+			ChangeDirection(SnakeDirection::UP);
 		}
 		else if (currentKeyStates[SDL_SCANCODE_S] || currentKeyStates[SDL_SCANCODE_DOWN])
 		{
-			if (snake->yVelocity != -1.0) 
-			{
-				snake->yVelocity = 1.0;
-				snake->xVelocity = 0;
-			}			
+			ChangeDirection(SnakeDirection::DOWN);
 		}
 		else if (currentKeyStates[SDL_SCANCODE_A] || currentKeyStates[SDL_SCANCODE_LEFT])
 		{
-			if (snake->xVelocity != 1.0) 
-			{
-				snake->yVelocity = 0;
-				snake->xVelocity = -1.0;
-			}			
+			ChangeDirection(SnakeDirection::LEFT);
 		}
 		else if (currentKeyStates[SDL_SCANCODE_D] || currentKeyStates[SDL_SCANCODE_RIGHT])
 		{
-			if (snake->xVelocity != -1.0)
-			{
-				snake->yVelocity = 0;
-				snake->xVelocity = 1.0;
-			}			
+			ChangeDirection(SnakeDirection::RIGHT);
 		}
 		else if (currentKeyStates[SDL_SCANCODE_ESCAPE])
 		{
-			state = GameState::MENU;
+			ChangeScene((int)GameState::MENU);
 		}
 
 		return true;
 	}
 
-	bool OnUpdate(float deltaTime) override
+	/// <summary>
+	/// Points the snake in a new direction, tracking the input that caused it for latency reporting.
+	/// </summary>
+	/// <param name="direction">The new direction.</param>
+	void ChangeDirection(SnakeDirection direction)
 	{
-		switch (state)
+		if (!dying && simulation.RequestDirection(direction))
 		{
-		case GameState::MENU:
-			OnUpdateMenu(deltaTime);
-			break;
-		case GameState::PLAYING:
-			OnUpdatePlaying(deltaTime);
-			break;
-		case GameState::LOSE:
-			OnUpdateLose(deltaTime);
-			break;
+			pendingInputId = AcknowledgeInput();
+			directionChanges++;
+			Telemetry::Get().Record((Uint32)SnakeTelemetry::DIRECTION_CHANGE, (Sint32)direction, ticksPlayed);
 		}
+	}
 
-		return true;
+	/// <summary>
+	/// Ends the game, freezing the board while the lose sequence plays.
+	/// </summary>
+	void Die()
+	{
+		if (dying)
+		{
+			return;
+		}
+
+		dying = true;
+
+		#ifdef CRISPY_OCTO_SPORK_COROUTINES
+		loseSequence = StartCoroutine(LoseSequence());
+		#else
+		ChangeScene((int)GameState::LOSE);
+		#endif
 	}
 
-	bool OnUpdateMenu(float deltaTime)
+	#ifdef CRISPY_OCTO_SPORK_COROUTINES
+	/// <summary>
+	/// Flashes the score a few times, holds on the board, then shows the lose screen.
+	/// </summary>
+	Coroutine LoseSequence()
 	{
-		menu->Render(0, 0);
+		for (int i = 0; i < 6; i++)
+		{
+			scoreVisible = !scoreVisible;
+			co_await WaitForMilliseconds(100);
+		}
 
-		return true;
+		co_await WaitForMilliseconds(500);
+
+		ChangeScene((int)GameState::LOSE);
 	}
+	#endif
 
 	bool OnUpdatePlaying(float deltaTime) 
 	{
+		if (dying)
+		{
+			return true;
+		}
+
 		bool moveThisFrameUpdate = false;
 		secondAccumulator += deltaTime;
 
@@ -240,119 +570,193 @@ private:
 
 		if (moveThisFrameUpdate)
 		{
-			float newHeadX = snake->tail[0].x + snake->xVelocity;
-			float newHeadY = snake->tail[0].y + snake->yVelocity;
-
-			if (newHeadX > GRID_WIDTH - 1)
+			if (pendingInputId != 0)
 			{
-				newHeadX = 0;
+				MarkInputTicked(pendingInputId);
+				pendingInputId = 0;
 			}
 
-			if (newHeadX < 0)
+			SnakeTickEvents events = simulation.Tick();
+			ticksPlayed++;
+
+			#ifdef SNAKE_BODY_GEOMETRY
+			body.OnTick(simulation, events);
+			#endif
+
+			if (useBoardTexture)
 			{
-				newHeadX = GRID_WIDTH - 1;
+				board.OnTick(simulation, events);
 			}
 
-			if (newHeadY > GRID_HEIGHT - 1)
+			if (useMinimap)
 			{
-				newHeadY = 0;
+				minimap.OnTick(simulation, events);
 			}
 
-			if (newHeadY < 0)
+			if (events.ateApple)
 			{
-				newHeadY = GRID_HEIGHT - 1;
+				//nice->PlaySound();
+				score->score = simulation.GetScore();
+				score->text = "Score: " + std::to_string(score->score);
+				Telemetry::Get().Record((Uint32)SnakeTelemetry::APPLE_EATEN, score->score, ticksPlayed, simulation.GetLength(), events.headCell);
 			}
 
-			for (int i = 0; i < snake->tailLength; i++)
+			if (events.died)
 			{
-				if ((snake->tail[i].x == newHeadX) && (snake->tail[i].y == newHeadY))
-				{
-					state = GameState::LOSE;
-				}
+				SnakeDeathCause cause = events.boardFull ? SnakeDeathCause::BOARD_FULL : SnakeDeathCause::HIT_ITSELF;
+				Telemetry::Get().Record((Uint32)SnakeTelemetry::DEATH, (Sint32)cause, score->score, ticksPlayed, simulation.GetLength(), directionChanges);
+				Die();
 			}
+		}
 
-			Tail head = { newHeadX, newHeadY};
-			snake->tail.insert(snake->tail.begin(), head);
+		return true;
+	}
 
-			if ((snake->tail[0].x == apple->x) && (snake->tail[0].y == apple->y))
-			{
-				//nice->PlaySound();
-				score->score++;
-				score->texture->LoadFromRenderedText("Score: " + std::to_string(score->score), COLOR_WHITE);
+	bool OnDestroy() override
+	{
+		// textures and sounds from the asset cache are freed by the engine.
+		delete score->font;
+		board.Free();
+		minimap.Free();
+		MemoryTracker::Get().RemoveExternal(MemoryTag::GAMEPLAY, sizeof(SnakeSimulation));
 
-				bool validAppleSpawn = false;
+		// kill all the objects
+		delete snake;
+		delete apple;
+		delete score;
 
-				while (!validAppleSpawn)
-				{
-					apple->x = rand() % GRID_WIDTH;
-					apple->y = rand() % GRID_HEIGHT;
-
-					validAppleSpawn = true;
-					for (int i = 0; i < snake->tailLength; i++)
-					{
-						if ((snake->tail[i].x == apple->x) && (snake->tail[i].y == apple->y))
-						{
-							validAppleSpawn = false;
-						}
-					}
-				}
+		return true;
+	}
+};
 
-				snake->tailLength++;
-			} 
-			else
+/// <summary>
+/// Adds the games benchmarks: simulation tick throughput, headless frame time and startup latency.
+/// </summary>
+/// <param name="benchmarks">The runner to add them to.</param>
+void AddBenchmarks(BenchmarkRunner& benchmarks)
+{
+	const int STREAM_COUNT = 1024;
+	const Uint32 FRAME_COUNT = 2000;
+
+	// the same input streams every run, so only the code changes between runs.
+	auto streams = std::make_shared<std::vector<std::vector<SnakeInputStep>>>();
+
+	for (int i = 0; i < STREAM_COUNT; i++)
+	{
+		SnakeRandom random(i * 2654435761u + 1);
+		streams->push_back(SnakeDiffTester::GenerateSteps(i + 1, random, 2000));
+	}
+
+	benchmarks.Add("simulation ticks", "ticks/s", true, [streams]()
+	{
+		static volatile Uint64 sink = 0;
+		SnakeSimulation simulation;
+		Uint64 ticks = 0;
+		Uint64 start = SDL_GetPerformanceCounter();
+
+		for (size_t i = 0; i < streams->size(); i++)
+		{
+			simulation.Reset((Uint32)i + 1);
+
+			for (auto step : (*streams)[i])
 			{
-				snake->tail.pop_back();
+				if (step == SnakeInputStep::TICK)
+				{
+					simulation.Tick();
+					ticks++;
+				}
+				else
+				{
+					simulation.RequestDirection((SnakeDirection)step);
+				}
 			}
+
+			// keeps the compiler from throwing the games away.
+			sink = sink + simulation.Hash();
 		}
 
-		apple->texture->Render(apple->x * GRID_SIZE, apple->y * GRID_SIZE);
+		double seconds = (double)(SDL_GetPerformanceCounter() - start) / (double)SDL_GetPerformanceFrequency();
+		return ticks / seconds;
+	});
+
+	benchmarks.Add("headless frame", "ms", false, [FRAME_COUNT]()
+	{
+		SnakeGame game;
+		game.SetHeadless(true);
+		game.SetFrameLimit(FRAME_COUNT);
+		game.SetInternalResolution(game.WIDTH, game.HEIGHT);
 
-		for (int i = 0; i < snake->tailLength; i++)
+		if (!game.Create("Snake", game.WIDTH, game.HEIGHT, false, false))
 		{
-			snake->texture->Render(snake->tail[i].x * GRID_SIZE, snake->tail[i].y * GRID_SIZE);
+			return -1.0;
 		}
 
-		score->texture->Render(10, 10);
+		Uint64 start = SDL_GetPerformanceCounter();
+		game.Start();
+		double seconds = (double)(SDL_GetPerformanceCounter() - start) / (double)SDL_GetPerformanceFrequency();
 
-		return true;
-	}
+		return seconds * 1000.0 / FRAME_COUNT;
+	}, false);
 
-	bool OnUpdateLose(float deltaTime)
+	benchmarks.Add("telemetry record", "ns", false, []()
 	{
-		lose->Render(0, 0);
-		score->texture->Render(WIDTH / 2 - score->texture->width / 2, HEIGHT / 2 - score->texture->height / 2);
+		const int EVENT_COUNT = 1000;
+		Telemetry& telemetry = Telemetry::Get();
+		telemetry.Open("telemetry-benchmark", 1 << 30, 1);
 
-		return true;
-	}
+		// fewer events than the ring holds, so this measures the game thread and not the writer keeping up.
+		Uint64 start = SDL_GetPerformanceCounter();
 
-	bool OnDestroy() override
+		for (int i = 0; i < EVENT_COUNT; i++)
+		{
+			telemetry.Record((Uint32)SnakeTelemetry::APPLE_EATEN, i, i * 10, 6 + i, 168);
+		}
+
+		double seconds = (double)(SDL_GetPerformanceCounter() - start) / (double)SDL_GetPerformanceFrequency();
+
+		telemetry.Close();
+		remove("telemetry-benchmark.bin");
+
+		return seconds * 1000000000.0 / EVENT_COUNT;
+	}, false);
+
+	benchmarks.Add("startup", "ms", false, []()
 	{
-		// clean up textures
-		snake->texture->Free();
-		apple->texture->Free();
-		score->texture->Free();
-		lose->Free();
+		SnakeGame game;
+		game.SetHeadless(true);
+		game.SetFrameLimit(1);
+		game.SetInternalResolution(game.WIDTH, game.HEIGHT);
+
+		Uint64 start = SDL_GetPerformanceCounter();
+		bool created = game.Create("Snake", game.WIDTH, game.HEIGHT, false, false);
+		double seconds = (double)(SDL_GetPerformanceCounter() - start) / (double)SDL_GetPerformanceFrequency();
+
+		if (!created)
+		{
+			return -1.0;
+		}
 
-		nice->Free();
+		// starting for a frame is what tears everything down again.
+		game.Start();
 
-		// free the pointers
-		delete snake->texture;
-		delete apple->texture;
-		delete score->texture;
+		return seconds * 1000.0;
+	}, false);
+}
 
-		// kill all the objects
-		delete snake;
-		delete apple;
-		delete menu;
-		delete score;
-		delete lose;
-		
-		delete nice;
+#ifdef SNAKE_SERVER_AVAILABLE
+/// <summary>
+/// The running server, so ctrl+c can stop it cleanly.
+/// </summary>
+SnakeServer* runningServer = NULL;
 
-		return true;
+void StopServer(int signal)
+{
+	if (runningServer != NULL)
+	{
+		runningServer->Stop();
 	}
-};
-
+}
+#endif
 
 /// <summary>
 /// The main entry point of your game.
@@ -362,13 +766,165 @@ private:
 /// <returns>Returns an integer indicating exit status.</returns>
 int main(int argc, char* argv[])
 {
+	// offline step: bake every image into raw pixels so startup skips the png decode.
+	if (argc > 1 && std::string(argv[1]) == "--bake-assets")
+	{
+		bool success = true;
+		Uint32 format = Renderer::GetDefaultNativeTextureFormat();
+
+		for (const char* asset : TEXTURE_ASSETS)
+		{
+			success &= Texture::BakeTextureFile(asset, Texture::GetBakedPath(asset).c_str(), format);
+		}
+
+		return success ? 0 : 1;
+	}
+
+	// checks the optimized snake rules against the originals over random input streams.
+	if (argc > 1 && std::string(argv[1]) == "--difftest")
+	{
+		Uint32 streams = argc > 2 ? (Uint32)strtoul(argv[2], NULL, 10) : 1000000;
+		Uint32 seed = argc > 3 ? (Uint32)strtoul(argv[3], NULL, 10) : 1;
+
+		return SnakeDiffTester::Run(streams, seed) ? 0 : 1;
+	}
+
+	// dedicated server hosting a match per connection.
+	if (argc > 1 && std::string(argv[1]) == "--server")
+	{
+		#ifdef SNAKE_SERVER_AVAILABLE
+		SnakeServer server;
+		Uint16 port = argc > 2 ? (Uint16)atoi(argv[2]) : SNAKE_DEFAULT_PORT;
+
+		if (!server.Start(port, argc > 3 ? atoi(argv[3]) : 0))
+		{
+			return 1;
+		}
+
+		runningServer = &server;
+		signal(SIGINT, StopServer);
+		signal(SIGTERM, StopServer);
+
+		server.Wait();
+		runningServer = NULL;
+		return 0;
+		#else
+		COS_LOG_ERR("The server needs epoll, so it only runs on linux");
+		return 1;
+		#endif
+	}
+
+	// load test for the server: bot clients ramped up in steps, reporting latency percentiles at each step.
+	if (argc > 1 && std::string(argv[1]) == "--swarm")
+	{
+		#ifdef SNAKE_SERVER_AVAILABLE
+		SnakeSwarm swarm;
+		int clients = argc > 2 ? atoi(argv[2]) : 1000;
+		int threads = argc > 3 ? atoi(argv[3]) : 4;
+		Uint16 port = argc > 4 ? (Uint16)atoi(argv[4]) : SNAKE_DEFAULT_PORT;
+		int steps = argc > 5 ? atoi(argv[5]) : 5;
+		int stepSeconds = argc > 6 ? atoi(argv[6]) : 5;
+
+		return swarm.Run("127.0.0.1", port, clients, threads, steps, stepSeconds) ? 0 : 1;
+		#else
+		COS_LOG_ERR("The swarm needs epoll, so it only runs on linux");
+		return 1;
+		#endif
+	}
+
+	// perf regression checks. --benchmark logs the results, --benchmark-save writes every sample to a baseline
+	// file and --benchmark-compare fails if anything got significantly worse than the baseline.
+	if (argc > 1 && std::string(argv[1]).rfind("--benchmark", 0) == 0)
+	{
+		std::string mode = argv[1];
+		std::string baseline;
+		int runsArgument = 2;
+
+		if (mode != "--benchmark" && mode != "--benchmark-save" && mode != "--benchmark-compare")
+		{
+			COS_LOG_ERR("Unknown benchmark mode {}, use --benchmark, --benchmark-save or --benchmark-compare", mode);
+			return 1;
+		}
+
+		if (mode != "--benchmark")
+		{
+			if (argc < 3)
+			{
+				COS_LOG_ERR("{} needs a baseline file", mode);
+				return 1;
+			}
+
+			baseline = argv[2];
+			runsArgument = 3;
+		}
+
+		BenchmarkRunner benchmarks;
+		benchmarks.SetRuns(argc > runsArgument ? atoi(argv[runsArgument]) : 20);
+		AddBenchmarks(benchmarks);
+
+		if (!benchmarks.Run())
+		{
+			return 1;
+		}
+
+		if (mode == "--benchmark-save")
+		{
+			return benchmarks.SaveBaseline(baseline) ? 0 : 1;
+		}
+
+		if (mode == "--benchmark-compare")
+		{
+			return benchmarks.CompareWithBaseline(baseline) ? 0 : 1;
+		}
+
+		return 0;
+	}
+
 	SnakeGame game;
 
+	// automated perf runs: no window or audio device, stop after a fixed number of frames and report call counts.
+	if (argc > 1 && std::string(argv[1]) == "--headless")
+	{
+		game.SetHeadless(true, true);
+		game.SetFrameLimit(argc > 2 ? (Uint32)atoi(argv[2]) : 10000);
+	}
+
+	// --board-texture draws the board from one streaming texture instead of a sprite or bead per cell, --minimap adds an
+	// overview, and --frame-trace followed by a file writes the first few seconds of frames out for chrome://tracing.
+	for (int i = 1; i < argc; i++)
+	{
+		if (std::string(argv[i]) == "--board-texture")
+		{
+			game.SetBoardTexture(true);
+		}
+
+		if (std::string(argv[i]) == "--minimap")
+		{
+			game.SetMinimap(true);
+		}
+
+		if (std::string(argv[i]) == "--frame-trace" && i + 1 < argc)
+		{
+			game.GetFrameGraph().BeginTrace(argv[i + 1], FRAME_TRACE_FRAMES);
+		}
+	}
+
+	// the board is pixel art, so render it at its native size and let the engine scale it up.
+	game.SetInternalResolution(game.WIDTH, game.HEIGHT);
+
+	// real games get recorded for analytics, perf runs don't.
+	if (!game.IsHeadless())
+	{
+		Telemetry::Get().Open("snake-telemetry");
+	}
+
 	// Create a new instance of your game. If successful, then start the main loop.
 	if (game.Create("Snake", game.WIDTH, game.HEIGHT, false, false))
 	{
 		game.Start();
 	}
 
+	Telemetry::Get().Close();
+
 	return 0;
 }
\ No newline at end of file
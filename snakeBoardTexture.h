@@ -0,0 +1,200 @@
+#pragma once
+#include "crispyOctoSporkEngine.h"
+#include "snakeSimulation.h"
+
+/// <summary>
+/// Draws the whole board from a streaming texture holding one pixel per cell, scaled up with a single copy. A shadow
+/// of the pixels is kept on the cpu, so a tick only locks and writes the few cells whose colour actually changed and
+/// the cost stays the same however long the snake gets.
+/// </summary>
+class SnakeBoardTexture
+{
+public:
+	/// <summary>
+	/// Constructor.
+	/// </summary>
+	/// <param name="cellSize">The size of a board cell in pixels.</param>
+	SnakeBoardTexture(float cellSize = 32)
+	{
+		this->cellSize = cellSize;
+		this->renderer = NULL;
+		this->texture = NULL;
+
+		for (int i = 0; i < SnakeSimulation::CELL_COUNT; i++)
+		{
+			shadow[i] = EMPTY_PIXEL;
+		}
+	}
+
+	~SnakeBoardTexture()
+	{
+		Free();
+	}
+
+	/// <summary>
+	/// Creates the texture. Nothing is drawn until the next <see cref="Rebuild"/>.
+	/// </summary>
+	/// <param name="renderer">The renderer to create it with.</param>
+	/// <returns>Returns a boolean indicating success.</returns>
+	bool Create(CrispyOctoSpork::Renderer* renderer)
+	{
+		Free();
+
+		this->renderer = renderer;
+		texture = renderer->CreateTexture(SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_STREAMING, SnakeSimulation::GRID_WIDTH, SnakeSimulation::GRID_HEIGHT);
+
+		if (texture == NULL)
+		{
+			COS_LOG_ERR("Could not create the board texture: {}", SDL_GetError());
+			return false;
+		}
+
+		// empty cells are see through so whatever is behind the board still shows, and every cell stays a hard edged square.
+		renderer->SetTextureBlendMode(texture, SDL_BLENDMODE_BLEND);
+		renderer->SetTextureScaleMode(texture, SDL_ScaleModeNearest);
+		CrispyOctoSpork::MemoryTracker::Get().AddExternal(CrispyOctoSpork::MemoryTag::TEXTURES, TEXTURE_BYTES);
+
+		return true;
+	}
+
+	/// <summary>
+	/// Destroys the texture.
+	/// </summary>
+	void Free()
+	{
+		if (texture != NULL)
+		{
+			renderer->DestroyTexture(texture);
+			CrispyOctoSpork::MemoryTracker::Get().RemoveExternal(CrispyOctoSpork::MemoryTag::TEXTURES, TEXTURE_BYTES);
+			texture = NULL;
+		}
+	}
+
+	/// <summary>
+	/// Rewrites every cell from the simulation. Needed after a reset, ticks after that go through OnTick.
+	/// </summary>
+	/// <param name="simulation">The simulation.</param>
+	void Rebuild(const SnakeSimulation& simulation)
+	{
+		int headCell = simulation.GetSegment(0);
+
+		for (int cell = 0; cell < SnakeSimulation::CELL_COUNT; cell++)
+		{
+			shadow[cell] = GetPixel(simulation, cell, headCell);
+		}
+
+		void* pixels;
+		int pitch;
+		SDL_Rect all = { 0, 0, SnakeSimulation::GRID_WIDTH, SnakeSimulation::GRID_HEIGHT };
+
+		if (texture == NULL || renderer->LockTexture(texture, &all, &pixels, &pitch) != 0)
+		{
+			return;
+		}
+
+		for (int y = 0; y < SnakeSimulation::GRID_HEIGHT; y++)
+		{
+			SDL_memcpy((Uint8*)pixels + y * pitch, &shadow[y * SnakeSimulation::GRID_WIDTH], SnakeSimulation::GRID_WIDTH * sizeof(Uint32));
+		}
+
+		renderer->UnlockTexture(texture);
+	}
+
+	/// <summary>
+	/// Catches up with a single tick.
+	/// </summary>
+	/// <param name="simulation">The simulation, after the tick.</param>
+	/// <param name="events">What the tick changed.</param>
+	void OnTick(const SnakeSimulation& simulation, const SnakeTickEvents& events)
+	{
+		// the new head, the old head that's now body, the tail end, and the apple. an eaten apple's cell is the new head.
+		WriteCell(simulation, events.headCell);
+
+		if (simulation.GetLength() > 1)
+		{
+			WriteCell(simulation, simulation.GetSegment(1));
+		}
+
+		if (events.tailPopped)
+		{
+			WriteCell(simulation, events.poppedCell);
+		}
+
+		WriteCell(simulation, events.appleCell);
+	}
+
+	/// <summary>
+	/// Draws the board into a viewport, with the board's top left corner at the world origin.
+	/// </summary>
+	/// <param name="viewport">The viewport, already clipped to.</param>
+	void Render(const CrispyOctoSpork::Viewport& viewport)
+	{
+		if (texture == NULL)
+		{
+			return;
+		}
+
+		SDL_FPoint topLeft = viewport.WorldToScreen(0, 0);
+		float scale = cellSize * viewport.camera.zoom;
+		SDL_Rect destination = { (int)topLeft.x, (int)topLeft.y, (int)(SnakeSimulation::GRID_WIDTH * scale), (int)(SnakeSimulation::GRID_HEIGHT * scale) };
+		renderer->Copy(texture, NULL, &destination);
+	}
+
+private:
+	// argb, to match the texture.
+	static const Uint32 EMPTY_PIXEL = 0x00000000;
+	static const Uint32 BODY_PIXEL = 0xFF30A040;
+	static const Uint32 HEAD_PIXEL = 0xFF8CE66E;
+	static const Uint32 APPLE_PIXEL = 0xFFDC3232;
+	static const Sint64 TEXTURE_BYTES = SnakeSimulation::CELL_COUNT * 4;
+
+	CrispyOctoSpork::Renderer* renderer;
+	SDL_Texture* texture;
+	float cellSize;
+	Uint32 shadow[SnakeSimulation::CELL_COUNT];
+
+	/// <summary>
+	/// Gets what a cell should look like. The snake is drawn over the apple, the same as the sprite path.
+	/// </summary>
+	Uint32 GetPixel(const SnakeSimulation& simulation, int cell, int headCell)
+	{
+		if (cell == headCell)
+		{
+			return HEAD_PIXEL;
+		}
+
+		if (simulation.IsOccupied(cell))
+		{
+			return BODY_PIXEL;
+		}
+
+		return cell == simulation.GetAppleCell() ? APPLE_PIXEL : EMPTY_PIXEL;
+	}
+
+	/// <summary>
+	/// Uploads a single cell, if it's actually changed.
+	/// </summary>
+	void WriteCell(const SnakeSimulation& simulation, int cell)
+	{
+		Uint32 pixel = GetPixel(simulation, cell, simulation.GetSegment(0));
+
+		if (shadow[cell] == pixel)
+		{
+			return;
+		}
+
+		shadow[cell] = pixel;
+
+		void* pixels;
+		int pitch;
+		SDL_Rect area = { cell % SnakeSimulation::GRID_WIDTH, cell / SnakeSimulation::GRID_WIDTH, 1, 1 };
+
+		if (texture == NULL || renderer->LockTexture(texture, &area, &pixels, &pitch) != 0)
+		{
+			return;
+		}
+
+		*(Uint32*)pixels = pixel;
+		renderer->UnlockTexture(texture);
+	}
+};
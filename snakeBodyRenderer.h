@@ -0,0 +1,237 @@
+#pragma once
+#include "crispyOctoSporkEngine.h"
+#include "snakeSimulation.h"
+
+// SDL_RenderGeometry arrived in 2.0.18. the project builds against 2.0.20, only older system SDLs fall back to snake.png per segment.
+#if SDL_VERSION_ATLEAST(2, 0, 18)
+#define SNAKE_BODY_GEOMETRY
+
+/// <summary>
+/// Draws the snakes body as rounded beads joined by bridges, all in a single <see cref="SDL_RenderGeometry"/> call.
+/// Every segment owns a fixed block of vertices in a ring laid out like the simulation's, so a tick only writes the
+/// new head and touches up the old one, and a popped tail just falls out of the drawn range.
+/// </summary>
+class SnakeBodyRenderer
+{
+public:
+	/// <summary>
+	/// Constructor.
+	/// </summary>
+	/// <param name="cellSize">The size of a board cell in pixels.</param>
+	SnakeBodyRenderer(float cellSize = 32) : vertices(RING_SIZE * BLOCK_VERTICES), placed(RING_SIZE * BLOCK_VERTICES), indices(RING_SIZE * 2 * BLOCK_INDICES)
+	{
+		this->cellSize = cellSize;
+		this->head = 0;
+		this->length = 0;
+		this->sequence = 0;
+
+		// the index table covers the ring twice, so the drawn range stays contiguous when it wraps past the end.
+		for (int block = 0; block < RING_SIZE * 2; block++)
+		{
+			int* blockIndices = &indices[block * BLOCK_INDICES];
+			int base = (block & RING_MASK) * BLOCK_VERTICES;
+
+			// bridge first, so the bead sits on top of its own end of it.
+			blockIndices[0] = base + BEAD_VERTICES;
+			blockIndices[1] = base + BEAD_VERTICES + 1;
+			blockIndices[2] = base + BEAD_VERTICES + 2;
+			blockIndices[3] = base + BEAD_VERTICES;
+			blockIndices[4] = base + BEAD_VERTICES + 2;
+			blockIndices[5] = base + BEAD_VERTICES + 3;
+
+			// the bead is a fan around its centre vertex.
+			for (int i = 0; i < BEAD_VERTICES - 1; i++)
+			{
+				blockIndices[6 + i * 3] = base;
+				blockIndices[6 + i * 3 + 1] = base + 1 + i;
+				blockIndices[6 + i * 3 + 2] = base + 1 + (i + 1) % (BEAD_VERTICES - 1);
+			}
+		}
+	}
+
+	/// <summary>
+	/// Rebuilds every block from the simulation. Needed after a reset, ticks after that go through OnTick.
+	/// </summary>
+	/// <param name="simulation">The simulation.</param>
+	void Rebuild(const SnakeSimulation& simulation)
+	{
+		head = 0;
+		length = 0;
+		sequence = 0;
+
+		for (int i = simulation.GetLength() - 1; i >= 0; i--)
+		{
+			PushHead(simulation.GetSegment(i), i == simulation.GetLength() - 1 ? -1 : simulation.GetSegment(i + 1));
+		}
+	}
+
+	/// <summary>
+	/// Catches up with a single tick.
+	/// </summary>
+	/// <param name="simulation">The simulation, after the tick.</param>
+	/// <param name="events">What the tick changed.</param>
+	void OnTick(const SnakeSimulation& simulation, const SnakeTickEvents& events)
+	{
+		PushHead(events.headCell, simulation.GetSegment(1));
+
+		if (events.tailPopped)
+		{
+			length--;
+		}
+	}
+
+	/// <summary>
+	/// Draws the body into a viewport.
+	/// </summary>
+	/// <param name="renderer">The renderer to draw with.</param>
+	/// <param name="viewport">The viewport, already clipped to.</param>
+	void Render(CrispyOctoSpork::Renderer* renderer, const CrispyOctoSpork::Viewport& viewport)
+	{
+		SDL_FPoint origin = viewport.WorldToScreen(0, 0);
+		float zoom = viewport.camera.zoom;
+
+		// showing the world one to one, the vertices are already where they go on screen.
+		if (origin.x == 0 && origin.y == 0 && zoom == 1)
+		{
+			renderer->Geometry(NULL, vertices.data(), (int)vertices.size(), &indices[head * BLOCK_INDICES], length * BLOCK_INDICES);
+			return;
+		}
+
+		// otherwise the drawn blocks are moved into place in a copy, the rest of the ring isn't indexed.
+		for (int i = 0; i < length; i++)
+		{
+			int first = ((head + i) & RING_MASK) * BLOCK_VERTICES;
+
+			for (int v = first; v < first + BLOCK_VERTICES; v++)
+			{
+				placed[v] = vertices[v];
+				placed[v].position = SDL_FPoint{ origin.x + vertices[v].position.x * zoom, origin.y + vertices[v].position.y * zoom };
+			}
+		}
+
+		renderer->Geometry(NULL, placed.data(), (int)placed.size(), &indices[head * BLOCK_INDICES], length * BLOCK_INDICES);
+	}
+
+private:
+	// a power of two bigger than the longest the snake can get, same as the simulation.
+	static const int RING_SIZE = 512;
+	static const int RING_MASK = RING_SIZE - 1;
+	static_assert(RING_SIZE > SnakeSimulation::CELL_COUNT, "The ring has to fit a snake covering the whole board.");
+
+	// a centre and eight around it for the bead, then four for the bridge to the segment in front.
+	static const int BEAD_VERTICES = 9;
+	static const int BLOCK_VERTICES = BEAD_VERTICES + 4;
+	static const int BLOCK_INDICES = 6 + (BEAD_VERTICES - 1) * 3;
+
+	// the gradient repeats every this many segments, so a segment's colour never changes once it's been laid down.
+	static const int GRADIENT_PERIOD = 16;
+
+	// how far a beads flat sides are from its centre, in cells.
+	static constexpr float BEAD_APOTHEM = 0.42f;
+
+	std::vector<SDL_Vertex> vertices;
+	std::vector<SDL_Vertex> placed;
+	std::vector<int> indices;
+	float cellSize;
+	int head;
+	int length;
+	Uint32 sequence;
+
+	/// <summary>
+	/// Adds a new head, and bridges the old head over to it.
+	/// </summary>
+	/// <param name="cell">The new head cell.</param>
+	/// <param name="previousCell">The old head cell, or -1 if there isn't one.</param>
+	void PushHead(int cell, int previousCell)
+	{
+		head = (head - 1) & RING_MASK;
+		length++;
+		sequence++;
+
+		WriteBead(head, cell, SDL_Color{ 140, 230, 110, 255 });
+		WriteBridge(head, cell, cell, SDL_Color{ 0, 0, 0, 0 });
+
+		if (previousCell >= 0)
+		{
+			int previousBlock = (head + 1) & RING_MASK;
+			SDL_Color color = GetColor(sequence - 1);
+			WriteBead(previousBlock, previousCell, color);
+			WriteBridge(previousBlock, previousCell, cell, color);
+		}
+	}
+
+	/// <summary>
+	/// Gets the colour of a segment, a triangle wave between two greens from head to tail.
+	/// </summary>
+	SDL_Color GetColor(Uint32 segment)
+	{
+		float t = SDL_fabs((float)(segment % GRADIENT_PERIOD) / (GRADIENT_PERIOD / 2) - 1.0f);
+		return SDL_Color{ (Uint8)(40 + 30 * t), (Uint8)(150 + 50 * t), (Uint8)(50 + 30 * t), 255 };
+	}
+
+	float GetCentreX(int cell)
+	{
+		return (cell % SnakeSimulation::GRID_WIDTH + 0.5f) * cellSize;
+	}
+
+	float GetCentreY(int cell)
+	{
+		return (cell / SnakeSimulation::GRID_WIDTH + 0.5f) * cellSize;
+	}
+
+	void WriteBead(int block, int cell, SDL_Color color)
+	{
+		SDL_Vertex* bead = &vertices[block * BLOCK_VERTICES];
+		float x = GetCentreX(cell);
+		float y = GetCentreY(cell);
+
+		// an octagon with its flat sides facing the neighbouring cells, corners at 22.5 degrees plus multiples of 45.
+		static const float CORNERS[BEAD_VERTICES - 1][2] =
+		{
+			{ 0.92388f, 0.38268f }, { 0.38268f, 0.92388f }, { -0.38268f, 0.92388f }, { -0.92388f, 0.38268f },
+			{ -0.92388f, -0.38268f }, { -0.38268f, -0.92388f }, { 0.38268f, -0.92388f }, { 0.92388f, -0.38268f }
+		};
+		const float radius = cellSize * BEAD_APOTHEM / 0.92388f;
+
+		bead[0] = SDL_Vertex{ { x, y }, color, { 0, 0 } };
+
+		for (int i = 0; i < BEAD_VERTICES - 1; i++)
+		{
+			bead[1 + i] = SDL_Vertex{ { x + CORNERS[i][0] * radius, y + CORNERS[i][1] * radius }, color, { 0, 0 } };
+		}
+	}
+
+	void WriteBridge(int block, int fromCell, int toCell, SDL_Color color)
+	{
+		SDL_Vertex* bridge = &vertices[block * BLOCK_VERTICES + BEAD_VERTICES];
+		float fromX = GetCentreX(fromCell);
+		float fromY = GetCentreY(fromCell);
+		float toX = GetCentreX(toCell);
+		float toY = GetCentreY(toCell);
+
+		// moves that wrap round the edge of the board aren't bridged, the gap at the edge reads fine.
+		if (SDL_fabs(toX - fromX) > cellSize * 1.5f || SDL_fabs(toY - fromY) > cellSize * 1.5f || fromCell == toCell)
+		{
+			for (int i = 0; i < 4; i++)
+			{
+				bridge[i] = SDL_Vertex{ { fromX, fromY }, color, { 0, 0 } };
+			}
+
+			return;
+		}
+
+		// stops at the flat side of the bead in front instead of painting over it.
+		float directionX = (toX - fromX) / cellSize;
+		float directionY = (toY - fromY) / cellSize;
+		float endX = toX - directionX * cellSize * BEAD_APOTHEM;
+		float endY = toY - directionY * cellSize * BEAD_APOTHEM;
+		float sideX = -directionY * cellSize * 0.25f;
+		float sideY = directionX * cellSize * 0.25f;
+
+		bridge[0] = SDL_Vertex{ { fromX + sideX, fromY + sideY }, color, { 0, 0 } };
+		bridge[1] = SDL_Vertex{ { endX + sideX, endY + sideY }, color, { 0, 0 } };
+		bridge[2] = SDL_Vertex{ { endX - sideX, endY - sideY }, color, { 0, 0 } };
+		bridge[3] = SDL_Vertex{ { fromX - sideX, fromY - sideY }, color, { 0, 0 } };
+	}
+};
+#endif
@@ -0,0 +1,549 @@
+#pragma once
+#include "crispyOctoSporkEngine.h"
+#include "snakeSimulation.h"
+#include <vector>
+#include <string>
+#include <cstdlib>
+
+/// <summary>
+/// The snake rules exactly as SnakeGame::OnUpdatePlaying shipped them, kept as the oracle for <see cref="SnakeSimulation"/>.
+/// Don't optimize this, its whole job is to be obviously the old code.
+/// </summary>
+class SnakeReference
+{
+public:
+	struct Tail
+	{
+		float x = 0;
+		float y = 0;
+	};
+
+	const int GRID_WIDTH = SnakeSimulation::GRID_WIDTH;
+	const int GRID_HEIGHT = SnakeSimulation::GRID_HEIGHT;
+
+	std::vector<Tail> tail;
+	int tailLength = 0;
+	float xVelocity = 0;
+	float yVelocity = 0;
+	float appleX = 0;
+	float appleY = 0;
+	int score = 0;
+	bool dying = false;
+	SnakeRandom random;
+
+	void Reset(Uint32 seed)
+	{
+		random.Seed(seed);
+
+		float startingX = 8.0;
+		float startingY = 8.0;
+		xVelocity = 1.0;
+		yVelocity = 0;
+		tailLength = 6;
+		tail.clear();
+		dying = false;
+
+		for (int i = 0; i < tailLength; i++)
+		{
+			tail.push_back({ startingX + (-xVelocity * i), startingY });
+		}
+
+		appleX = random.Next() % GRID_WIDTH;
+		appleY = random.Next() % GRID_HEIGHT;
+
+		score = 0;
+	}
+
+	bool RequestDirection(SnakeDirection direction)
+	{
+		switch (direction)
+		{
+		case SnakeDirection::UP:
+			return yVelocity != 1.0 && ChangeDirection(0, -1.0);
+		case SnakeDirection::DOWN:
+			return yVelocity != -1.0 && ChangeDirection(0, 1.0);
+		case SnakeDirection::LEFT:
+			return xVelocity != 1.0 && ChangeDirection(-1.0, 0);
+		case SnakeDirection::RIGHT:
+			return xVelocity != -1.0 && ChangeDirection(1.0, 0);
+		}
+
+		return false;
+	}
+
+	bool ChangeDirection(float newXVelocity, float newYVelocity)
+	{
+		if (dying)
+		{
+			return false;
+		}
+
+		bool changed = xVelocity != newXVelocity || yVelocity != newYVelocity;
+		xVelocity = newXVelocity;
+		yVelocity = newYVelocity;
+		return changed;
+	}
+
+	void Tick()
+	{
+		float newHeadX = tail[0].x + xVelocity;
+		float newHeadY = tail[0].y + yVelocity;
+
+		if (newHeadX > GRID_WIDTH - 1)
+		{
+			newHeadX = 0;
+		}
+
+		if (newHeadX < 0)
+		{
+			newHeadX = GRID_WIDTH - 1;
+		}
+
+		if (newHeadY > GRID_HEIGHT - 1)
+		{
+			newHeadY = 0;
+		}
+
+		if (newHeadY < 0)
+		{
+			newHeadY = GRID_HEIGHT - 1;
+		}
+
+		for (int i = 0; i < tailLength; i++)
+		{
+			if ((tail[i].x == newHeadX) && (tail[i].y == newHeadY))
+			{
+				dying = true;
+			}
+		}
+
+		Tail head = { newHeadX, newHeadY};
+		tail.insert(tail.begin(), head);
+
+		if ((tail[0].x == appleX) && (tail[0].y == appleY))
+		{
+			score++;
+
+			// the shipped loop never ends on a full board, the simulation ends the game there instead.
+			if (!HasFreeAppleCell())
+			{
+				dying = true;
+				tailLength++;
+				return;
+			}
+
+			bool validAppleSpawn = false;
+
+			while (!validAppleSpawn)
+			{
+				appleX = random.Next() % GRID_WIDTH;
+				appleY = random.Next() % GRID_HEIGHT;
+
+				validAppleSpawn = true;
+				for (int i = 0; i < tailLength; i++)
+				{
+					if ((tail[i].x == appleX) && (tail[i].y == appleY))
+					{
+						validAppleSpawn = false;
+					}
+				}
+			}
+
+			tailLength++;
+		}
+		else
+		{
+			tail.pop_back();
+		}
+	}
+
+	bool HasFreeAppleCell()
+	{
+		bool taken[SnakeSimulation::CELL_COUNT] = {};
+		int takenCount = 0;
+
+		for (int i = 0; i < tailLength; i++)
+		{
+			int cell = (int)tail[i].y * GRID_WIDTH + (int)tail[i].x;
+			takenCount += taken[cell] ? 0 : 1;
+			taken[cell] = true;
+		}
+
+		return takenCount < SnakeSimulation::CELL_COUNT;
+	}
+
+	Uint64 Hash() const
+	{
+		Uint64 hash = SnakeSimulation::HashStart();
+		hash = SnakeSimulation::HashValue(hash, tailLength);
+
+		for (int i = 0; i < tailLength; i++)
+		{
+			hash = SnakeSimulation::HashValue(hash, (int)tail[i].y * GRID_WIDTH + (int)tail[i].x);
+		}
+
+		hash = SnakeSimulation::HashValue(hash, (int)xVelocity);
+		hash = SnakeSimulation::HashValue(hash, (int)yVelocity);
+		hash = SnakeSimulation::HashValue(hash, (int)appleY * GRID_WIDTH + (int)appleX);
+		hash = SnakeSimulation::HashValue(hash, score);
+		return SnakeSimulation::HashValue(hash, dying ? 1 : 0);
+	}
+};
+
+/// <summary>
+/// One step of a recorded input stream: a direction request, or a tick of the game.
+/// </summary>
+enum class SnakeInputStep : Uint8
+{
+	UP,
+	DOWN,
+	LEFT,
+	RIGHT,
+	TICK
+};
+
+/// <summary>
+/// Runs the optimized <see cref="SnakeSimulation"/> against <see cref="SnakeReference"/> over random seeded input streams,
+/// comparing state hashes after every step, and shrinks any divergence down to a minimal reproducer.
+/// </summary>
+class SnakeDiffTester
+{
+public:
+	/// <summary>
+	/// Replays a stream on both implementations.
+	/// </summary>
+	/// <param name="seed">The game seed.</param>
+	/// <param name="steps">The input stream.</param>
+	/// <returns>Returns the index of the first step after which they disagree, or -1 if they never do.</returns>
+	static int FindDivergence(Uint32 seed, const std::vector<SnakeInputStep>& steps)
+	{
+		SnakeSimulation simulation;
+		SnakeReference reference;
+		simulation.Reset(seed);
+		reference.Reset(seed);
+
+		if (simulation.Hash() != reference.Hash())
+		{
+			return 0;
+		}
+
+		for (size_t i = 0; i < steps.size(); i++)
+		{
+			if (!ApplyStep(simulation, reference, steps[i]) || simulation.Hash() != reference.Hash())
+			{
+				return (int)i;
+			}
+
+			// the game stops ticking once the snake dies, so there's nothing more to compare.
+			if (reference.dying && simulation.IsDead())
+			{
+				return -1;
+			}
+		}
+
+		return -1;
+	}
+
+	/// <summary>
+	/// Makes a random input stream. Most ticks have no input, some have a few presses, like a real player mashing keys.
+	/// Some streams steer away from walls of body and towards the apple instead, since mashing alone rarely gets past
+	/// a few apples, and a few follow a path over every cell until the board is full, which is the only way to reach
+	/// the full board rule.
+	/// </summary>
+	/// <param name="seed">The game seed the stream will be played with.</param>
+	/// <param name="random">The generator to draw from.</param>
+	/// <param name="maxTicks">The longest the stream can run.</param>
+	/// <returns>Returns the stream.</returns>
+	static std::vector<SnakeInputStep> GenerateSteps(Uint32 seed, SnakeRandom& random, int maxTicks)
+	{
+		std::vector<SnakeInputStep> steps;
+
+		// the steering plays along on its own copy, it only ever looks at the optimized simulation to decide what to press.
+		SnakeSimulation shadow;
+		shadow.Reset(seed);
+		Uint32 steeringChance = random.Next() % 2 == 0 ? 0 : 90 + random.Next() % 11;
+		bool followCycle = random.Next() % 64 == 0;
+
+		if (followCycle)
+		{
+			// filling the board takes tens of thousands of ticks, the cycle ends by itself when it's full.
+			steeringChance = 100;
+			maxTicks = SDL_max(maxTicks, 200000);
+		}
+
+		for (int tick = 0; tick < maxTicks; tick++)
+		{
+			if (random.Next() % 100 < steeringChance)
+			{
+				SnakeInputStep step = followCycle ? FollowCycle(shadow) : Steer(shadow, random);
+
+				if (step != SnakeInputStep::TICK)
+				{
+					steps.push_back(step);
+					shadow.RequestDirection((SnakeDirection)step);
+				}
+			}
+			else
+			{
+				Uint32 roll = random.Next() % 100;
+				int presses = roll < 70 ? 0 : roll < 95 ? 1 : 1 + random.Next() % 3;
+
+				for (int i = 0; i < presses; i++)
+				{
+					SnakeInputStep step = (SnakeInputStep)(random.Next() % 4);
+					steps.push_back(step);
+					shadow.RequestDirection((SnakeDirection)step);
+				}
+			}
+
+			steps.push_back(SnakeInputStep::TICK);
+			shadow.Tick();
+
+			if (shadow.IsDead())
+			{
+				break;
+			}
+		}
+
+		return steps;
+	}
+
+	/// <summary>
+	/// Removes as much of a diverging stream as possible while keeping it diverging.
+	/// </summary>
+	/// <param name="seed">The game seed.</param>
+	/// <param name="steps">The diverging stream, shrunk in place.</param>
+	static void Shrink(Uint32 seed, std::vector<SnakeInputStep>& steps)
+	{
+		TruncateAfterDivergence(seed, steps);
+
+		// delta debugging: try cutting out chunks, halving the chunk size whenever nothing can go.
+		size_t chunk = steps.size() / 2;
+
+		while (chunk > 0)
+		{
+			bool removedAny = false;
+
+			for (size_t start = 0; start + chunk <= steps.size();)
+			{
+				std::vector<SnakeInputStep> candidate(steps.begin(), steps.begin() + start);
+				candidate.insert(candidate.end(), steps.begin() + start + chunk, steps.end());
+
+				if (FindDivergence(seed, candidate) != -1)
+				{
+					steps.swap(candidate);
+					TruncateAfterDivergence(seed, steps);
+					removedAny = true;
+				}
+				else
+				{
+					start += chunk;
+				}
+			}
+
+			if (!removedAny)
+			{
+				chunk /= 2;
+			}
+		}
+	}
+
+	/// <summary>
+	/// Runs the tester.
+	/// </summary>
+	/// <param name="streams">The number of random streams to try.</param>
+	/// <param name="firstSeed">The seed of the first stream, the rest count up from it.</param>
+	/// <param name="maxTicks">The longest a stream can run.</param>
+	/// <returns>Returns true if every stream matched.</returns>
+	static bool Run(Uint32 streams, Uint32 firstSeed, int maxTicks = 2000)
+	{
+		std::atomic<Uint32> nextStream(0);
+		std::atomic<bool> failed(false);
+		Uint32 failedSeed = 0;
+		std::vector<SnakeInputStep> failedSteps;
+
+		auto worker = [&]()
+		{
+			while (!failed)
+			{
+				Uint32 stream = nextStream++;
+				if (stream >= streams)
+				{
+					return;
+				}
+
+				Uint32 seed = firstSeed + stream;
+				SnakeRandom inputRandom(seed * 2654435761u + 1);
+				std::vector<SnakeInputStep> steps = GenerateSteps(seed, inputRandom, maxTicks);
+
+				if (FindDivergence(seed, steps) != -1 && !failed.exchange(true))
+				{
+					failedSeed = seed;
+					failedSteps.swap(steps);
+				}
+			}
+		};
+
+		Uint64 start = SDL_GetPerformanceCounter();
+
+		#ifdef CRISPY_OCTO_SPORK_THREADS
+		std::vector<std::thread> threads;
+		int threadCount = SDL_max(SDL_GetCPUCount(), 1);
+
+		for (int i = 0; i < threadCount; i++)
+		{
+			threads.push_back(std::thread(worker));
+		}
+
+		for (auto& thread : threads)
+		{
+			thread.join();
+		}
+		#else
+		worker();
+		#endif
+
+		double seconds = (double)(SDL_GetPerformanceCounter() - start) / (double)SDL_GetPerformanceFrequency();
+
+		if (!failed)
+		{
+			COS_LOG_INFO("Difftest passed: {} streams from seed {} in {} s", streams, firstSeed, seconds);
+			return true;
+		}
+
+		size_t originalSize = failedSteps.size();
+		Shrink(failedSeed, failedSteps);
+		Report(failedSeed, failedSteps, originalSize);
+		return false;
+	}
+
+private:
+	static bool ApplyStep(SnakeSimulation& simulation, SnakeReference& reference, SnakeInputStep step)
+	{
+		if (step == SnakeInputStep::TICK)
+		{
+			simulation.Tick();
+			reference.Tick();
+			return true;
+		}
+
+		// whether the press registered feeds input latency tracking, so it has to agree too.
+		return simulation.RequestDirection((SnakeDirection)step) == reference.RequestDirection((SnakeDirection)step);
+	}
+
+	static SnakeInputStep FollowCycle(const SnakeSimulation& simulation)
+	{
+		// down the even columns, up the odd ones, then back left along the top row. needs an even grid width.
+		int head = simulation.GetSegment(0);
+		int x = head % SnakeSimulation::GRID_WIDTH;
+		int y = head / SnakeSimulation::GRID_WIDTH;
+
+		if (y == 0)
+		{
+			return x > 0 ? SnakeInputStep::LEFT : SnakeInputStep::DOWN;
+		}
+
+		if (x % 2 == 0)
+		{
+			return y < SnakeSimulation::GRID_HEIGHT - 1 ? SnakeInputStep::DOWN : SnakeInputStep::RIGHT;
+		}
+
+		return y > 1 || x == SnakeSimulation::GRID_WIDTH - 1 ? SnakeInputStep::UP : SnakeInputStep::RIGHT;
+	}
+
+	static SnakeInputStep Steer(const SnakeSimulation& simulation, SnakeRandom& random)
+	{
+		int head = simulation.GetSegment(0);
+		int headX = head % SnakeSimulation::GRID_WIDTH;
+		int headY = head / SnakeSimulation::GRID_WIDTH;
+		int apple = simulation.GetAppleCell();
+		int bestDistance = SnakeSimulation::CELL_COUNT;
+		SnakeInputStep best = SnakeInputStep::TICK;
+
+		// start from a random direction so ties don't always break the same way.
+		int first = random.Next() % 4;
+
+		for (int i = 0; i < 4; i++)
+		{
+			int direction = (first + i) % 4;
+			int x = headX + (direction == 3) - (direction == 2);
+			int y = headY + (direction == 1) - (direction == 0);
+			x = (x + SnakeSimulation::GRID_WIDTH) % SnakeSimulation::GRID_WIDTH;
+			y = (y + SnakeSimulation::GRID_HEIGHT) % SnakeSimulation::GRID_HEIGHT;
+			int cell = y * SnakeSimulation::GRID_WIDTH + x;
+
+			// turning back on itself isn't allowed anyway.
+			if (cell == simulation.GetSegment(1) || simulation.IsOccupied(cell))
+			{
+				continue;
+			}
+
+			int distanceX = std::abs(x - apple % SnakeSimulation::GRID_WIDTH);
+			int distanceY = std::abs(y - apple / SnakeSimulation::GRID_WIDTH);
+			int distance = SDL_min(distanceX, SnakeSimulation::GRID_WIDTH - distanceX) + SDL_min(distanceY, SnakeSimulation::GRID_HEIGHT - distanceY);
+
+			if (distance < bestDistance)
+			{
+				bestDistance = distance;
+				best = (SnakeInputStep)direction;
+			}
+		}
+
+		return best;
+	}
+
+	static void TruncateAfterDivergence(Uint32 seed, std::vector<SnakeInputStep>& steps)
+	{
+		int divergence = FindDivergence(seed, steps);
+
+		if (divergence != -1)
+		{
+			steps.resize(divergence + 1);
+		}
+	}
+
+	static std::string DescribeSteps(const std::vector<SnakeInputStep>& steps)
+	{
+		const char* names[] = { "U", "D", "L", "R", "." };
+		std::string description;
+
+		for (auto step : steps)
+		{
+			description += names[(int)step];
+		}
+
+		return description;
+	}
+
+	static void Report(Uint32 seed, const std::vector<SnakeInputStep>& steps, size_t originalSize)
+	{
+		SnakeSimulation simulation;
+		SnakeReference reference;
+		simulation.Reset(seed);
+		reference.Reset(seed);
+
+		for (auto step : steps)
+		{
+			ApplyStep(simulation, reference, step);
+		}
+
+		std::string simulationBody;
+		for (int i = 0; i < simulation.GetLength(); i++)
+		{
+			int cell = simulation.GetSegment(i);
+			simulationBody += " " + std::to_string(cell % SnakeSimulation::GRID_WIDTH) + "," + std::to_string(cell / SnakeSimulation::GRID_WIDTH);
+		}
+
+		std::string referenceBody;
+		for (int i = 0; i < reference.tailLength; i++)
+		{
+			referenceBody += " " + std::to_string((int)reference.tail[i].x) + "," + std::to_string((int)reference.tail[i].y);
+		}
+
+		COS_LOG_ERR("Difftest diverged. Seed {}, shrunk from {} steps to {}: {}", seed, originalSize, steps.size(), DescribeSteps(steps));
+		COS_LOG_ERR("  optimized: apple {} score {} dead {} velocity {},{} body{}", simulation.GetAppleCell(), simulation.GetScore(), simulation.IsDead(),
+			simulation.GetXVelocity(), simulation.GetYVelocity(), simulationBody);
+		COS_LOG_ERR("  reference: apple {} score {} dead {} velocity {},{} body{}", (int)reference.appleY * SnakeSimulation::GRID_WIDTH + (int)reference.appleX,
+			reference.score, reference.dying, (int)reference.xVelocity, (int)reference.yVelocity, referenceBody);
+	}
+};
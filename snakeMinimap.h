@@ -0,0 +1,350 @@
+#pragma once
+#include "crispyOctoSporkEngine.h"
+#include "snakeSimulation.h"
+#include <vector>
+
+/// <summary>
+/// An overview of the board drawn from a pyramid of occupancy counts, where each level halves the one below it and a
+/// texel counts the body segments in its block of cells. A head advance or tail pop walks up the pyramid touching one
+/// count per level, so the minimap never has to scan the body, and only the texels of the level being shown that
+/// actually changed are uploaded to its streaming texture.
+/// </summary>
+class SnakeMinimap
+{
+public:
+	/// <summary>
+	/// Constructor.
+	/// </summary>
+	/// <param name="gridWidth">The width of the board in cells.</param>
+	/// <param name="gridHeight">The height of the board in cells.</param>
+	SnakeMinimap(int gridWidth = SnakeSimulation::GRID_WIDTH, int gridHeight = SnakeSimulation::GRID_HEIGHT)
+	{
+		this->gridWidth = gridWidth;
+		this->gridHeight = gridHeight;
+		this->renderer = NULL;
+		this->texture = NULL;
+		this->shownLevel = 0;
+		this->scale = 1;
+		this->appleCell = -1;
+		this->trackedTextureBytes = 0;
+
+		// halved and rounded up until a single texel covers the whole board.
+		int width = gridWidth;
+		int height = gridHeight;
+
+		while (true)
+		{
+			widths.push_back(width);
+			heights.push_back(height);
+			counts.push_back(std::vector<Uint16>(width * height, 0));
+
+			if (width == 1 && height == 1)
+			{
+				break;
+			}
+
+			width = (width + 1) / 2;
+			height = (height + 1) / 2;
+		}
+	}
+
+	~SnakeMinimap()
+	{
+		Free();
+	}
+
+	/// <summary>
+	/// Picks the finest level that fits in the given size and creates a texture for it.
+	/// </summary>
+	/// <param name="renderer">The renderer to create the texture with.</param>
+	/// <param name="maxWidth">The most screen pixels the minimap can take across.</param>
+	/// <param name="maxHeight">The most screen pixels the minimap can take down.</param>
+	/// <returns>Returns a boolean indicating success.</returns>
+	bool Create(CrispyOctoSpork::Renderer* renderer, int maxWidth, int maxHeight)
+	{
+		Free();
+
+		shownLevel = GetLevelCount() - 1;
+
+		for (int level = 0; level < GetLevelCount(); level++)
+		{
+			if (widths[level] <= maxWidth && heights[level] <= maxHeight)
+			{
+				shownLevel = level;
+				break;
+			}
+		}
+
+		// scaled up by whole pixels so every texel is the same size on screen.
+		scale = SDL_max(1, SDL_min(maxWidth / widths[shownLevel], maxHeight / heights[shownLevel]));
+
+		this->renderer = renderer;
+		texture = renderer->CreateTexture(SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_STREAMING, widths[shownLevel], heights[shownLevel]);
+
+		if (texture == NULL)
+		{
+			COS_LOG_ERR("Could not create the minimap texture: {}", SDL_GetError());
+			return false;
+		}
+
+		renderer->SetTextureBlendMode(texture, SDL_BLENDMODE_BLEND);
+		renderer->SetTextureScaleMode(texture, SDL_ScaleModeNearest);
+
+		trackedTextureBytes = (Sint64)widths[shownLevel] * heights[shownLevel] * 4;
+		CrispyOctoSpork::MemoryTracker::Get().AddExternal(CrispyOctoSpork::MemoryTag::TEXTURES, trackedTextureBytes);
+
+		MarkAllDirty();
+		return true;
+	}
+
+	/// <summary>
+	/// Destroys the texture.
+	/// </summary>
+	void Free()
+	{
+		if (texture != NULL)
+		{
+			renderer->DestroyTexture(texture);
+			CrispyOctoSpork::MemoryTracker::Get().RemoveExternal(CrispyOctoSpork::MemoryTag::TEXTURES, trackedTextureBytes);
+			texture = NULL;
+			trackedTextureBytes = 0;
+		}
+	}
+
+	/// <summary>
+	/// Recounts every level from the simulation. Needed after a reset, ticks after that go through OnTick.
+	/// </summary>
+	/// <param name="simulation">The simulation.</param>
+	void Rebuild(const SnakeSimulation& simulation)
+	{
+		for (auto& level : counts)
+		{
+			std::fill(level.begin(), level.end(), 0);
+		}
+
+		for (int i = 0; i < simulation.GetLength(); i++)
+		{
+			Change(simulation.GetSegment(i), 1);
+		}
+
+		appleCell = simulation.GetAppleCell();
+		MarkAllDirty();
+	}
+
+	/// <summary>
+	/// Catches up with a single tick.
+	/// </summary>
+	/// <param name="simulation">The simulation, after the tick.</param>
+	/// <param name="events">What the tick changed.</param>
+	void OnTick(const SnakeSimulation& simulation, const SnakeTickEvents& events)
+	{
+		Change(events.headCell, 1);
+
+		if (events.tailPopped)
+		{
+			Change(events.poppedCell, -1);
+		}
+
+		if (events.appleCell != appleCell)
+		{
+			MarkCellDirty(appleCell);
+			appleCell = events.appleCell;
+			MarkCellDirty(appleCell);
+		}
+	}
+
+	/// <summary>
+	/// Uploads whatever changed since the last call, then draws the minimap. It's part of the HUD, so it's placed in
+	/// screen space and ignores viewports.
+	/// </summary>
+	/// <param name="x">The left edge to draw at.</param>
+	/// <param name="y">The top edge to draw at.</param>
+	void Render(int x, int y)
+	{
+		if (texture == NULL)
+		{
+			return;
+		}
+
+		Upload();
+
+		// a backdrop so the empty parts of the board still read as board.
+		SDL_Rect destination = { x, y, widths[shownLevel] * scale, heights[shownLevel] * scale };
+		renderer->SetDrawBlendMode(SDL_BLENDMODE_BLEND);
+		renderer->SetDrawColor(0, 0, 0, 128);
+		renderer->FillRect(&destination);
+		renderer->Copy(texture, NULL, &destination);
+	}
+
+	/// <summary>
+	/// Gets the number of levels, where level 0 is one texel per cell and the last is a single texel.
+	/// </summary>
+	int GetLevelCount() const
+	{
+		return (int)counts.size();
+	}
+
+	/// <summary>
+	/// Gets the level picked by <see cref="Create"/>.
+	/// </summary>
+	int GetShownLevel() const
+	{
+		return shownLevel;
+	}
+
+	/// <summary>
+	/// Gets how many body segments are inside a texel of a level.
+	/// </summary>
+	int GetCount(int level, int x, int y) const
+	{
+		return counts[level][y * widths[level] + x];
+	}
+
+private:
+	static const Uint32 EMPTY_PIXEL = 0x00000000;
+	static const Uint32 APPLE_PIXEL = 0xFFDC3232;
+
+	// below this many dirty texels they're locked one at a time, above it the whole level goes up in one lock.
+	static const int FULL_UPLOAD_DIVISOR = 4;
+
+	CrispyOctoSpork::Renderer* renderer;
+	SDL_Texture* texture;
+	int gridWidth;
+	int gridHeight;
+	int shownLevel;
+	int scale;
+	int appleCell;
+	Sint64 trackedTextureBytes;
+	std::vector<int> widths;
+	std::vector<int> heights;
+	std::vector<std::vector<Uint16>> counts;
+	std::vector<int> dirtyTexels;
+	std::vector<bool> dirtyFlags;
+
+	/// <summary>
+	/// Adds or removes a segment from every level.
+	/// </summary>
+	void Change(int cell, int delta)
+	{
+		int x = cell % gridWidth;
+		int y = cell / gridWidth;
+
+		for (int level = 0; level < GetLevelCount(); level++)
+		{
+			counts[level][(y >> level) * widths[level] + (x >> level)] += delta;
+		}
+
+		MarkCellDirty(cell);
+	}
+
+	void MarkCellDirty(int cell)
+	{
+		if (cell < 0 || texture == NULL)
+		{
+			return;
+		}
+
+		int texel = ((cell / gridWidth) >> shownLevel) * widths[shownLevel] + ((cell % gridWidth) >> shownLevel);
+
+		if (!dirtyFlags[texel])
+		{
+			dirtyFlags[texel] = true;
+			dirtyTexels.push_back(texel);
+		}
+	}
+
+	void MarkAllDirty()
+	{
+		int texelCount = widths[shownLevel] * heights[shownLevel];
+		dirtyFlags.assign(texelCount, true);
+		dirtyTexels.clear();
+
+		for (int i = 0; i < texelCount; i++)
+		{
+			dirtyTexels.push_back(i);
+		}
+	}
+
+	/// <summary>
+	/// Gets the colour of a texel of the shown level: the apple if it's in there, otherwise green as opaque as the
+	/// block is full, with a floor so a lone segment in a big block still shows.
+	/// </summary>
+	Uint32 GetPixel(int texel)
+	{
+		int width = widths[shownLevel];
+		int tx = texel % width;
+		int ty = texel / width;
+
+		if (appleCell >= 0 && ((appleCell % gridWidth) >> shownLevel) == tx && ((appleCell / gridWidth) >> shownLevel) == ty)
+		{
+			return APPLE_PIXEL;
+		}
+
+		int count = counts[shownLevel][texel];
+
+		if (count == 0)
+		{
+			return EMPTY_PIXEL;
+		}
+
+		// blocks on the right and bottom edges can hang off the board, only the cells on it count.
+		int blockWidth = SDL_min(1 << shownLevel, gridWidth - (tx << shownLevel));
+		int blockHeight = SDL_min(1 << shownLevel, gridHeight - (ty << shownLevel));
+		int alpha = 96 + 159 * SDL_min(count, blockWidth * blockHeight) / (blockWidth * blockHeight);
+
+		return ((Uint32)alpha << 24) | 0x0050D060;
+	}
+
+	void Upload()
+	{
+		if (dirtyTexels.empty())
+		{
+			return;
+		}
+
+		int width = widths[shownLevel];
+		int height = heights[shownLevel];
+		void* pixels;
+		int pitch;
+
+		if ((int)dirtyTexels.size() > width * height / FULL_UPLOAD_DIVISOR)
+		{
+			SDL_Rect all = { 0, 0, width, height };
+
+			if (renderer->LockTexture(texture, &all, &pixels, &pitch) == 0)
+			{
+				for (int y = 0; y < height; y++)
+				{
+					Uint32* row = (Uint32*)((Uint8*)pixels + y * pitch);
+
+					for (int x = 0; x < width; x++)
+					{
+						row[x] = GetPixel(y * width + x);
+					}
+				}
+
+				renderer->UnlockTexture(texture);
+			}
+		}
+		else
+		{
+			for (int texel : dirtyTexels)
+			{
+				SDL_Rect area = { texel % width, texel / width, 1, 1 };
+
+				if (renderer->LockTexture(texture, &area, &pixels, &pitch) == 0)
+				{
+					*(Uint32*)pixels = GetPixel(texel);
+					renderer->UnlockTexture(texture);
+				}
+			}
+		}
+
+		for (int texel : dirtyTexels)
+		{
+			dirtyFlags[texel] = false;
+		}
+
+		dirtyTexels.clear();
+	}
+};
@@ -0,0 +1,105 @@
+#pragma once
+#include <SDL.h>
+#include <stddef.h>
+
+// messages go over tcp as the raw structs below. every platform the game runs on is little endian.
+
+const Uint16 SNAKE_DEFAULT_PORT = 7777;
+
+/// <summary>
+/// The first byte of every message, which also decides its size.
+/// </summary>
+enum class SnakeMessageType : Uint8
+{
+	JOIN = 1,
+	INPUT,
+	WELCOME,
+	STATE
+};
+
+/// <summary>
+/// Client to server. Starts a new game in the clients match, or restarts it after a death.
+/// </summary>
+struct SnakeJoinMessage
+{
+	Uint8 type;
+	Uint8 padding[3];
+	// 0 lets the server pick.
+	Uint32 seed;
+};
+
+/// <summary>
+/// Client to server. A direction request, applied on the next tick.
+/// </summary>
+struct SnakeInputMessage
+{
+	Uint8 type;
+	Uint8 direction;
+	Uint16 padding;
+	Uint32 sequence;
+	// whatever clock the client likes, it's echoed back in the next state so the client can time the round trip.
+	Uint64 sentTime;
+};
+
+/// <summary>
+/// Server to client. Sent in reply to a join.
+/// </summary>
+struct SnakeWelcomeMessage
+{
+	Uint8 type;
+	Uint8 padding[3];
+	Uint32 matchId;
+	Uint32 seed;
+	Uint32 tickMilliseconds;
+};
+
+/// <summary>
+/// Server to client. Sent after every tick of the clients match.
+/// </summary>
+struct SnakeStateMessage
+{
+	Uint8 type;
+	Uint8 flags;
+	Uint16 length;
+	Uint32 tick;
+	Uint16 headCell;
+	Uint16 appleCell;
+	Uint16 score;
+	Uint16 padding;
+	// the last input applied before this tick, and the time it was sent with.
+	Uint32 inputSequence;
+	// how far behind its schedule the server ran this tick.
+	Uint32 lateMicroseconds;
+	Uint64 inputSentTime;
+};
+
+const Uint8 SNAKE_STATE_DEAD = 1;
+const Uint8 SNAKE_STATE_ATE_APPLE = 2;
+const Uint8 SNAKE_STATE_BOARD_FULL = 4;
+
+static_assert(sizeof(SnakeJoinMessage) == 8, "Messages are sent as raw structs.");
+static_assert(sizeof(SnakeInputMessage) == 16, "Messages are sent as raw structs.");
+static_assert(sizeof(SnakeWelcomeMessage) == 16, "Messages are sent as raw structs.");
+static_assert(sizeof(SnakeStateMessage) == 32, "Messages are sent as raw structs.");
+
+/// <summary>
+/// Gets the size of a message from its first byte.
+/// </summary>
+/// <param name="type">The type byte.</param>
+/// <returns>Returns the size in bytes, or 0 if the type isn't valid.</returns>
+inline size_t GetSnakeMessageSize(Uint8 type)
+{
+	switch ((SnakeMessageType)type)
+	{
+	case SnakeMessageType::JOIN:
+		return sizeof(SnakeJoinMessage);
+	case SnakeMessageType::INPUT:
+		return sizeof(SnakeInputMessage);
+	case SnakeMessageType::WELCOME:
+		return sizeof(SnakeWelcomeMessage);
+	case SnakeMessageType::STATE:
+		return sizeof(SnakeStateMessage);
+	}
+
+	return 0;
+}
@@ -0,0 +1,923 @@
+#pragma once
+#include "crispyOctoSporkEngine.h"
+#include "snakeSimulation.h"
+#include "snakeProtocol.h"
+
+// the server is built on epoll, so it's linux only.
+#if defined(__linux__) && defined(CRISPY_OCTO_SPORK_THREADS)
+#define SNAKE_SERVER_AVAILABLE
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#include <string.h>
+#include <sys/resource.h>
+
+/// <summary>
+/// Hashed timer wheel with one millisecond slots. Scheduling and cancelling are constant time, and
+/// advancing only looks at the slots that have gone by, so a thousand matches ticking cost no more
+/// to keep track of than one.
+/// </summary>
+class SnakeTimerWheel
+{
+public:
+	/// <summary>
+	/// Lives inside whatever is being scheduled, so the wheel never allocates.
+	/// </summary>
+	struct Timer
+	{
+		Timer* next = NULL;
+		Timer* previous = NULL;
+		Uint64 deadline = 0;
+		int slot = 0;
+		bool scheduled = false;
+		void* owner = NULL;
+	};
+
+	static const int SLOT_COUNT = 512;
+	static const Uint64 RESOLUTION = 1000;
+
+	SnakeTimerWheel()
+	{
+		for (int i = 0; i < SLOT_COUNT; i++)
+		{
+			slots[i] = NULL;
+		}
+
+		currentSlot = 0;
+		count = 0;
+	}
+
+	/// <summary>
+	/// Starts the wheel at a time.
+	/// </summary>
+	/// <param name="now">The time in microseconds.</param>
+	void Start(Uint64 now)
+	{
+		currentSlot = now / RESOLUTION;
+	}
+
+	/// <summary>
+	/// Schedules a timer, moving it if it was already scheduled.
+	/// </summary>
+	/// <param name="timer">The timer.</param>
+	/// <param name="deadline">When it should fire in microseconds.</param>
+	void Schedule(Timer* timer, Uint64 deadline)
+	{
+		Cancel(timer);
+
+		// anything already due goes in the current slot, which gets looked at again on the next advance.
+		Uint64 slot = SDL_max(deadline / RESOLUTION, currentSlot);
+		Timer*& head = slots[slot % SLOT_COUNT];
+
+		timer->deadline = deadline;
+		timer->slot = (int)(slot % SLOT_COUNT);
+		timer->scheduled = true;
+		timer->previous = NULL;
+		timer->next = head;
+
+		if (head != NULL)
+		{
+			head->previous = timer;
+		}
+
+		head = timer;
+		count++;
+	}
+
+	/// <summary>
+	/// Unschedules a timer. Does nothing if it isn't scheduled.
+	/// </summary>
+	/// <param name="timer">The timer.</param>
+	void Cancel(Timer* timer)
+	{
+		if (!timer->scheduled)
+		{
+			return;
+		}
+
+		if (timer->previous != NULL)
+		{
+			timer->previous->next = timer->next;
+		}
+		else
+		{
+			slots[timer->slot] = timer->next;
+		}
+
+		if (timer->next != NULL)
+		{
+			timer->next->previous = timer->previous;
+		}
+
+		timer->next = NULL;
+		timer->previous = NULL;
+		timer->scheduled = false;
+		count--;
+	}
+
+	/// <summary>
+	/// Fires every timer that is due. Fired timers are unscheduled first, so they can be scheduled again from the callback.
+	/// </summary>
+	/// <param name="now">The time in microseconds.</param>
+	/// <param name="fire">Called with each timer that is due.</param>
+	template <typename Fire>
+	void Advance(Uint64 now, Fire fire)
+	{
+		Uint64 nowSlot = now / RESOLUTION;
+
+		// after a long stall one lap of the wheel covers every slot.
+		Uint64 slot = nowSlot - currentSlot >= (Uint64)SLOT_COUNT ? nowSlot - SLOT_COUNT + 1 : currentSlot;
+
+		for (; slot <= nowSlot; slot++)
+		{
+			currentSlot = slot;
+			Timer* timer = slots[slot % SLOT_COUNT];
+
+			while (timer != NULL)
+			{
+				Timer* next = timer->next;
+
+				// slots are shared by every lap, so later laps stay put.
+				if (timer->deadline <= now)
+				{
+					Cancel(timer);
+					fire(timer);
+				}
+
+				timer = next;
+			}
+		}
+	}
+
+	/// <summary>
+	/// Gets how long until the earliest scheduled timer is due.
+	/// </summary>
+	/// <param name="now">The time in microseconds.</param>
+	/// <returns>Returns milliseconds to wait, or -1 if nothing is scheduled.</returns>
+	int GetTimeout(Uint64 now)
+	{
+		if (count == 0)
+		{
+			return -1;
+		}
+
+		// a slot also holds timers for later in its millisecond and for later laps, so it's the deadlines that count,
+		// not whether the slot is empty. nothing in a slot can be due before the slot starts, so the walk stops there.
+		Uint64 earliest = (Uint64)-1;
+
+		for (Uint64 slot = currentSlot; slot < currentSlot + SLOT_COUNT && slot * RESOLUTION < earliest; slot++)
+		{
+			for (Timer* timer = slots[slot % SLOT_COUNT]; timer != NULL; timer = timer->next)
+			{
+				earliest = SDL_min(earliest, timer->deadline);
+			}
+		}
+
+		return earliest <= now ? 0 : (int)((earliest - now + RESOLUTION - 1) / RESOLUTION);
+	}
+
+	/// <summary>
+	/// Gets the number of scheduled timers.
+	/// </summary>
+	int GetCount()
+	{
+		return count;
+	}
+
+private:
+	Timer* slots[SLOT_COUNT];
+	Uint64 currentSlot;
+	int count;
+};
+
+/// <summary>
+/// Hosts thousands of single player snake matches in one process. A front end thread accepts connections and
+/// hands each to the least loaded of a fixed pool of workers. Each worker owns its matches outright, with its
+/// own epoll set, timer wheel and arenas, so workers never share anything and capacity grows with the cores.
+/// A match only sits on the wheel while its snake is alive, so idle and finished matches cost nothing.
+/// </summary>
+class SnakeServer
+{
+public:
+	static const Uint32 TICK_MICROSECONDS = 100000;
+	static const int SEND_BUFFER_SIZE = 4096;
+	static const int MAX_EVENTS = 256;
+
+	SnakeServer()
+	{
+		listenSocket = -1;
+		wakeDescriptor = -1;
+		running = false;
+	}
+
+	~SnakeServer()
+	{
+		Stop();
+		Wait();
+	}
+
+	/// <summary>
+	/// Starts listening and starts the workers.
+	/// </summary>
+	/// <param name="port">The port to listen on.</param>
+	/// <param name="workerCount">The number of worker threads, 0 for one per core.</param>
+	/// <returns>Returns false if the server couldn't start.</returns>
+	bool Start(Uint16 port, int workerCount = 0)
+	{
+		RaiseFileLimit();
+		listenSocket = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+
+		if (listenSocket < 0)
+		{
+			COS_LOG_ERR("Couldn't create the server socket: {}", strerror(errno));
+			return false;
+		}
+
+		int reuse = 1;
+		setsockopt(listenSocket, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+
+		sockaddr_in address = {};
+		address.sin_family = AF_INET;
+		address.sin_port = htons(port);
+		address.sin_addr.s_addr = htonl(INADDR_ANY);
+
+		if (bind(listenSocket, (sockaddr*)&address, sizeof(address)) < 0 || listen(listenSocket, SOMAXCONN) < 0)
+		{
+			COS_LOG_ERR("Couldn't listen on port {}: {}", port, strerror(errno));
+			close(listenSocket);
+			listenSocket = -1;
+			return false;
+		}
+
+		wakeDescriptor = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+		running = true;
+
+		workerCount = workerCount > 0 ? workerCount : SDL_max(SDL_GetCPUCount(), 1);
+
+		for (int i = 0; i < workerCount; i++)
+		{
+			workers.push_back(std::unique_ptr<Worker>(new Worker(this, (Uint32)i)));
+		}
+
+		for (auto& worker : workers)
+		{
+			worker->Start();
+		}
+
+		frontEnd = std::thread([this]() { FrontEndLoop(); });
+
+		COS_LOG_INFO("Snake server listening on port {} with {} workers", port, workerCount);
+		return true;
+	}
+
+	/// <summary>
+	/// Asks every thread to stop. Safe to call from a signal handler.
+	/// </summary>
+	void Stop()
+	{
+		running = false;
+
+		Uint64 one = 1;
+		if (wakeDescriptor >= 0 && write(wakeDescriptor, &one, sizeof(one)) < 0)
+		{
+			// nothing to do, the threads check running on their next wake up anyway.
+		}
+
+		for (auto& worker : workers)
+		{
+			worker->Wake();
+		}
+	}
+
+	/// <summary>
+	/// Blocks until the server has stopped, then closes every connection.
+	/// </summary>
+	void Wait()
+	{
+		if (frontEnd.joinable())
+		{
+			frontEnd.join();
+		}
+
+		for (auto& worker : workers)
+		{
+			worker->Join();
+		}
+
+		workers.clear();
+
+		if (listenSocket >= 0)
+		{
+			close(listenSocket);
+			listenSocket = -1;
+		}
+
+		if (wakeDescriptor >= 0)
+		{
+			close(wakeDescriptor);
+			wakeDescriptor = -1;
+		}
+	}
+
+	/// <summary>
+	/// Gets a clock in microseconds that every thread agrees on.
+	/// </summary>
+	static Uint64 GetMicroseconds()
+	{
+		return (Uint64)(SDL_GetPerformanceCounter() * (1000000.0 / (double)SDL_GetPerformanceFrequency()));
+	}
+
+	/// <summary>
+	/// Lifts the open file limit as high as the system allows. The default of 1024 is nowhere near a socket per match.
+	/// </summary>
+	static void RaiseFileLimit()
+	{
+		rlimit limit;
+
+		if (getrlimit(RLIMIT_NOFILE, &limit) == 0 && limit.rlim_cur < limit.rlim_max)
+		{
+			limit.rlim_cur = limit.rlim_max;
+			setrlimit(RLIMIT_NOFILE, &limit);
+		}
+	}
+
+private:
+	/// <summary>
+	/// One connection and its game. Lives at the start of its own arena, along with its send buffer.
+	/// </summary>
+	struct Match
+	{
+		SnakeTimerWheel::Timer timer;
+		SnakeSimulation simulation;
+		CrispyOctoSpork::Arena* arena;
+		int socket;
+		Uint32 id;
+		Uint32 seed;
+		Uint32 tick;
+		Uint32 inputSequence;
+		Uint64 inputSentTime;
+		bool playing;
+		bool closing;
+		bool waitingToSend;
+		Uint8 received[sizeof(SnakeInputMessage)];
+		Uint32 receivedSize;
+		Uint8* sendBuffer;
+		Uint32 sendSize;
+	};
+
+	class Worker
+	{
+	public:
+		Worker(SnakeServer* server, Uint32 index)
+		{
+			this->server = server;
+			this->index = index;
+			this->epollDescriptor = epoll_create1(EPOLL_CLOEXEC);
+			this->wakeDescriptor = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+			this->nextMatchId = 1;
+			this->random.Seed((Uint32)SDL_GetPerformanceCounter() ^ (index * 2654435761u));
+			this->matchCount = 0;
+			this->playingCount = 0;
+			this->ticks = 0;
+
+			epoll_event event = {};
+			event.events = EPOLLIN;
+			event.data.ptr = NULL;
+			epoll_ctl(epollDescriptor, EPOLL_CTL_ADD, wakeDescriptor, &event);
+		}
+
+		~Worker()
+		{
+			for (CrispyOctoSpork::Arena* arena : freeArenas)
+			{
+				delete arena;
+			}
+
+			close(epollDescriptor);
+			close(wakeDescriptor);
+		}
+
+		void Start()
+		{
+			wheel.Start(GetMicroseconds());
+			thread = std::thread([this]() { Loop(); });
+		}
+
+		void Join()
+		{
+			if (thread.joinable())
+			{
+				thread.join();
+			}
+		}
+
+		void Wake()
+		{
+			Uint64 one = 1;
+			if (write(wakeDescriptor, &one, sizeof(one)) < 0)
+			{
+				// the counter only fails when it's full, and then the worker is already awake.
+			}
+		}
+
+		/// <summary>
+		/// Hands a freshly accepted connection to the worker. Called from the front end.
+		/// </summary>
+		void Hand(int socket)
+		{
+			{
+				std::lock_guard<std::mutex> lock(handoffMutex);
+				handoff.push_back(socket);
+			}
+
+			matchCount++;
+			Wake();
+		}
+
+		std::atomic<Uint32> matchCount;
+		std::atomic<Uint32> playingCount;
+		std::atomic<Uint64> ticks;
+
+	private:
+		SnakeServer* server;
+		Uint32 index;
+		int epollDescriptor;
+		int wakeDescriptor;
+		std::thread thread;
+		std::mutex handoffMutex;
+		std::vector<int> handoff;
+		SnakeTimerWheel wheel;
+		std::vector<CrispyOctoSpork::Arena*> freeArenas;
+		std::vector<Match*> matches;
+		std::vector<Match*> closed;
+		Uint32 nextMatchId;
+		SnakeRandom random;
+
+		void Loop()
+		{
+			epoll_event events[MAX_EVENTS];
+
+			while (server->running)
+			{
+				int eventCount = epoll_wait(epollDescriptor, events, MAX_EVENTS, wheel.GetTimeout(GetMicroseconds()));
+
+				for (int i = 0; i < eventCount; i++)
+				{
+					Match* match = (Match*)events[i].data.ptr;
+
+					if (match == NULL)
+					{
+						TakeHandoff();
+						continue;
+					}
+
+					if (match->closing)
+					{
+						continue;
+					}
+
+					if ((events[i].events & (EPOLLHUP | EPOLLERR)) != 0)
+					{
+						CloseMatch(match);
+						continue;
+					}
+
+					if ((events[i].events & EPOLLIN) != 0)
+					{
+						Receive(match);
+					}
+
+					if ((events[i].events & EPOLLOUT) != 0 && !match->closing)
+					{
+						Flush(match);
+					}
+				}
+
+				Uint64 now = GetMicroseconds();
+				wheel.Advance(now, [this, now](SnakeTimerWheel::Timer* timer)
+				{
+					TickMatch((Match*)timer->owner, now);
+				});
+
+				FreeClosedMatches();
+			}
+
+			for (Match* match : matches)
+			{
+				CloseMatch(match);
+			}
+
+			FreeClosedMatches();
+		}
+
+		void TakeHandoff()
+		{
+			Uint64 counter;
+			if (read(wakeDescriptor, &counter, sizeof(counter)) < 0)
+			{
+				// already drained.
+			}
+
+			std::vector<int> sockets;
+			{
+				std::lock_guard<std::mutex> lock(handoffMutex);
+				sockets.swap(handoff);
+			}
+
+			for (int socket : sockets)
+			{
+				OpenMatch(socket);
+			}
+		}
+
+		void OpenMatch(int socket)
+		{
+			// arenas are recycled, so a worker stops allocating once it has seen its busiest moment.
+			CrispyOctoSpork::Arena* arena;
+
+			if (!freeArenas.empty())
+			{
+				arena = freeArenas.back();
+				freeArenas.pop_back();
+			}
+			else
+			{
+				arena = new CrispyOctoSpork::Arena(sizeof(Match) + SEND_BUFFER_SIZE + 256, CrispyOctoSpork::MemoryTag::SERVER);
+			}
+
+			Match* match = arena->New<Match>();
+			Uint8* sendBuffer = match != NULL ? (Uint8*)arena->Allocate(SEND_BUFFER_SIZE) : NULL;
+
+			if (sendBuffer == NULL)
+			{
+				COS_LOG_ERR("Out of memory for a new match, dropping the connection");
+				arena->Reset();
+				freeArenas.push_back(arena);
+				close(socket);
+				return;
+			}
+
+			match->timer.owner = match;
+			match->arena = arena;
+			match->socket = socket;
+			match->id = (nextMatchId++ << 8) | (index & 0xFF);
+			match->seed = 0;
+			match->tick = 0;
+			match->inputSequence = 0;
+			match->inputSentTime = 0;
+			match->playing = false;
+			match->closing = false;
+			match->waitingToSend = false;
+			match->receivedSize = 0;
+			match->sendBuffer = sendBuffer;
+			match->sendSize = 0;
+			matches.push_back(match);
+
+			epoll_event event = {};
+			event.events = EPOLLIN | EPOLLRDHUP;
+			event.data.ptr = match;
+
+			if (epoll_ctl(epollDescriptor, EPOLL_CTL_ADD, socket, &event) < 0)
+			{
+				CloseMatch(match);
+			}
+		}
+
+		void CloseMatch(Match* match)
+		{
+			if (match->closing)
+			{
+				return;
+			}
+
+			// the memory is only given back once this round of events is done, in case another event points at it.
+			match->closing = true;
+			wheel.Cancel(&match->timer);
+			epoll_ctl(epollDescriptor, EPOLL_CTL_DEL, match->socket, NULL);
+			close(match->socket);
+			closed.push_back(match);
+		}
+
+		void FreeClosedMatches()
+		{
+			for (Match* match : closed)
+			{
+				if (match->playing)
+				{
+					playingCount--;
+				}
+
+				matches.erase(std::find(matches.begin(), matches.end(), match));
+				match->arena->Reset();
+				freeArenas.push_back(match->arena);
+				matchCount--;
+			}
+
+			closed.clear();
+		}
+
+		void Receive(Match* match)
+		{
+			Uint8 buffer[2048];
+
+			while (true)
+			{
+				ssize_t size = recv(match->socket, buffer, sizeof(buffer), 0);
+
+				if (size == 0 || (size < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR))
+				{
+					CloseMatch(match);
+					return;
+				}
+
+				if (size < 0)
+				{
+					return;
+				}
+
+				for (ssize_t i = 0; i < size && !match->closing; i++)
+				{
+					match->received[match->receivedSize++] = buffer[i];
+					size_t messageSize = GetSnakeMessageSize(match->received[0]);
+
+					if (messageSize == 0 || messageSize > sizeof(match->received))
+					{
+						CloseMatch(match);
+						return;
+					}
+
+					if (match->receivedSize == messageSize)
+					{
+						HandleMessage(match);
+						match->receivedSize = 0;
+					}
+				}
+
+				// the socket is closed now, and the front end may already have handed its number to a new connection.
+				if (match->closing)
+				{
+					return;
+				}
+			}
+		}
+
+		void HandleMessage(Match* match)
+		{
+			switch ((SnakeMessageType)match->received[0])
+			{
+			case SnakeMessageType::JOIN:
+			{
+				SnakeJoinMessage join;
+				SDL_memcpy(&join, match->received, sizeof(join));
+
+				match->seed = join.seed != 0 ? join.seed : random.Next();
+				match->simulation.Reset(match->seed);
+				match->tick = 0;
+
+				if (!match->playing)
+				{
+					match->playing = true;
+					playingCount++;
+				}
+
+				SnakeWelcomeMessage welcome = {};
+				welcome.type = (Uint8)SnakeMessageType::WELCOME;
+				welcome.matchId = match->id;
+				welcome.seed = match->seed;
+				welcome.tickMilliseconds = TICK_MICROSECONDS / 1000;
+				Send(match, &welcome, sizeof(welcome));
+
+				// a client spamming joins without reading can overflow its buffer, and a closed match must stay off the wheel.
+				if (match->closing)
+				{
+					break;
+				}
+
+				wheel.Schedule(&match->timer, GetMicroseconds() + TICK_MICROSECONDS);
+				break;
+			}
+			case SnakeMessageType::INPUT:
+			{
+				SnakeInputMessage input;
+				SDL_memcpy(&input, match->received, sizeof(input));
+
+				if (match->playing && input.direction <= (Uint8)SnakeDirection::RIGHT)
+				{
+					match->simulation.RequestDirection((SnakeDirection)input.direction);
+					match->inputSequence = input.sequence;
+					match->inputSentTime = input.sentTime;
+				}
+				break;
+			}
+			default:
+				// only the server sends the rest.
+				CloseMatch(match);
+				break;
+			}
+		}
+
+		void TickMatch(Match* match, Uint64 now)
+		{
+			SnakeTickEvents events = match->simulation.Tick();
+			match->tick++;
+			ticks.fetch_add(1, std::memory_order_relaxed);
+
+			Uint64 deadline = match->timer.deadline;
+
+			SnakeStateMessage state = {};
+			state.type = (Uint8)SnakeMessageType::STATE;
+			state.flags = (events.died ? SNAKE_STATE_DEAD : 0) | (events.ateApple ? SNAKE_STATE_ATE_APPLE : 0) | (events.boardFull ? SNAKE_STATE_BOARD_FULL : 0);
+			state.length = (Uint16)match->simulation.GetLength();
+			state.tick = match->tick;
+			state.headCell = (Uint16)events.headCell;
+			state.appleCell = (Uint16)events.appleCell;
+			state.score = (Uint16)match->simulation.GetScore();
+			state.inputSequence = match->inputSequence;
+			state.lateMicroseconds = (Uint32)SDL_min(now - deadline, (Uint64)0xFFFFFFFF);
+			state.inputSentTime = match->inputSentTime;
+			Send(match, &state, sizeof(state));
+
+			if (match->closing)
+			{
+				return;
+			}
+
+			// a dead snake leaves the wheel until the client joins again.
+			if (events.died)
+			{
+				match->playing = false;
+				playingCount--;
+				return;
+			}
+
+			// keep to the original schedule so ticks don't drift, unless the worker has fallen too far behind to catch up.
+			Uint64 next = deadline + TICK_MICROSECONDS;
+			wheel.Schedule(&match->timer, now > next + TICK_MICROSECONDS * 10 ? now + TICK_MICROSECONDS : next);
+		}
+
+		void Send(Match* match, const void* message, size_t size)
+		{
+			if (match->sendSize + size > (size_t)SEND_BUFFER_SIZE)
+			{
+				COS_LOG_WARN("Dropping match {}, the client isn't keeping up", match->id);
+				CloseMatch(match);
+				return;
+			}
+
+			SDL_memcpy(match->sendBuffer + match->sendSize, message, size);
+			match->sendSize += (Uint32)size;
+
+			// if there's already a backlog, epoll says when it can go.
+			if (!match->waitingToSend)
+			{
+				Flush(match);
+			}
+		}
+
+		void Flush(Match* match)
+		{
+			Uint32 sent = 0;
+
+			while (sent < match->sendSize)
+			{
+				ssize_t size = send(match->socket, match->sendBuffer + sent, match->sendSize - sent, MSG_NOSIGNAL);
+
+				if (size < 0)
+				{
+					if (errno == EAGAIN || errno == EWOULDBLOCK)
+					{
+						break;
+					}
+
+					if (errno == EINTR)
+					{
+						continue;
+					}
+
+					CloseMatch(match);
+					return;
+				}
+
+				sent += (Uint32)size;
+			}
+
+			SDL_memmove(match->sendBuffer, match->sendBuffer + sent, match->sendSize - sent);
+			match->sendSize -= sent;
+
+			bool waitingToSend = match->sendSize > 0;
+
+			if (waitingToSend != match->waitingToSend)
+			{
+				match->waitingToSend = waitingToSend;
+
+				epoll_event event = {};
+				event.events = EPOLLIN | EPOLLRDHUP | (waitingToSend ? (Uint32)EPOLLOUT : 0u);
+				event.data.ptr = match;
+				epoll_ctl(epollDescriptor, EPOLL_CTL_MOD, match->socket, &event);
+			}
+		}
+	};
+
+	void FrontEndLoop()
+	{
+		int epollDescriptor = epoll_create1(EPOLL_CLOEXEC);
+
+		epoll_event event = {};
+		event.events = EPOLLIN;
+		event.data.fd = listenSocket;
+		epoll_ctl(epollDescriptor, EPOLL_CTL_ADD, listenSocket, &event);
+
+		event.data.fd = wakeDescriptor;
+		epoll_ctl(epollDescriptor, EPOLL_CTL_ADD, wakeDescriptor, &event);
+
+		Uint64 lastReport = GetMicroseconds();
+		Uint64 lastTicks = 0;
+
+		while (running)
+		{
+			epoll_event events[16];
+			int eventCount = epoll_wait(epollDescriptor, events, 16, 1000);
+
+			for (int i = 0; i < eventCount; i++)
+			{
+				if (events[i].data.fd == listenSocket)
+				{
+					Accept();
+				}
+			}
+
+			Uint64 now = GetMicroseconds();
+
+			if (now - lastReport >= 5000000)
+			{
+				Uint32 matches = 0;
+				Uint32 playing = 0;
+				Uint64 ticks = 0;
+
+				for (auto& worker : workers)
+				{
+					matches += worker->matchCount;
+					playing += worker->playingCount;
+					ticks += worker->ticks;
+				}
+
+				COS_LOG_INFO("Server: {} matches, {} playing, {} ticks/s", matches, playing, (ticks - lastTicks) * 1000000.0 / (now - lastReport));
+				lastReport = now;
+				lastTicks = ticks;
+			}
+		}
+
+		close(epollDescriptor);
+	}
+
+	void Accept()
+	{
+		while (true)
+		{
+			int socket = accept4(listenSocket, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+
+			if (socket < 0)
+			{
+				if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)
+				{
+					COS_LOG_ERR("Couldn't accept a connection: {}", strerror(errno));
+				}
+
+				if (errno != EINTR)
+				{
+					return;
+				}
+
+				continue;
+			}
+
+			// state messages are tiny and time sensitive, so don't let them sit waiting to be batched.
+			int noDelay = 1;
+			setsockopt(socket, IPPROTO_TCP, TCP_NODELAY, &noDelay, sizeof(noDelay));
+
+			Worker* leastLoaded = workers[0].get();
+
+			for (auto& worker : workers)
+			{
+				if (worker->matchCount < leastLoaded->matchCount)
+				{
+					leastLoaded = worker.get();
+				}
+			}
+
+			leastLoaded->Hand(socket);
+		}
+	}
+
+	int listenSocket;
+	int wakeDescriptor;
+	std::atomic<bool> running;
+	std::thread frontEnd;
+	std::vector<std::unique_ptr<Worker>> workers;
+};
+#endif
@@ -0,0 +1,362 @@
+#pragma once
+#include <SDL.h>
+
+/// <summary>
+/// The directions the snake can be pointed in.
+/// </summary>
+enum class SnakeDirection
+{
+	UP,
+	DOWN,
+	LEFT,
+	RIGHT
+};
+
+/// <summary>
+/// Small xorshift generator so a seed alone decides every apple in a game.
+/// </summary>
+class SnakeRandom
+{
+public:
+	SnakeRandom(Uint32 seed = 1)
+	{
+		Seed(seed);
+	}
+
+	void Seed(Uint32 seed)
+	{
+		// xorshift gets stuck on zero.
+		state = seed != 0 ? seed : 0x9E3779B9;
+	}
+
+	Uint32 Next()
+	{
+		state ^= state << 13;
+		state ^= state >> 17;
+		state ^= state << 5;
+		return state;
+	}
+
+private:
+	Uint32 state;
+};
+
+/// <summary>
+/// What changed in a single <see cref="SnakeSimulation::Tick"/>, so renderers can update incrementally.
+/// </summary>
+struct SnakeTickEvents
+{
+	bool died;
+	bool boardFull;
+	bool ateApple;
+	bool tailPopped;
+	int headCell;
+	int poppedCell;
+	int appleCell;
+};
+
+/// <summary>
+/// The rules of snake with no rendering or timing. The body lives in a fixed ring buffer with an occupancy grid
+/// next to it, so collision and apple placement checks are constant time instead of a walk over the tail.
+/// </summary>
+class SnakeSimulation
+{
+public:
+	static const int GRID_WIDTH = 20;
+	static const int GRID_HEIGHT = 15;
+	static const int CELL_COUNT = GRID_WIDTH * GRID_HEIGHT;
+	static const int STARTING_LENGTH = 6;
+
+	SnakeSimulation()
+	{
+		Reset(1);
+	}
+
+	/// <summary>
+	/// Starts a new game.
+	/// </summary>
+	/// <param name="seed">Decides where every apple goes.</param>
+	void Reset(Uint32 seed)
+	{
+		random.Seed(seed);
+		head = 0;
+		length = 0;
+		occupiedCells = 0;
+		score = 0;
+		dead = false;
+		xVelocity = 1;
+		yVelocity = 0;
+
+		for (int i = 0; i < CELL_COUNT; i++)
+		{
+			occupancy[i] = 0;
+		}
+
+		// laid out head first, trailing off to the left of where the head starts.
+		for (int i = 0; i < STARTING_LENGTH; i++)
+		{
+			int cell = 8 * GRID_WIDTH + (8 - i);
+			ring[(head + i) & RING_MASK] = (Uint16)cell;
+			Occupy(cell);
+		}
+
+		length = STARTING_LENGTH;
+
+		// the first apple is allowed to land on the snake.
+		appleX = random.Next() % GRID_WIDTH;
+		appleY = random.Next() % GRID_HEIGHT;
+	}
+
+	/// <summary>
+	/// Points the snake in a new direction, unless that would turn it straight back on itself.
+	/// Can be called any number of times between ticks.
+	/// </summary>
+	/// <param name="direction">The direction.</param>
+	/// <returns>Returns true if the snake changed direction.</returns>
+	bool RequestDirection(SnakeDirection direction)
+	{
+		int newX = 0;
+		int newY = 0;
+
+		switch (direction)
+		{
+		case SnakeDirection::UP:
+			newY = -1;
+			break;
+		case SnakeDirection::DOWN:
+			newY = 1;
+			break;
+		case SnakeDirection::LEFT:
+			newX = -1;
+			break;
+		case SnakeDirection::RIGHT:
+			newX = 1;
+			break;
+		}
+
+		if (dead || (newX == -xVelocity && newY == -yVelocity) || (newX == xVelocity && newY == yVelocity))
+		{
+			return false;
+		}
+
+		xVelocity = newX;
+		yVelocity = newY;
+		return true;
+	}
+
+	/// <summary>
+	/// Moves the snake one cell.
+	/// </summary>
+	/// <returns>Returns what changed.</returns>
+	SnakeTickEvents Tick()
+	{
+		SnakeTickEvents events = { false, false, false, false, -1, -1, -1 };
+
+		int headCell = ring[head];
+		int newHeadX = headCell % GRID_WIDTH + xVelocity;
+		int newHeadY = headCell / GRID_WIDTH + yVelocity;
+
+		if (newHeadX > GRID_WIDTH - 1)
+		{
+			newHeadX = 0;
+		}
+
+		if (newHeadX < 0)
+		{
+			newHeadX = GRID_WIDTH - 1;
+		}
+
+		if (newHeadY > GRID_HEIGHT - 1)
+		{
+			newHeadY = 0;
+		}
+
+		if (newHeadY < 0)
+		{
+			newHeadY = GRID_HEIGHT - 1;
+		}
+
+		int newHeadCell = newHeadY * GRID_WIDTH + newHeadX;
+
+		// checked before the tail moves, so following right behind the tail end is still a collision.
+		if (occupancy[newHeadCell] > 0)
+		{
+			dead = true;
+			events.died = true;
+		}
+
+		head = (head - 1) & RING_MASK;
+		ring[head] = (Uint16)newHeadCell;
+		length++;
+		Occupy(newHeadCell);
+		events.headCell = newHeadCell;
+
+		if (newHeadX == appleX && newHeadY == appleY)
+		{
+			score++;
+			events.ateApple = true;
+
+			// the tail end isn't popped when eating, but the old placement check never looked at it, so neither do we.
+			int lastCell = ring[(head + length - 1) & RING_MASK];
+			int freeCells = CELL_COUNT - occupiedCells + (occupancy[lastCell] == 1 ? 1 : 0);
+
+			if (freeCells == 0)
+			{
+				// the board is full, there's nowhere left for an apple.
+				dead = true;
+				events.died = true;
+				events.boardFull = true;
+			}
+			else
+			{
+				while (true)
+				{
+					appleX = random.Next() % GRID_WIDTH;
+					appleY = random.Next() % GRID_HEIGHT;
+
+					int appleCell = appleY * GRID_WIDTH + appleX;
+					int occupants = occupancy[appleCell] - (appleCell == lastCell ? 1 : 0);
+
+					if (occupants == 0)
+					{
+						break;
+					}
+				}
+			}
+		}
+		else
+		{
+			int tailCell = ring[(head + length - 1) & RING_MASK];
+			Vacate(tailCell);
+			length--;
+			events.tailPopped = true;
+			events.poppedCell = tailCell;
+		}
+
+		events.appleCell = appleY * GRID_WIDTH + appleX;
+		return events;
+	}
+
+	/// <summary>
+	/// Gets the number of body segments, head included.
+	/// </summary>
+	int GetLength() const
+	{
+		return length;
+	}
+
+	/// <summary>
+	/// Gets the cell of a body segment, where 0 is the head. Cells are y * GRID_WIDTH + x.
+	/// </summary>
+	int GetSegment(int index) const
+	{
+		return ring[(head + index) & RING_MASK];
+	}
+
+	/// <summary>
+	/// Gets whether any part of the body is on a cell.
+	/// </summary>
+	bool IsOccupied(int cell) const
+	{
+		return occupancy[cell] > 0;
+	}
+
+	int GetAppleCell() const
+	{
+		return appleY * GRID_WIDTH + appleX;
+	}
+
+	int GetScore() const
+	{
+		return score;
+	}
+
+	bool IsDead() const
+	{
+		return dead;
+	}
+
+	int GetXVelocity() const
+	{
+		return xVelocity;
+	}
+
+	int GetYVelocity() const
+	{
+		return yVelocity;
+	}
+
+	/// <summary>
+	/// Hashes everything that decides how the game plays out from here.
+	/// </summary>
+	/// <returns>Returns the hash.</returns>
+	Uint64 Hash() const
+	{
+		Uint64 hash = HashStart();
+		hash = HashValue(hash, length);
+
+		for (int i = 0; i < length; i++)
+		{
+			hash = HashValue(hash, GetSegment(i));
+		}
+
+		hash = HashValue(hash, xVelocity);
+		hash = HashValue(hash, yVelocity);
+		hash = HashValue(hash, GetAppleCell());
+		hash = HashValue(hash, score);
+		return HashValue(hash, dead ? 1 : 0);
+	}
+
+	/// <summary>
+	/// FNV-1a over 32 bit values, shared with anything that needs to produce the same hash.
+	/// </summary>
+	static Uint64 HashStart()
+	{
+		return 14695981039346656037ull;
+	}
+
+	static Uint64 HashValue(Uint64 hash, Sint32 value)
+	{
+		for (int i = 0; i < 4; i++)
+		{
+			hash ^= (Uint8)(value >> (i * 8));
+			hash *= 1099511628211ull;
+		}
+
+		return hash;
+	}
+
+private:
+	// a power of two bigger than the longest the snake can get.
+	static const int RING_SIZE = 512;
+	static const int RING_MASK = RING_SIZE - 1;
+
+	Uint16 ring[RING_SIZE];
+	Uint16 occupancy[CELL_COUNT];
+	int head;
+	int length;
+	int occupiedCells;
+	int xVelocity;
+	int yVelocity;
+	int appleX;
+	int appleY;
+	int score;
+	bool dead;
+	SnakeRandom random;
+
+	void Occupy(int cell)
+	{
+		if (occupancy[cell]++ == 0)
+		{
+			occupiedCells++;
+		}
+	}
+
+	void Vacate(int cell)
+	{
+		if (--occupancy[cell] == 0)
+		{
+			occupiedCells--;
+		}
+	}
+};
@@ -0,0 +1,541 @@
+#pragma once
+#include "snakeServer.h"
+
+#ifdef SNAKE_SERVER_AVAILABLE
+#include <arpa/inet.h>
+
+/// <summary>
+/// Plays a bot client in place of the keyboard handling in SnakeGame::OnEventPlaying.
+/// </summary>
+class SnakeBotController
+{
+public:
+	virtual ~SnakeBotController() {}
+
+	/// <summary>
+	/// Called with every state the server sends.
+	/// </summary>
+	/// <param name="state">The state.</param>
+	/// <param name="direction">The direction to press.</param>
+	/// <returns>Returns true to press a direction this tick.</returns>
+	virtual bool OnState(const SnakeStateMessage& state, SnakeDirection& direction) = 0;
+};
+
+/// <summary>
+/// Mashes a random direction now and then.
+/// </summary>
+class RandomBotController : public SnakeBotController
+{
+public:
+	RandomBotController(Uint32 seed) : random(seed) {}
+
+	bool OnState(const SnakeStateMessage& state, SnakeDirection& direction) override
+	{
+		if (random.Next() % 100 >= 20)
+		{
+			return false;
+		}
+
+		direction = (SnakeDirection)(random.Next() % 4);
+		return true;
+	}
+
+private:
+	SnakeRandom random;
+};
+
+/// <summary>
+/// Heads straight for the apple, lining up on x first. Only sees the head, so it runs into itself sooner or later.
+/// </summary>
+class AppleBotController : public SnakeBotController
+{
+public:
+	bool OnState(const SnakeStateMessage& state, SnakeDirection& direction) override
+	{
+		int headX = state.headCell % SnakeSimulation::GRID_WIDTH;
+		int headY = state.headCell / SnakeSimulation::GRID_WIDTH;
+		int appleX = state.appleCell % SnakeSimulation::GRID_WIDTH;
+		int appleY = state.appleCell / SnakeSimulation::GRID_WIDTH;
+
+		if (headX != appleX)
+		{
+			direction = headX < appleX ? SnakeDirection::RIGHT : SnakeDirection::LEFT;
+		}
+		else if (headY != appleY)
+		{
+			direction = headY < appleY ? SnakeDirection::DOWN : SnakeDirection::UP;
+		}
+		else
+		{
+			return false;
+		}
+
+		// the server drops presses that don't change anything, no point sending them.
+		if (direction == lastDirection)
+		{
+			return false;
+		}
+
+		lastDirection = direction;
+		return true;
+	}
+
+private:
+	SnakeDirection lastDirection = SnakeDirection::RIGHT;
+};
+
+/// <summary>
+/// Load generator for <see cref="SnakeServer"/>. Runs thousands of bot clients on a few threads, ramping the
+/// client count up in steps and reporting round trip, tick lag and throughput percentiles at each step.
+/// </summary>
+class SnakeSwarm
+{
+public:
+	/// <summary>
+	/// Runs the swarm until the last step is done.
+	/// </summary>
+	/// <param name="host">The servers IPv4 address.</param>
+	/// <param name="port">The servers port.</param>
+	/// <param name="clients">The number of clients at the last step.</param>
+	/// <param name="threadCount">The number of threads to run the clients on.</param>
+	/// <param name="steps">The number of steps to ramp up in.</param>
+	/// <param name="stepSeconds">How long to hold each step before reporting.</param>
+	/// <returns>Returns false if the swarm couldn't reach the server.</returns>
+	bool Run(const std::string& host, Uint16 port, int clients, int threadCount = 4, int steps = 5, int stepSeconds = 5)
+	{
+		SnakeServer::RaiseFileLimit();
+
+		sockaddr_in address = {};
+		address.sin_family = AF_INET;
+		address.sin_port = htons(port);
+
+		if (inet_pton(AF_INET, host.c_str(), &address.sin_addr) != 1)
+		{
+			COS_LOG_ERR("{} isn't an IPv4 address", host);
+			return false;
+		}
+
+		running = true;
+		threadCount = SDL_max(threadCount, 1);
+		steps = SDL_max(steps, 1);
+
+		for (int i = 0; i < threadCount; i++)
+		{
+			threads.push_back(std::unique_ptr<SwarmThread>(new SwarmThread(this, address, (Uint32)i)));
+		}
+
+		for (auto& thread : threads)
+		{
+			thread->Start();
+		}
+
+		COS_LOG_INFO("Swarm ramping up to {} clients on {} threads against {}:{}", clients, threadCount, host, port);
+		bool reachedServer = true;
+
+		for (int step = 1; step <= steps && reachedServer; step++)
+		{
+			int target = clients * step / steps;
+
+			for (int i = 0; i < threadCount; i++)
+			{
+				threads[i]->target = target / threadCount + (i < target % threadCount ? 1 : 0);
+			}
+
+			// the first second of a step is spent connecting, so it isn't counted.
+			SDL_Delay(1000);
+			TakeStats();
+
+			Uint64 start = SnakeServer::GetMicroseconds();
+			SDL_Delay(stepSeconds * 1000);
+
+			SwarmStats stats = TakeStats();
+			Report(stats, SnakeServer::GetMicroseconds() - start);
+
+			reachedServer = stats.connected > 0;
+		}
+
+		running = false;
+
+		for (auto& thread : threads)
+		{
+			thread->Join();
+		}
+
+		threads.clear();
+
+		if (!reachedServer)
+		{
+			COS_LOG_ERR("No clients could connect to {}:{}", host, port);
+		}
+
+		return reachedServer;
+	}
+
+private:
+	struct SwarmStats
+	{
+		std::vector<double> roundTrips;
+		std::vector<double> tickLags;
+		std::vector<double> serverLates;
+		Uint64 states = 0;
+		Uint64 inputs = 0;
+		Uint64 deaths = 0;
+		Uint64 disconnects = 0;
+		Uint64 connected = 0;
+
+		void Add(const SwarmStats& other)
+		{
+			roundTrips.insert(roundTrips.end(), other.roundTrips.begin(), other.roundTrips.end());
+			tickLags.insert(tickLags.end(), other.tickLags.begin(), other.tickLags.end());
+			serverLates.insert(serverLates.end(), other.serverLates.begin(), other.serverLates.end());
+			states += other.states;
+			inputs += other.inputs;
+			deaths += other.deaths;
+			disconnects += other.disconnects;
+			connected += other.connected;
+		}
+	};
+
+	struct Session
+	{
+		int socket;
+		std::unique_ptr<SnakeBotController> controller;
+		Uint8 received[sizeof(SnakeStateMessage)];
+		Uint32 receivedSize;
+		Uint32 sequence;
+		Uint32 pendingSequence;
+		Uint64 pendingSentTime;
+		Uint64 firstTickTime;
+		Uint32 tickMicroseconds;
+	};
+
+	class SwarmThread
+	{
+	public:
+		SwarmThread(SnakeSwarm* swarm, sockaddr_in address, Uint32 index) : random(index * 2654435761u + 1)
+		{
+			this->swarm = swarm;
+			this->address = address;
+			this->epollDescriptor = epoll_create1(EPOLL_CLOEXEC);
+			this->target = 0;
+			this->connectedCount = 0;
+		}
+
+		~SwarmThread()
+		{
+			for (auto& session : sessions)
+			{
+				close(session->socket);
+			}
+
+			close(epollDescriptor);
+		}
+
+		void Start()
+		{
+			thread = std::thread([this]() { Loop(); });
+		}
+
+		void Join()
+		{
+			thread.join();
+		}
+
+		/// <summary>
+		/// Swaps out everything measured since the last call.
+		/// </summary>
+		SwarmStats TakeStats()
+		{
+			std::lock_guard<std::mutex> lock(statsMutex);
+			SwarmStats taken;
+			std::swap(taken, stats);
+			taken.connected = connectedCount;
+			return taken;
+		}
+
+		std::atomic<int> target;
+
+	private:
+		SnakeSwarm* swarm;
+		sockaddr_in address;
+		int epollDescriptor;
+		std::thread thread;
+		std::vector<std::unique_ptr<Session>> sessions;
+		// sessions belongs to the worker, this is its size for everyone else.
+		std::atomic<Uint32> connectedCount;
+		std::mutex statsMutex;
+		SwarmStats stats;
+		SnakeRandom random;
+
+		void Loop()
+		{
+			epoll_event events[SnakeServer::MAX_EVENTS];
+
+			while (swarm->running)
+			{
+				// connect a few at a time so a step ramps up instead of hitting the server all at once.
+				for (int i = 0; i < 16 && (int)sessions.size() < target; i++)
+				{
+					if (!Connect())
+					{
+						break;
+					}
+				}
+
+				int eventCount = epoll_wait(epollDescriptor, events, SnakeServer::MAX_EVENTS, 10);
+
+				for (int i = 0; i < eventCount; i++)
+				{
+					Session* session = (Session*)events[i].data.ptr;
+
+					if ((events[i].events & (EPOLLHUP | EPOLLERR)) != 0 || !Receive(session))
+					{
+						Disconnect(session);
+					}
+				}
+			}
+		}
+
+		bool Connect()
+		{
+			int socket = ::socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+
+			// localhost connects finish straight away, so a blocking connect is simpler than waiting on epoll for it.
+			if (socket < 0 || connect(socket, (sockaddr*)&address, sizeof(address)) < 0)
+			{
+				if (socket >= 0)
+				{
+					close(socket);
+				}
+
+				std::lock_guard<std::mutex> lock(statsMutex);
+				stats.disconnects++;
+				return false;
+			}
+
+			int noDelay = 1;
+			setsockopt(socket, IPPROTO_TCP, TCP_NODELAY, &noDelay, sizeof(noDelay));
+			fcntl(socket, F_SETFL, fcntl(socket, F_GETFL) | O_NONBLOCK);
+
+			std::unique_ptr<Session> session(new Session());
+			session->socket = socket;
+			session->receivedSize = 0;
+			session->sequence = 0;
+			session->pendingSequence = 0;
+			session->pendingSentTime = 0;
+			session->firstTickTime = 0;
+			session->tickMicroseconds = 0;
+
+			// half chase apples, half mash keys.
+			if (random.Next() % 2 == 0)
+			{
+				session->controller.reset(new AppleBotController());
+			}
+			else
+			{
+				session->controller.reset(new RandomBotController(random.Next()));
+			}
+
+			epoll_event event = {};
+			event.events = EPOLLIN | EPOLLRDHUP;
+			event.data.ptr = session.get();
+			epoll_ctl(epollDescriptor, EPOLL_CTL_ADD, socket, &event);
+
+			Session* added = session.get();
+			sessions.push_back(std::move(session));
+			connectedCount = (Uint32)sessions.size();
+
+			return Join(added);
+		}
+
+		void Disconnect(Session* session)
+		{
+			epoll_ctl(epollDescriptor, EPOLL_CTL_DEL, session->socket, NULL);
+			close(session->socket);
+
+			for (size_t i = 0; i < sessions.size(); i++)
+			{
+				if (sessions[i].get() == session)
+				{
+					sessions[i].swap(sessions.back());
+					sessions.pop_back();
+					break;
+				}
+			}
+
+			connectedCount = (Uint32)sessions.size();
+
+			std::lock_guard<std::mutex> lock(statsMutex);
+			stats.disconnects++;
+		}
+
+		bool Join(Session* session)
+		{
+			SnakeJoinMessage join = {};
+			join.type = (Uint8)SnakeMessageType::JOIN;
+
+			return send(session->socket, &join, sizeof(join), MSG_NOSIGNAL) == (ssize_t)sizeof(join);
+		}
+
+		bool Receive(Session* session)
+		{
+			Uint8 buffer[2048];
+
+			while (true)
+			{
+				ssize_t size = recv(session->socket, buffer, sizeof(buffer), 0);
+
+				if (size == 0 || (size < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR))
+				{
+					return false;
+				}
+
+				if (size < 0)
+				{
+					return true;
+				}
+
+				Uint64 now = SnakeServer::GetMicroseconds();
+
+				for (ssize_t i = 0; i < size; i++)
+				{
+					session->received[session->receivedSize++] = buffer[i];
+					size_t messageSize = GetSnakeMessageSize(session->received[0]);
+
+					if (messageSize == 0 || messageSize > sizeof(session->received))
+					{
+						return false;
+					}
+
+					if (session->receivedSize == messageSize)
+					{
+						session->receivedSize = 0;
+
+						if (!HandleMessage(session, now))
+						{
+							return false;
+						}
+					}
+				}
+			}
+		}
+
+		bool HandleMessage(Session* session, Uint64 now)
+		{
+			if (session->received[0] == (Uint8)SnakeMessageType::WELCOME)
+			{
+				SnakeWelcomeMessage welcome;
+				SDL_memcpy(&welcome, session->received, sizeof(welcome));
+				session->tickMicroseconds = welcome.tickMilliseconds * 1000;
+
+				// the server schedules the first tick a whole tick after it sends the welcome, and keeps to that schedule after.
+				session->firstTickTime = now + session->tickMicroseconds;
+				return true;
+			}
+
+			if (session->received[0] != (Uint8)SnakeMessageType::STATE)
+			{
+				return false;
+			}
+
+			SnakeStateMessage state;
+			SDL_memcpy(&state, session->received, sizeof(state));
+
+			{
+				std::lock_guard<std::mutex> lock(statsMutex);
+				stats.states++;
+				stats.serverLates.push_back(state.lateMicroseconds / 1000.0);
+
+				Uint64 expected = session->firstTickTime + (Uint64)(state.tick - 1) * session->tickMicroseconds;
+				stats.tickLags.push_back(now > expected ? (now - expected) / 1000.0 : 0.0);
+
+				// inputs only come back after the next tick, so this includes the wait for it, up to a whole tick.
+				if (session->pendingSequence != 0 && state.inputSequence == session->pendingSequence)
+				{
+					stats.roundTrips.push_back((now - session->pendingSentTime) / 1000.0);
+					session->pendingSequence = 0;
+				}
+
+				if ((state.flags & SNAKE_STATE_DEAD) != 0)
+				{
+					stats.deaths++;
+				}
+			}
+
+			// a dead bot starts over straight away so the load stays put.
+			if ((state.flags & SNAKE_STATE_DEAD) != 0)
+			{
+				return Join(session);
+			}
+
+			SnakeDirection direction;
+
+			if (!session->controller->OnState(state, direction))
+			{
+				return true;
+			}
+
+			SnakeInputMessage input = {};
+			input.type = (Uint8)SnakeMessageType::INPUT;
+			input.direction = (Uint8)direction;
+			input.sequence = ++session->sequence;
+			input.sentTime = now;
+
+			// only one input is timed at a time, a later one would overwrite the echo before it came back.
+			if (session->pendingSequence == 0)
+			{
+				session->pendingSequence = input.sequence;
+				session->pendingSentTime = now;
+			}
+
+			{
+				std::lock_guard<std::mutex> lock(statsMutex);
+				stats.inputs++;
+			}
+
+			return send(session->socket, &input, sizeof(input), MSG_NOSIGNAL) == (ssize_t)sizeof(input);
+		}
+	};
+
+	SwarmStats TakeStats()
+	{
+		SwarmStats total;
+
+		for (auto& thread : threads)
+		{
+			total.Add(thread->TakeStats());
+		}
+
+		return total;
+	}
+
+	static double Percentile(std::vector<double>& samples, double percentile)
+	{
+		if (samples.empty())
+		{
+			return 0;
+		}
+
+		size_t index = SDL_min((size_t)(percentile / 100.0 * samples.size()), samples.size() - 1);
+		std::nth_element(samples.begin(), samples.begin() + index, samples.end());
+		return samples[index];
+	}
+
+	void Report(SwarmStats& stats, Uint64 microseconds)
+	{
+		double seconds = microseconds / 1000000.0;
+
+		COS_LOG_INFO("Swarm at {} clients: {} states/s, {} inputs/s, {} deaths, {} disconnects", stats.connected,
+			stats.states / seconds, stats.inputs / seconds, stats.deaths, stats.disconnects);
+		COS_LOG_INFO("  round trip ms p50 {} p90 {} p99 {} max {}", Percentile(stats.roundTrips, 50), Percentile(stats.roundTrips, 90),
+			Percentile(stats.roundTrips, 99), Percentile(stats.roundTrips, 100));
+		COS_LOG_INFO("  tick lag ms p50 {} p90 {} p99 {} max {}", Percentile(stats.tickLags, 50), Percentile(stats.tickLags, 90),
+			Percentile(stats.tickLags, 99), Percentile(stats.tickLags, 100));
+		COS_LOG_INFO("  server late ms p50 {} p90 {} p99 {} max {}", Percentile(stats.serverLates, 50), Percentile(stats.serverLates, 90),
+			Percentile(stats.serverLates, 99), Percentile(stats.serverLates, 100));
+	}
+
+	std::atomic<bool> running;
+	std::vector<std::unique_ptr<SwarmThread>> threads;
+};
+#endif